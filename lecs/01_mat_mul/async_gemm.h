@@ -0,0 +1,229 @@
+#ifndef ASYNC_GEMM_H
+#define ASYNC_GEMM_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "matrix_multiplication.h"
+
+// Multiply a horizontal panel of rows [row_begin, row_end) of C = A * B.
+// K is walked in blocks so each block of B stays hot while the panel's rows
+// stream over it; the block product itself reuses the recursive kernel, whose
+// base case (rows <= threshold) is the i-k-j loop.
+inline void gemm_row_panel(const Matrix& A, const Matrix& B, Matrix& C,
+                           int row_begin, int row_end, int k_block = 256) {
+    const int rows = row_end - row_begin;
+    for (int k0 = 0; k0 < A.cols; k0 += k_block) {
+        int kb = std::min(k_block, A.cols - k0);
+        matrix_mult_recursive(A.data.data() + row_begin * A.cols + k0,
+                              B.data.data() + k0 * B.cols,
+                              C.data.data() + row_begin * C.cols, rows, kb, kb,
+                              B.cols, A.cols, B.cols, C.cols,
+                              std::max(rows, 1));
+    }
+}
+
+// Asynchronous GEMM executor.
+//
+// Every submitted product is cut into row panels that go onto one FIFO shared
+// by a fixed set of worker threads. A worker that runs out of panels for
+// request N immediately picks up the first panels of request N+1, so the tail
+// of one product overlaps with the start of the next instead of leaving cores
+// idle between blocking calls. Completion is signalled through a future or a
+// callback run by whichever worker finishes the last panel. A failed panel
+// or a throwing callback never escapes a worker: the exception goes to the
+// request's future or error callback instead.
+class AsyncGemmExecutor {
+   public:
+    using Callback = std::function<void(Matrix)>;
+    using ErrorCallback = std::function<void(std::exception_ptr)>;
+
+    explicit AsyncGemmExecutor(
+        int num_threads = static_cast<int>(std::thread::hardware_concurrency()),
+        int panel_rows = 64)
+        : panel_rows_(std::max(panel_rows, 1)) {
+        num_threads = std::max(num_threads, 1);
+        workers_.reserve(num_threads);
+        for (int t = 0; t < num_threads; t++) {
+            workers_.emplace_back([this]() { worker_loop(); });
+        }
+    }
+
+    AsyncGemmExecutor(const AsyncGemmExecutor&) = delete;
+    AsyncGemmExecutor& operator=(const AsyncGemmExecutor&) = delete;
+
+    // Outstanding requests are finished before the workers exit
+    ~AsyncGemmExecutor() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        work_ready_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    // Queue C = A * B and return a future for C
+    std::future<Matrix> submit(Matrix A, Matrix B) {
+        auto promise = std::make_shared<std::promise<Matrix>>();
+        std::future<Matrix> result = promise->get_future();
+        enqueue(
+            std::move(A), std::move(B),
+            [promise](Matrix C) { promise->set_value(std::move(C)); },
+            [promise](std::exception_ptr e) { promise->set_exception(e); });
+        return result;
+    }
+
+    // Queue C = A * B and invoke done(C) on a worker thread when it is ready.
+    // If the product fails or done throws, fail gets the exception instead;
+    // without fail it is dropped. The callbacks must not block on other
+    // requests of this executor.
+    void submit(Matrix A, Matrix B, Callback done,
+                ErrorCallback fail = nullptr) {
+        enqueue(std::move(A), std::move(B), std::move(done), std::move(fail));
+    }
+
+    // Block until every submitted request has completed
+    void wait_idle() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this]() { return in_flight_ == 0; });
+    }
+
+    int num_threads() const { return static_cast<int>(workers_.size()); }
+
+   private:
+    struct Request {
+        Matrix A;
+        Matrix B;
+        Matrix C;
+        std::atomic<int> panels_left;
+        std::atomic<bool> failed;
+        std::exception_ptr error;  // first panel failure, set once
+        Callback done;
+        ErrorCallback fail;
+
+        Request(Matrix a, Matrix b, Callback cb, ErrorCallback on_error)
+            : A(std::move(a)),
+              B(std::move(b)),
+              C(A.rows, B.cols),
+              panels_left(0),
+              failed(false),
+              done(std::move(cb)),
+              fail(std::move(on_error)) {}
+    };
+
+    struct Panel {
+        std::shared_ptr<Request> request;
+        int row_begin;
+        int row_end;
+    };
+
+    void enqueue(Matrix A, Matrix B, Callback done, ErrorCallback fail) {
+        if (A.cols != B.rows) {
+            throw std::invalid_argument("Incompatible matrix dimensions");
+        }
+
+        auto request = std::make_shared<Request>(
+            std::move(A), std::move(B), std::move(done), std::move(fail));
+        const int rows = request->A.rows;
+        const int num_panels =
+            std::max((rows + panel_rows_ - 1) / panel_rows_, 1);
+        request->panels_left.store(num_panels, std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                throw std::runtime_error("AsyncGemmExecutor is shutting down");
+            }
+            in_flight_++;
+            for (int p = 0; p < num_panels; p++) {
+                int begin = p * panel_rows_;
+                queue_.push_back(
+                    {request, begin, std::min(begin + panel_rows_, rows)});
+            }
+        }
+        work_ready_.notify_all();
+    }
+
+    void worker_loop() {
+        for (;;) {
+            Panel panel;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                work_ready_.wait(
+                    lock, [this]() { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) {
+                    return;  // stopping and drained
+                }
+                panel = std::move(queue_.front());
+                queue_.pop_front();
+            }
+
+            Request& req = *panel.request;
+            try {
+                if (panel.row_end > panel.row_begin) {
+                    gemm_row_panel(req.A, req.B, req.C, panel.row_begin,
+                                   panel.row_end);
+                }
+            } catch (...) {
+                if (!req.failed.exchange(true)) {
+                    req.error = std::current_exception();
+                }
+            }
+
+            // The worker that retires the last panel owns completion; the
+            // acq_rel decrement also makes req.error visible to it
+            if (req.panels_left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                complete(req);
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (--in_flight_ == 0) {
+                    idle_.notify_all();
+                }
+            }
+        }
+    }
+
+    // Hand the result or the first failure to the request's callbacks. An
+    // exception from done goes to fail; one from fail is dropped.
+    static void complete(Request& req) {
+        try {
+            if (req.error) {
+                if (req.fail) {
+                    req.fail(req.error);
+                }
+            } else {
+                req.done(std::move(req.C));
+            }
+        } catch (...) {
+            if (!req.error && req.fail) {
+                try {
+                    req.fail(std::current_exception());
+                } catch (...) {
+                }
+            }
+        }
+    }
+
+    const int panel_rows_;
+    std::vector<std::thread> workers_;
+    std::deque<Panel> queue_;
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable idle_;
+    int in_flight_ = 0;
+    bool stopping_ = false;
+};
+
+#endif  // ASYNC_GEMM_H
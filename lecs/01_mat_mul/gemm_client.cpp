@@ -0,0 +1,248 @@
+// Open-loop load generator for gemm_server.
+//
+// A sender thread issues requests on a Poisson schedule over one connection
+// without waiting for replies; a receiver thread matches responses by id.
+// Each in-flight request owns a memfd slot that holds A, B and the result C,
+// so the server computes directly in the client's pages. Latency runs from
+// the scheduled send time to the response, and the first reply is checked
+// against naive_matrix_multiply.
+//
+// Usage: ./gemm_client [socket_path] [size] [rate req/s] [requests] [slots]
+
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gemm_protocol.h"
+#include "matrix_multiplication.h"
+
+using Clock = std::chrono::steady_clock;
+
+// One reusable shared-memory payload buffer
+struct Slot {
+    int fd = -1;
+    double* data = nullptr;
+    size_t bytes = 0;
+    Clock::time_point scheduled;
+};
+
+static bool create_slot(Slot* slot, int size, std::mt19937& gen) {
+    slot->bytes = gemm_payload_bytes(size, size, size);
+    slot->fd = memfd_create("gemm_payload", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (slot->fd < 0 || ftruncate(slot->fd, slot->bytes) < 0) {
+        perror("memfd_create");
+        return false;
+    }
+    // The server refuses payloads that could still shrink under it
+    if (fcntl(slot->fd, F_ADD_SEALS, F_SEAL_SHRINK) < 0) {
+        perror("fcntl(F_ADD_SEALS)");
+        return false;
+    }
+    void* p = mmap(nullptr, slot->bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   slot->fd, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+    slot->data = static_cast<double*>(p);
+
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    size_t inputs = 2 * static_cast<size_t>(size) * size;
+    for (size_t i = 0; i < inputs; i++) {
+        slot->data[i] = dist(gen);
+    }
+    return true;
+}
+
+static int connect_to(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (fd < 0 ||
+        connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) <
+            0) {
+        perror("connect");
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+// Compare the C region of a slot with a locally computed product
+static bool check_slot(const Slot& slot, int size) {
+    Matrix A(size, size), B(size, size);
+    size_t elems = static_cast<size_t>(size) * size;
+    std::copy(slot.data, slot.data + elems, A.data.begin());
+    std::copy(slot.data + elems, slot.data + 2 * elems, B.data.begin());
+    Matrix expected = naive_matrix_multiply(A, B);
+    const double* c = slot.data + 2 * elems;
+    for (size_t i = 0; i < elems; i++) {
+        if (std::abs(expected.data[i] - c[i]) > 1e-9) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    size_t idx = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+int main(int argc, char* argv[]) {
+    std::string path = argc > 1 ? argv[1] : kDefaultGemmSocket;
+    int size = argc > 2 ? std::atoi(argv[2]) : 32;
+    double rate = argc > 3 ? std::atof(argv[3]) : 20000.0;
+    int count = argc > 4 ? std::atoi(argv[4]) : 100000;
+    int num_slots = argc > 5 ? std::atoi(argv[5]) : 1024;
+    if (size <= 0 || rate <= 0.0 || count <= 0 || num_slots <= 0) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [socket_path] [size] [rate req/s] [requests] [slots]"
+                  << std::endl;
+        return 1;
+    }
+
+    int sock = connect_to(path);
+    if (sock < 0) {
+        return 1;
+    }
+
+    std::mt19937 gen(7);
+    std::vector<Slot> slots(num_slots);
+    for (auto& slot : slots) {
+        if (!create_slot(&slot, size, gen)) {
+            return 1;
+        }
+    }
+
+    // Free slot ids; the sender blocks here only when every slot is in flight
+    std::vector<int> free_slots;
+    for (int i = num_slots - 1; i >= 0; i--) {
+        free_slots.push_back(i);
+    }
+    std::mutex slot_mutex;
+    std::condition_variable slot_freed;
+
+    std::vector<double> latencies;
+    latencies.reserve(count);
+    std::vector<uint64_t> batch_sizes;
+    std::atomic<bool> checked_ok{true};
+    bool disconnected = false;  // guarded by slot_mutex
+
+    std::cout << "Matrix size: " << size << " x " << size
+              << ", offered load: " << rate << " req/s, " << count
+              << " requests" << std::endl;
+
+    auto start = Clock::now();
+
+    std::thread receiver([&]() {
+        bool checked = false;
+        for (int r = 0; r < count; r++) {
+            GemmResponse resp;
+            if (!read_full(sock, &resp, sizeof(resp))) {
+                std::lock_guard<std::mutex> lock(slot_mutex);
+                disconnected = true;
+                slot_freed.notify_one();
+                return;
+            }
+            auto now = Clock::now();
+            int slot_id = static_cast<int>(resp.id % num_slots);
+            Slot& slot = slots[slot_id];
+            if (resp.status != kGemmOk) {
+                checked_ok = false;
+            } else if (!checked) {
+                if (!check_slot(slot, size)) {
+                    checked_ok = false;
+                }
+                checked = true;
+            }
+            latencies.push_back(std::chrono::duration<double, std::micro>(
+                                    now - slot.scheduled)
+                                    .count());
+            batch_sizes.push_back(resp.batch_size);
+
+            std::lock_guard<std::mutex> lock(slot_mutex);
+            free_slots.push_back(slot_id);
+            slot_freed.notify_one();
+        }
+    });
+
+    // Stop the receiver and wait for it, so no thread outlives main
+    auto abort_run = [&](const char* what) {
+        std::cerr << what << std::endl;
+        shutdown(sock, SHUT_RDWR);
+        receiver.join();
+        return 1;
+    };
+
+    std::exponential_distribution<double> gap(rate);
+    double t = 0.0;
+    for (int r = 0; r < count; r++) {
+        auto scheduled = start + std::chrono::duration_cast<Clock::duration>(
+                                     std::chrono::duration<double>(t));
+        t += gap(gen);
+        std::this_thread::sleep_until(scheduled);
+
+        int slot_id;
+        {
+            std::unique_lock<std::mutex> lock(slot_mutex);
+            slot_freed.wait(lock, [&]() {
+                return !free_slots.empty() || disconnected;
+            });
+            if (free_slots.empty()) {
+                lock.unlock();
+                return abort_run("Server closed the connection");
+            }
+            slot_id = free_slots.back();
+            free_slots.pop_back();
+        }
+        // Ids are chosen so that id % num_slots recovers the slot
+        uint64_t id = static_cast<uint64_t>(r) * num_slots + slot_id;
+        slots[slot_id].scheduled = scheduled;
+        if (!send_request(sock, {id, size, size, size, 0}, slots[slot_id].fd)) {
+            return abort_run("Failed to send request");
+        }
+    }
+    receiver.join();
+    if (disconnected) {
+        std::cerr << "Server closed the connection" << std::endl;
+        return 1;
+    }
+    std::chrono::duration<double> wall = Clock::now() - start;
+
+    std::sort(latencies.begin(), latencies.end());
+    double mean_batch = 0.0;
+    for (uint64_t b : batch_sizes) {
+        mean_batch += b;
+    }
+    mean_batch /= batch_sizes.size();
+
+    std::cout << "Throughput: " << count / wall.count() << " req/s"
+              << std::endl;
+    std::cout << "Latency us: p50 " << percentile(latencies, 0.50) << "  p90 "
+              << percentile(latencies, 0.90) << "  p99 "
+              << percentile(latencies, 0.99) << "  p99.9 "
+              << percentile(latencies, 0.999) << "  max " << latencies.back()
+              << std::endl;
+    std::cout << "Mean batch size: " << mean_batch << std::endl;
+    std::cout << "Result check: " << (checked_ok ? "passed" : "FAILED")
+              << std::endl;
+
+    close(sock);
+    return checked_ok ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+#ifndef GEMM_PROTOCOL_H
+#define GEMM_PROTOCOL_H
+
+// Wire protocol shared by gemm_server and gemm_client.
+//
+// A client keeps one Unix domain stream socket open to the server. For each
+// product it fills a memfd laid out as [A (m x k) | B (k x n) | C (m x n)]
+// (row-major doubles) and sends a GemmRequest with the memfd attached as
+// SCM_RIGHTS ancillary data. The server maps the same pages, writes C in
+// place and answers with a GemmResponse carrying the request id. No payload
+// bytes ever cross the socket.
+//
+// The memfd must be at least as large as the shape needs and sealed with
+// F_SEAL_SHRINK, so the client cannot truncate it under the server; any
+// other payload is answered with kGemmBadRequest.
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+constexpr const char* kDefaultGemmSocket = "/tmp/gemm_server.sock";
+
+struct GemmRequest {
+    uint64_t id;
+    int32_t m;
+    int32_t k;
+    int32_t n;
+    int32_t reserved;
+};
+
+enum GemmStatus : int32_t {
+    kGemmOk = 0,
+    kGemmBadRequest = 1,
+};
+
+struct GemmResponse {
+    uint64_t id;
+    int32_t status;
+    int32_t batch_size;  // how many products were fused with this one
+};
+
+// Size in bytes of the shared payload for an m x k by k x n product, or 0
+// if a dimension is not positive or the size does not fit in a size_t
+inline size_t gemm_payload_bytes(int m, int k, int n) {
+    if (m <= 0 || k <= 0 || n <= 0) {
+        return 0;
+    }
+    size_t mk, kn, mn, elems, bytes;
+    if (__builtin_mul_overflow(static_cast<size_t>(m), k, &mk) ||
+        __builtin_mul_overflow(static_cast<size_t>(k), n, &kn) ||
+        __builtin_mul_overflow(static_cast<size_t>(m), n, &mn) ||
+        __builtin_add_overflow(mk, kn, &elems) ||
+        __builtin_add_overflow(elems, mn, &elems) ||
+        __builtin_mul_overflow(elems, sizeof(double), &bytes)) {
+        return 0;
+    }
+    return bytes;
+}
+
+// Write exactly len bytes, retrying on EINTR and short writes
+inline bool write_full(int fd, const void* buf, size_t len) {
+    const char* p = static_cast<const char*>(buf);
+    while (len > 0) {
+        ssize_t w = send(fd, p, len, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        }
+        if (w <= 0) {
+            return false;
+        }
+        p += w;
+        len -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+// Read exactly len bytes; false on EOF or error
+inline bool read_full(int fd, void* buf, size_t len) {
+    char* p = static_cast<char*>(buf);
+    while (len > 0) {
+        ssize_t r = recv(fd, p, len, 0);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            return false;
+        }
+        p += r;
+        len -= static_cast<size_t>(r);
+    }
+    return true;
+}
+
+// Send a request header with the payload memfd attached
+inline bool send_request(int sock, const GemmRequest& req, int payload_fd) {
+    struct iovec iov;
+    iov.iov_base = const_cast<GemmRequest*>(&req);
+    iov.iov_len = sizeof(req);
+
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    std::memset(control, 0, sizeof(control));
+
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &payload_fd, sizeof(int));
+
+    ssize_t w;
+    do {
+        w = sendmsg(sock, &msg, MSG_NOSIGNAL);
+    } while (w < 0 && errno == EINTR);
+    // The header is tiny, so a partial write means the peer is gone
+    return w == static_cast<ssize_t>(sizeof(req));
+}
+
+// Receive a request header and its memfd. Returns false on EOF or a
+// malformed message; *payload_fd is -1 if no descriptor was attached.
+inline bool recv_request(int sock, GemmRequest* req, int* payload_fd) {
+    struct iovec iov;
+    iov.iov_base = req;
+    iov.iov_len = sizeof(*req);
+
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t r;
+    do {
+        r = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (r < 0 && errno == EINTR);
+    if (r <= 0) {
+        return false;
+    }
+
+    *payload_fd = -1;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            std::memcpy(payload_fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+
+    // Finish a header split across reads (the fd rides on the first byte)
+    if (r < static_cast<ssize_t>(sizeof(*req)) &&
+        !read_full(sock, reinterpret_cast<char*>(req) + r,
+                   sizeof(*req) - static_cast<size_t>(r))) {
+        if (*payload_fd >= 0) {
+            close(*payload_fd);
+        }
+        return false;
+    }
+    return true;
+}
+
+#endif  // GEMM_PROTOCOL_H
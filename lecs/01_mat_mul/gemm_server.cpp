@@ -0,0 +1,331 @@
+// Local matrix multiplication daemon with dynamic request batching.
+//
+// Clients connect over a Unix domain socket and hand over memfd-backed
+// payloads (see gemm_protocol.h). Small products are individually too small
+// to parallelise, so the server holds each one for at most a latency budget
+// while it waits for other requests of the same shape, then runs the whole
+// group through batched_matrix_multiply in one parallel region. A group is
+// flushed as soon as it is full or its oldest request reaches the budget.
+//
+// Usage: ./gemm_server [socket_path] [budget_us] [max_batch] [threads]
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "gemm_protocol.h"
+#include "matrix_multiplication.h"
+
+using Clock = std::chrono::steady_clock;
+
+static volatile std::sig_atomic_t g_stop = 0;
+
+static void handle_signal(int) { g_stop = 1; }
+
+// A client socket. Shared between the I/O thread (reads) and the batcher
+// (writes responses); closed once both have dropped it.
+struct Connection {
+    int fd;
+    std::mutex write_mutex;
+
+    explicit Connection(int f) : fd(f) {}
+    ~Connection() { close(fd); }
+
+    void respond(const GemmResponse& resp) {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        write_full(fd, &resp, sizeof(resp));
+    }
+};
+
+// A request whose payload is mapped and waiting to be batched
+struct Pending {
+    std::shared_ptr<Connection> conn;
+    uint64_t id;
+    void* mapping;
+    size_t mapping_bytes;
+    Clock::time_point arrival;
+
+    double* A() const { return static_cast<double*>(mapping); }
+};
+
+using Shape = std::tuple<int, int, int>;
+
+class Batcher {
+   public:
+    Batcher(std::chrono::microseconds budget, int max_batch)
+        : budget_(budget), max_batch_(std::max(max_batch, 1)) {}
+
+    void push(const Shape& shape, Pending p) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            groups_[shape].push_back(std::move(p));
+        }
+        ready_.notify_one();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        ready_.notify_one();
+    }
+
+    // Batcher thread body: wait for a full or expired group, then run it
+    void run() {
+        for (;;) {
+            Shape shape;
+            std::vector<Pending> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                for (;;) {
+                    if (take_ready_group(&shape, &batch)) {
+                        break;
+                    }
+                    if (stopping_ && groups_.empty()) {
+                        return;
+                    }
+                    if (groups_.empty()) {
+                        ready_.wait(lock);
+                    } else {
+                        ready_.wait_until(lock, earliest_deadline());
+                    }
+                }
+            }
+            execute(shape, batch);
+        }
+    }
+
+    uint64_t batches() const { return batches_; }
+    uint64_t requests() const { return requests_; }
+
+   private:
+    Clock::time_point earliest_deadline() const {
+        Clock::time_point earliest = Clock::time_point::max();
+        for (const auto& entry : groups_) {
+            earliest = std::min(earliest, entry.second.front().arrival);
+        }
+        return earliest + budget_;
+    }
+
+    // Pop up to max_batch requests of one shape if the group is full, its
+    // oldest member has used up the budget, or we are draining on shutdown
+    bool take_ready_group(Shape* shape, std::vector<Pending>* batch) {
+        auto now = Clock::now();
+        for (auto it = groups_.begin(); it != groups_.end(); ++it) {
+            auto& queue = it->second;
+            bool full = static_cast<int>(queue.size()) >= max_batch_;
+            bool expired = queue.front().arrival + budget_ <= now;
+            if (!full && !expired && !stopping_) {
+                continue;
+            }
+            size_t take =
+                std::min(queue.size(), static_cast<size_t>(max_batch_));
+            *shape = it->first;
+            batch->assign(std::make_move_iterator(queue.begin()),
+                          std::make_move_iterator(queue.begin() + take));
+            queue.erase(queue.begin(), queue.begin() + take);
+            if (queue.empty()) {
+                groups_.erase(it);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void execute(const Shape& shape, std::vector<Pending>& batch) {
+        int m, k, n;
+        std::tie(m, k, n) = shape;
+        const int size = static_cast<int>(batch.size());
+
+        std::vector<const double*> a(size), b(size);
+        std::vector<double*> c(size);
+        for (int i = 0; i < size; i++) {
+            a[i] = batch[i].A();
+            b[i] = a[i] + static_cast<size_t>(m) * k;
+            c[i] = const_cast<double*>(b[i]) + static_cast<size_t>(k) * n;
+        }
+        batched_matrix_multiply(a.data(), b.data(), c.data(), size, m, k, n);
+
+        for (auto& p : batch) {
+            munmap(p.mapping, p.mapping_bytes);
+            p.conn->respond({p.id, kGemmOk, size});
+        }
+        batches_++;
+        requests_ += size;
+    }
+
+    const std::chrono::microseconds budget_;
+    const int max_batch_;
+    std::map<Shape, std::vector<Pending>> groups_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    bool stopping_ = false;
+    uint64_t batches_ = 0;
+    uint64_t requests_ = 0;
+};
+
+// Map the payload of one request and hand it to the batcher
+static void accept_request(const std::shared_ptr<Connection>& conn,
+                           const GemmRequest& req, int payload_fd,
+                           Batcher& batcher) {
+    if (payload_fd < 0 || req.m <= 0 || req.k <= 0 || req.n <= 0) {
+        if (payload_fd >= 0) {
+            close(payload_fd);
+        }
+        conn->respond({req.id, kGemmBadRequest, 0});
+        return;
+    }
+
+    // A payload shorter than the shape says would fault (SIGBUS) when the
+    // kernel touches the missing pages. The size check only holds if the
+    // client cannot shrink the memfd afterwards, so require the seal first.
+    size_t bytes = gemm_payload_bytes(req.m, req.k, req.n);
+    int seals = fcntl(payload_fd, F_GET_SEALS);
+    struct stat st;
+    if (bytes == 0 || seals < 0 || !(seals & F_SEAL_SHRINK) ||
+        fstat(payload_fd, &st) < 0 ||
+        static_cast<uint64_t>(st.st_size) < bytes) {
+        close(payload_fd);
+        conn->respond({req.id, kGemmBadRequest, 0});
+        return;
+    }
+    void* mapping =
+        mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, payload_fd, 0);
+    close(payload_fd);
+    if (mapping == MAP_FAILED) {
+        conn->respond({req.id, kGemmBadRequest, 0});
+        return;
+    }
+
+    batcher.push(Shape(req.m, req.k, req.n),
+                 {conn, req.id, mapping, bytes, Clock::now()});
+}
+
+static int listen_on(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Socket path too long: " << path << std::endl;
+        close(fd);
+        return -1;
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+    unlink(path.c_str());
+
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(fd, 64) < 0) {
+        perror("bind/listen");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char* argv[]) {
+    std::string path = argc > 1 ? argv[1] : kDefaultGemmSocket;
+    int budget_us = argc > 2 ? std::atoi(argv[2]) : 200;
+    int max_batch = argc > 3 ? std::atoi(argv[3]) : 64;
+    int threads = argc > 4
+                      ? std::atoi(argv[4])
+                      : static_cast<int>(std::thread::hardware_concurrency());
+    if (budget_us < 0 || max_batch <= 0 || threads <= 0) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [socket_path] [budget_us] [max_batch] [threads]"
+                  << std::endl;
+        return 1;
+    }
+    omp_set_num_threads(threads);
+
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_signal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    int listen_fd = listen_on(path);
+    if (listen_fd < 0) {
+        return 1;
+    }
+    std::cout << "Listening on " << path << " (budget " << budget_us
+              << " us, max batch " << max_batch << ", " << threads
+              << " threads)" << std::endl;
+
+    Batcher batcher(std::chrono::microseconds(budget_us), max_batch);
+    std::thread batch_thread([&batcher]() { batcher.run(); });
+
+    // Single I/O thread: poll the listener and every client socket
+    std::vector<std::shared_ptr<Connection>> conns;
+    while (!g_stop) {
+        std::vector<struct pollfd> fds;
+        fds.push_back({listen_fd, POLLIN, 0});
+        for (const auto& conn : conns) {
+            fds.push_back({conn->fd, POLLIN, 0});
+        }
+
+        int ready = poll(fds.data(), fds.size(), 100);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            break;
+        }
+
+        std::vector<std::shared_ptr<Connection>> alive;
+        for (size_t i = 1; i < fds.size(); i++) {
+            const auto& conn = conns[i - 1];
+            if (fds[i].revents == 0) {
+                alive.push_back(conn);
+                continue;
+            }
+            GemmRequest req;
+            int payload_fd;
+            if (recv_request(conn->fd, &req, &payload_fd)) {
+                accept_request(conn, req, payload_fd, batcher);
+                alive.push_back(conn);
+            }
+            // else: peer hung up; in-flight requests keep the socket alive
+        }
+        conns.swap(alive);
+
+        if (fds[0].revents & POLLIN) {
+            int client = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client >= 0) {
+                conns.push_back(std::make_shared<Connection>(client));
+            }
+        }
+    }
+
+    close(listen_fd);
+    unlink(path.c_str());
+    conns.clear();
+    batcher.stop();
+    batch_thread.join();
+
+    std::cout << "Served " << batcher.requests() << " requests in "
+              << batcher.batches() << " batches" << std::endl;
+    return 0;
+}
@@ -2,8 +2,12 @@
 
 #include <chrono>
 #include <iostream>
+#include <limits>
 
+#include "async_gemm.h"
+#include "matrix_compare.h"
 #include "matrix_multiplication.h"
+#include "summa_gemm.h"
 
 // For CPU feature detection
 #ifdef _MSC_VER
@@ -31,18 +35,14 @@ bool matricesEqual(const Matrix& A, const Matrix& B, double tolerance = 1e-10) {
         return false;
     }
 
-    for (int i = 0; i < A.rows; i++) {
-        for (int j = 0; j < A.cols; j++) {
-            if (std::abs(A.at(i, j) - B.at(i, j)) > tolerance) {
-                std::cout << "Difference at [" << i << "][" << j
-                          << "]: " << A.at(i, j) << " vs " << B.at(i, j)
-                          << std::endl;
-                return false;
-            }
-        }
+    MatrixCompareResult r =
+        matrix_compare(A.data.data(), A.cols, B.data.data(), B.cols, A.rows,
+                       A.cols, tolerance, 0.0);
+    if (!matrix_compare_ok(&r)) {
+        std::cout << std::flush;
+        matrix_compare_print(stdout, &r);
     }
-
-    return true;
+    return matrix_compare_ok(&r);
 }
 
 // Benchmark helper
@@ -90,6 +90,33 @@ TEST(MatrixMultiplicationTest, CorrectnessTest) {
     EXPECT_TRUE(matricesEqual(naive_result, opt_result));
 }
 
+// The comparison counts every bad element and locates the worst one,
+// whichever thread finds it
+TEST(MatrixCompareTest, ReportsCountAndWorstElement) {
+    Matrix expected = createRandomMatrix(67, 45);
+    Matrix actual = expected;
+    actual.at(3, 7) += 1e-3;
+    actual.at(50, 44) -= 0.5;
+    actual.at(66, 0) += 1e-12;  // within tolerance
+
+    MatrixCompareResult r =
+        matrix_compare(expected.data.data(), expected.cols, actual.data.data(),
+                       actual.cols, expected.rows, expected.cols, 1e-10, 0.0);
+    EXPECT_FALSE(matrix_compare_ok(&r));
+    EXPECT_EQ(r.compared, 67 * 45);
+    EXPECT_EQ(r.out_of_tolerance, 2);
+    EXPECT_EQ(r.worst_row, 50);
+    EXPECT_EQ(r.worst_col, 44);
+    EXPECT_NEAR(r.max_abs_err, 0.5, 1e-12);
+
+    actual.at(10, 10) = std::numeric_limits<double>::quiet_NaN();
+    r = matrix_compare(expected.data.data(), expected.cols, actual.data.data(),
+                       actual.cols, expected.rows, expected.cols, 1e-10, 0.0);
+    EXPECT_EQ(r.out_of_tolerance, 3);
+    EXPECT_EQ(r.worst_row, 10);
+    EXPECT_EQ(r.worst_col, 10);
+}
+
 // Test invalid dimensions
 TEST(MatrixMultiplicationTest, IncompatibleDimensions) {
     Matrix A = createRandomMatrix(10, 20);
@@ -99,6 +126,111 @@ TEST(MatrixMultiplicationTest, IncompatibleDimensions) {
     EXPECT_THROW(optimized_matrix_multiply(A, B), std::invalid_argument);
 }
 
+// Async executor: futures and callbacks, several requests in flight
+TEST(AsyncGemmTest, PipelinedRequestsMatchNaive) {
+    AsyncGemmExecutor executor(4, 16);
+
+    std::vector<Matrix> As, Bs;
+    std::vector<std::future<Matrix>> futures;
+    for (int r = 0; r < 6; r++) {
+        As.push_back(createRandomMatrix(37 + r, 50));
+        Bs.push_back(createRandomMatrix(50, 29 + 3 * r));
+        futures.push_back(executor.submit(As[r], Bs[r]));
+    }
+
+    std::atomic<int> callbacks{0};
+    Matrix callback_result(0, 0);
+    executor.submit(As[0], Bs[0], [&](Matrix C) {
+        callback_result = std::move(C);
+        callbacks++;
+    });
+
+    for (int r = 0; r < 6; r++) {
+        EXPECT_TRUE(matricesEqual(naive_matrix_multiply(As[r], Bs[r]),
+                                  futures[r].get()));
+    }
+    executor.wait_idle();
+    EXPECT_EQ(callbacks.load(), 1);
+    EXPECT_TRUE(
+        matricesEqual(naive_matrix_multiply(As[0], Bs[0]), callback_result));
+
+    EXPECT_THROW(executor.submit(As[0], As[1]), std::invalid_argument);
+}
+
+// A throwing callback reaches the error callback and leaves the workers up
+TEST(AsyncGemmTest, CallbackExceptionIsContained) {
+    AsyncGemmExecutor executor(2, 8);
+    Matrix A = createRandomMatrix(20, 12), B = createRandomMatrix(12, 9);
+
+    std::atomic<int> errors{0};
+    executor.submit(
+        A, B, [](Matrix) { throw std::runtime_error("callback failed"); },
+        [&](std::exception_ptr e) {
+            EXPECT_THROW(std::rethrow_exception(e), std::runtime_error);
+            errors++;
+        });
+    executor.submit(A, B, [](Matrix) { throw std::runtime_error("dropped"); });
+    executor.wait_idle();
+    EXPECT_EQ(errors.load(), 1);
+
+    EXPECT_TRUE(matricesEqual(naive_matrix_multiply(A, B),
+                              executor.submit(A, B).get()));
+}
+
+// Batched kernel over raw buffers, as used by gemm_server
+TEST(MatrixMultiplicationTest, BatchedMatchesNaive) {
+    const int batch = 5, m = 19, k = 23, n = 17;
+    std::vector<Matrix> As, Bs, Cs;
+    std::vector<const double*> a, b;
+    std::vector<double*> c;
+    for (int i = 0; i < batch; i++) {
+        As.push_back(createRandomMatrix(m, k));
+        Bs.push_back(createRandomMatrix(k, n));
+        Cs.emplace_back(m, n);
+    }
+    for (int i = 0; i < batch; i++) {
+        a.push_back(As[i].data.data());
+        b.push_back(Bs[i].data.data());
+        c.push_back(Cs[i].data.data());
+    }
+
+    batched_matrix_multiply(a.data(), b.data(), c.data(), batch, m, k, n);
+
+    for (int i = 0; i < batch; i++) {
+        EXPECT_TRUE(matricesEqual(naive_matrix_multiply(As[i], Bs[i]), Cs[i]));
+    }
+}
+
+// Multi-process SUMMA on grids that do not divide the matrix evenly
+TEST(SummaGemmTest, GridShapesMatchNaive) {
+    Matrix A = createRandomMatrix(45, 38);
+    Matrix B = createRandomMatrix(38, 29);
+    Matrix expected = naive_matrix_multiply(A, B);
+
+    EXPECT_TRUE(matricesEqual(expected, summa_matrix_multiply(A, B, 1, 1, 8)));
+    EXPECT_TRUE(matricesEqual(expected, summa_matrix_multiply(A, B, 2, 2, 8)));
+    EXPECT_TRUE(matricesEqual(expected, summa_matrix_multiply(A, B, 2, 3, 5)));
+    EXPECT_THROW(summa_matrix_multiply(A, A, 2, 2), std::invalid_argument);
+}
+
+// The workers are reaped by pid; other children of the caller keep their
+// exit status
+TEST(SummaGemmTest, LeavesOtherChildrenAlone) {
+    pid_t other = fork();
+    ASSERT_GE(other, 0);
+    if (other == 0) {
+        _exit(7);
+    }
+    Matrix A = createRandomMatrix(16, 16);
+    EXPECT_TRUE(matricesEqual(naive_matrix_multiply(A, A),
+                              summa_matrix_multiply(A, A, 2, 2, 4)));
+
+    int status = 0;
+    ASSERT_EQ(waitpid(other, &status, 0), other);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 7);
+}
+
 // Performance test
 TEST(MatrixMultiplicationTest, PerformanceTest) {
     // Larger matrices for benchmarking
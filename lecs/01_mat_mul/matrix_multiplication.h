@@ -4,9 +4,13 @@
 #include <immintrin.h>  // For AVX2 intrinsics
 #include <omp.h>        // For OpenMP
 
+#include <algorithm>
+#include <stdexcept>
 #include <thread>
 #include <vector>
 
+#include "fj_instrument.h"  // Fork-join hooks for the race detector
+
 // Matrix structure
 struct Matrix {
     int rows;
@@ -128,8 +132,12 @@ void matrix_mult_recursive(const double* A, const double* B, double* C,
     if (m <= threshold || n <= threshold || k <= threshold) {
         for (int i = 0; i < m; i++) {
             for (int kk = 0; kk < k; kk++) {
+                FJ_READ(&A[i * lda + kk]);
                 double a_ik = A[i * lda + kk];
                 for (int j = 0; j < n; j++) {
+                    FJ_READ(&B[kk * ldb + j]);
+                    FJ_READ(&C[i * ldc + j]);
+                    FJ_WRITE(&C[i * ldc + j]);
                     C[i * ldc + j] += a_ik * B[kk * ldb + j];
                 }
             }
@@ -160,41 +168,67 @@ void matrix_mult_recursive(const double* A, const double* B, double* C,
 
 // Recursive calls - can be parallelized
 #pragma omp task
-    matrix_mult_recursive(A11, B11, C11, m2, k2, k2, n2, lda, ldb, ldc,
-                          threshold);
+    {
+        FJ_SPAWN_SCOPE;
+        matrix_mult_recursive(A11, B11, C11, m2, k2, k2, n2, lda, ldb, ldc,
+                              threshold);
+    }
 
 #pragma omp task
-    matrix_mult_recursive(A11, B12, C12, m2, k2, k2, n - n2, lda, ldb, ldc,
-                          threshold);
+    {
+        FJ_SPAWN_SCOPE;
+        matrix_mult_recursive(A11, B12, C12, m2, k2, k2, n - n2, lda, ldb,
+                              ldc, threshold);
+    }
 
 #pragma omp task
-    matrix_mult_recursive(A21, B11, C21, m - m2, k2, k2, n2, lda, ldb, ldc,
-                          threshold);
+    {
+        FJ_SPAWN_SCOPE;
+        matrix_mult_recursive(A21, B11, C21, m - m2, k2, k2, n2, lda, ldb,
+                              ldc, threshold);
+    }
 
 #pragma omp task
-    matrix_mult_recursive(A21, B12, C22, m - m2, k2, k2, n - n2, lda, ldb, ldc,
-                          threshold);
+    {
+        FJ_SPAWN_SCOPE;
+        matrix_mult_recursive(A21, B12, C22, m - m2, k2, k2, n - n2, lda, ldb,
+                              ldc, threshold);
+    }
 
 #pragma omp taskwait
+    FJ_SYNC();
 
 // Second set of recursive multiplications
 #pragma omp task
-    matrix_mult_recursive(A12, B21, C11, m2, k - k2, k - k2, n2, lda, ldb, ldc,
-                          threshold);
+    {
+        FJ_SPAWN_SCOPE;
+        matrix_mult_recursive(A12, B21, C11, m2, k - k2, k - k2, n2, lda, ldb,
+                              ldc, threshold);
+    }
 
 #pragma omp task
-    matrix_mult_recursive(A12, B22, C12, m2, k - k2, k - k2, n - n2, lda, ldb,
-                          ldc, threshold);
+    {
+        FJ_SPAWN_SCOPE;
+        matrix_mult_recursive(A12, B22, C12, m2, k - k2, k - k2, n - n2, lda,
+                              ldb, ldc, threshold);
+    }
 
 #pragma omp task
-    matrix_mult_recursive(A22, B21, C21, m - m2, k - k2, k - k2, n2, lda, ldb,
-                          ldc, threshold);
+    {
+        FJ_SPAWN_SCOPE;
+        matrix_mult_recursive(A22, B21, C21, m - m2, k - k2, k - k2, n2, lda,
+                              ldb, ldc, threshold);
+    }
 
 #pragma omp task
-    matrix_mult_recursive(A22, B22, C22, m - m2, k - k2, k - k2, n - n2, lda,
-                          ldb, ldc, threshold);
+    {
+        FJ_SPAWN_SCOPE;
+        matrix_mult_recursive(A22, B22, C22, m - m2, k - k2, k - k2, n - n2,
+                              lda, ldb, ldc, threshold);
+    }
 
 #pragma omp taskwait
+    FJ_SYNC();
 }
 
 Matrix divide_conquer_matrix_multiply(const Matrix& A, const Matrix& B) {
@@ -204,6 +238,8 @@ Matrix divide_conquer_matrix_multiply(const Matrix& A, const Matrix& B) {
 
     Matrix C(A.rows, B.cols);
 
+    FJ_REGION("divide_conquer_matrix_multiply");
+
 #pragma omp parallel
     {
 #pragma omp single
@@ -327,4 +363,38 @@ Matrix optimized_matrix_multiply(const Matrix& A, const Matrix& B) {
     return C;
 }
 
+// Batched multiplication of many same-shaped products: C[b] = A[b] * B[b].
+// Operands are raw row-major buffers so callers can point straight into
+// shared memory. Work is split over (product, row block) pairs, so a batch of
+// small products fills all threads even when each product alone could not.
+void batched_matrix_multiply(const double* const* A, const double* const* B,
+                             double* const* C, int batch, int m, int k, int n,
+                             int row_block = 16) {
+    if (batch <= 0 || m <= 0 || n <= 0) {
+        return;
+    }
+    const int row_blocks = (m + row_block - 1) / row_block;
+
+#pragma omp parallel for collapse(2) schedule(dynamic)
+    for (int b = 0; b < batch; b++) {
+        for (int rb = 0; rb < row_blocks; rb++) {
+            const double* a = A[b];
+            const double* bm = B[b];
+            double* c = C[b];
+            int i_end = std::min((rb + 1) * row_block, m);
+            for (int i = rb * row_block; i < i_end; i++) {
+                for (int j = 0; j < n; j++) {
+                    c[i * n + j] = 0.0;
+                }
+                for (int kk = 0; kk < k; kk++) {
+                    double a_ik = a[i * k + kk];
+                    for (int j = 0; j < n; j++) {
+                        c[i * n + j] += a_ik * bm[kk * n + j];
+                    }
+                }
+            }
+        }
+    }
+}
+
 #endif  // MATRIX_MULTIPLICATION_H
\ No newline at end of file
@@ -0,0 +1,467 @@
+// Roofline characterisation of the host machine and the GEMM kernels.
+//
+// 1. Peak FMA throughput per ISA (scalar, AVX2, AVX-512) and thread count,
+//    from independent FMA chains long enough to hide the FMA latency.
+// 2. Read bandwidth for working sets sized to L1, L2, L3 and DRAM.
+// 3. Each kernel of matrix_multiplication.h placed against that roofline.
+//    DRAM traffic comes from per-thread last-level-cache miss counters when
+//    perf_event_open is available; otherwise the compulsory traffic
+//    (A, B and C once) is used, which gives an upper bound on intensity.
+//
+// Usage: ./roofline [size] [csv_path]
+
+#include <linux/perf_event.h>
+#include <omp.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "matrix_multiplication.h"
+
+using Clock = std::chrono::steady_clock;
+
+static volatile double g_sink;
+
+// ---------------------------------------------------------------------------
+// Peak FMA throughput
+// ---------------------------------------------------------------------------
+
+// Twelve independent accumulators cover FMA latency x issue width on every
+// current x86 core; each kernel returns the number of FLOPs it executed.
+
+__attribute__((target("fma"))) static double fma_scalar(long iters) {
+    __m128d x = _mm_set_sd(1.0000001), y = _mm_set_sd(0.9999999);
+    __m128d acc[12];
+    for (int a = 0; a < 12; a++) {
+        acc[a] = _mm_set_sd(a);
+    }
+    for (long i = 0; i < iters; i++) {
+        for (int a = 0; a < 12; a++) {
+            acc[a] = _mm_fmadd_sd(acc[a], x, y);
+        }
+    }
+    double sum = 0.0;
+    for (int a = 0; a < 12; a++) {
+        sum += _mm_cvtsd_f64(acc[a]);
+    }
+    g_sink = sum;
+    return 2.0 * 12 * iters;
+}
+
+__attribute__((target("avx2,fma"))) static double fma_avx2(long iters) {
+    __m256d x = _mm256_set1_pd(1.0000001), y = _mm256_set1_pd(0.9999999);
+    __m256d acc[12];
+    for (int a = 0; a < 12; a++) {
+        acc[a] = _mm256_set1_pd(a);
+    }
+    for (long i = 0; i < iters; i++) {
+        for (int a = 0; a < 12; a++) {
+            acc[a] = _mm256_fmadd_pd(acc[a], x, y);
+        }
+    }
+    double lanes[4], sum = 0.0;
+    for (int a = 0; a < 12; a++) {
+        _mm256_storeu_pd(lanes, acc[a]);
+        sum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    g_sink = sum;
+    return 2.0 * 4 * 12 * iters;
+}
+
+__attribute__((target("avx512f"))) static double fma_avx512(long iters) {
+    __m512d x = _mm512_set1_pd(1.0000001), y = _mm512_set1_pd(0.9999999);
+    __m512d acc[12];
+    for (int a = 0; a < 12; a++) {
+        acc[a] = _mm512_set1_pd(a);
+    }
+    for (long i = 0; i < iters; i++) {
+        for (int a = 0; a < 12; a++) {
+            acc[a] = _mm512_fmadd_pd(acc[a], x, y);
+        }
+    }
+    double lanes[8], sum = 0.0;
+    for (int a = 0; a < 12; a++) {
+        _mm512_storeu_pd(lanes, acc[a]);
+        for (int l = 0; l < 8; l++) {
+            sum += lanes[l];
+        }
+    }
+    g_sink = sum;
+    return 2.0 * 8 * 12 * iters;
+}
+
+struct Isa {
+    const char* name;
+    bool supported;
+    double (*kernel)(long);
+};
+
+// GFLOP/s of `kernel` run concurrently on `threads` threads (best of 3)
+static double measure_flops(double (*kernel)(long), int threads) {
+    const long iters = 20000000;  // per thread
+    double best = 0.0;
+    for (int rep = 0; rep < 3; rep++) {
+        double flops = 0.0;
+        auto start = Clock::now();
+#pragma omp parallel num_threads(threads) reduction(+ : flops)
+        flops += kernel(iters);
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        best = std::max(best, flops / elapsed.count() / 1e9);
+    }
+    return best;
+}
+
+// ---------------------------------------------------------------------------
+// Memory bandwidth
+// ---------------------------------------------------------------------------
+
+// Sum the buffer with several accumulators so loads, not adds, are the limit
+static double read_pass(const double* buf, size_t n) {
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0, s4 = 0, s5 = 0, s6 = 0, s7 = 0;
+    for (size_t i = 0; i + 8 <= n; i += 8) {
+        s0 += buf[i];
+        s1 += buf[i + 1];
+        s2 += buf[i + 2];
+        s3 += buf[i + 3];
+        s4 += buf[i + 4];
+        s5 += buf[i + 5];
+        s6 += buf[i + 6];
+        s7 += buf[i + 7];
+    }
+    return s0 + s1 + s2 + s3 + s4 + s5 + s6 + s7;
+}
+
+// GB/s reading a per-thread working set of `bytes` on `threads` threads
+static double measure_bandwidth(size_t bytes, int threads) {
+    const size_t n = std::max<size_t>(bytes / sizeof(double), 8);
+    // Enough passes that every measurement moves ~2 GB per thread
+    const int passes = static_cast<int>(std::max<size_t>(
+        2, (size_t(2) << 30) / (n * sizeof(double))));
+    double best = 0.0;
+
+#pragma omp parallel num_threads(threads)
+    {
+        std::vector<double> buf(n, 1.0);
+        double sum = 0.0;
+        for (int rep = 0; rep < 3; rep++) {
+            read_pass(buf.data(), n);  // warm the level under test
+#pragma omp barrier
+            auto start = Clock::now();
+            for (int p = 0; p < passes; p++) {
+                sum += read_pass(buf.data(), n);
+                __asm__ volatile("" ::: "memory");
+            }
+#pragma omp barrier
+            std::chrono::duration<double> elapsed = Clock::now() - start;
+#pragma omp single
+            best = std::max(best, static_cast<double>(threads) * n *
+                                      sizeof(double) * passes /
+                                      elapsed.count() / 1e9);
+        }
+        g_sink = sum;
+    }
+    return best;
+}
+
+static size_t cache_size(int name, size_t fallback) {
+    long v = sysconf(name);
+    return v > 0 ? static_cast<size_t>(v) : fallback;
+}
+
+// ---------------------------------------------------------------------------
+// Kernel placement
+// ---------------------------------------------------------------------------
+
+// Last-level cache miss counter for the calling thread, or -1 if unavailable
+static int open_llc_miss_counter() {
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(
+        syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+// One counter per OpenMP thread, opened by the thread itself. inherit on
+// the main thread would only follow threads created after the counter, and
+// the OpenMP pool already exists by then; libgomp reuses the pool threads
+// for every later top-level parallel region. Empty if any counter fails.
+static std::vector<int> open_llc_miss_counters() {
+    int threads = std::max(
+        omp_get_max_threads(),
+        static_cast<int>(std::thread::hardware_concurrency()));
+    std::vector<int> fds(threads, -1);
+#pragma omp parallel num_threads(threads)
+    fds[omp_get_thread_num()] = open_llc_miss_counter();
+
+    if (std::find(fds.begin(), fds.end(), -1) != fds.end()) {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+        fds.clear();
+    }
+    return fds;
+}
+
+struct KernelPoint {
+    std::string name;
+    double gflops;
+    double intensity;  // FLOP per DRAM byte
+    bool measured;     // intensity from counters rather than compulsory
+};
+
+static KernelPoint place_kernel(
+    const std::string& name,
+    const std::function<Matrix(const Matrix&, const Matrix&)>& kernel,
+    const Matrix& A, const Matrix& B) {
+    const double n = A.rows;
+    const double flops = 2.0 * n * n * n;
+
+    kernel(A, B);  // warm up
+    std::vector<int> fds = open_llc_miss_counters();
+    for (int fd : fds) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    auto start = Clock::now();
+    kernel(A, B);
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+
+    KernelPoint point{name, flops / elapsed.count() / 1e9, 0.0, false};
+    uint64_t misses = 0;
+    bool counted = !fds.empty();
+    for (int fd : fds) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t thread_misses = 0;
+        if (read(fd, &thread_misses, sizeof(thread_misses)) !=
+            sizeof(thread_misses)) {
+            counted = false;
+        }
+        misses += thread_misses;
+        close(fd);
+    }
+    if (counted && misses > 0) {
+        point.intensity = flops / (misses * 64.0);
+        point.measured = true;
+    }
+    if (!point.measured) {
+        point.intensity = flops / (3.0 * n * n * sizeof(double));
+    }
+    return point;
+}
+
+// ---------------------------------------------------------------------------
+// Report
+// ---------------------------------------------------------------------------
+
+// Log-log ASCII roofline: '-' is the compute roof, '/' the DRAM slope
+static void plot(double peak, double dram_bw,
+                 const std::vector<KernelPoint>& points) {
+    const int width = 64, height = 20;
+    const double x_lo = std::log2(1.0 / 16), x_hi = std::log2(256.0);
+    const double y_hi = std::log10(peak * 2), y_lo = y_hi - 4;
+    std::vector<std::string> grid(height, std::string(width, ' '));
+
+    auto row_of = [&](double gflops) {
+        double y = (std::log10(gflops) - y_lo) / (y_hi - y_lo);
+        return height - 1 - static_cast<int>(std::lround(y * (height - 1)));
+    };
+    for (int c = 0; c < width; c++) {
+        double ai = std::exp2(x_lo + (x_hi - x_lo) * c / (width - 1));
+        double roof = std::min(peak, dram_bw * ai);
+        int r = row_of(roof);
+        if (r >= 0 && r < height) {
+            grid[r][c] = roof < peak ? '/' : '-';
+        }
+    }
+    for (size_t p = 0; p < points.size(); p++) {
+        double x = (std::log2(points[p].intensity) - x_lo) / (x_hi - x_lo);
+        int c = static_cast<int>(std::lround(
+            std::min(std::max(x, 0.0), 1.0) * (width - 1)));
+        int r = row_of(std::max(points[p].gflops, std::pow(10.0, y_lo)));
+        // Kernels with the same intensity and speed share a cell; shift
+        // later ones right so every marker stays visible
+        while (r >= 0 && r < height && c < width - 1 &&
+               std::isalpha(static_cast<unsigned char>(grid[r][c]))) {
+            c++;
+        }
+        if (r >= 0 && r < height) {
+            grid[r][c] = static_cast<char>('A' + p);
+        }
+    }
+
+    std::cout << "\nGFLOP/s (log) vs FLOP/byte (log, 1/16 .. 256)" << std::endl;
+    for (int r = 0; r < height; r++) {
+        double label = std::pow(10.0, y_hi - (y_hi - y_lo) * r / (height - 1));
+        std::cout << std::setw(9) << std::setprecision(3) << label << " |"
+                  << grid[r] << std::endl;
+    }
+    std::cout << std::string(11, ' ') << std::string(width, '=') << std::endl;
+    for (size_t p = 0; p < points.size(); p++) {
+        std::cout << "  " << static_cast<char>('A' + p) << " = "
+                  << points[p].name << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int size = argc > 1 ? std::atoi(argv[1]) : 512;
+    const char* csv_path = argc > 2 ? argv[2] : nullptr;
+    if (size <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [size] [csv_path]" << std::endl;
+        return 1;
+    }
+    const int max_threads = omp_get_max_threads();
+    std::vector<int> thread_counts;
+    for (int t = 1; t < max_threads; t *= 2) {
+        thread_counts.push_back(t);
+    }
+    thread_counts.push_back(max_threads);
+
+    std::ofstream csv;
+    if (csv_path != nullptr) {
+        csv.open(csv_path);
+        csv << "kind,name,threads,value,intensity" << std::endl;
+    }
+
+    // Peak compute
+    __builtin_cpu_init();
+    std::vector<Isa> isas = {
+        {"scalar", __builtin_cpu_supports("fma") != 0, fma_scalar},
+        {"avx2",
+         __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"),
+         fma_avx2},
+        {"avx512", __builtin_cpu_supports("avx512f") != 0, fma_avx512},
+    };
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Peak FMA throughput (GFLOP/s, double)" << std::endl;
+    std::cout << std::setw(10) << "threads";
+    for (const auto& isa : isas) {
+        std::cout << std::setw(12) << isa.name;
+    }
+    std::cout << std::endl;
+
+    double peak = 0.0;
+    for (int t : thread_counts) {
+        std::cout << std::setw(10) << t;
+        for (const auto& isa : isas) {
+            if (!isa.supported) {
+                std::cout << std::setw(12) << "n/a";
+                continue;
+            }
+            double g = measure_flops(isa.kernel, t);
+            peak = std::max(peak, g);
+            std::cout << std::setw(12) << g;
+            if (csv.is_open()) {
+                csv << "peak," << isa.name << "," << t << "," << g << ","
+                    << std::endl;
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    // Bandwidth per level; L3 is shared, so each thread takes a slice
+    size_t l1 = cache_size(_SC_LEVEL1_DCACHE_SIZE, 32 << 10);
+    size_t l2 = cache_size(_SC_LEVEL2_CACHE_SIZE, 1 << 20);
+    size_t l3 = cache_size(_SC_LEVEL3_CACHE_SIZE, 16 << 20);
+    struct Level {
+        const char* name;
+        size_t total_bytes;
+        bool shared;
+    };
+    std::vector<Level> levels = {{"L1", l1 / 2, false},
+                                 {"L2", l2 / 2, false},
+                                 {"L3", l3 / 2, true},
+                                 {"DRAM", std::max<size_t>(l3 * 8, 256 << 20),
+                                  true}};
+
+    std::cout << "\nRead bandwidth (GB/s)" << std::endl;
+    std::cout << std::setw(10) << "threads";
+    for (const auto& level : levels) {
+        std::cout << std::setw(12) << level.name;
+    }
+    std::cout << std::endl;
+
+    double dram_bw = 0.0;
+    for (int t : thread_counts) {
+        std::cout << std::setw(10) << t;
+        for (const auto& level : levels) {
+            size_t per_thread =
+                level.shared ? level.total_bytes / t : level.total_bytes;
+            double bw = measure_bandwidth(per_thread, t);
+            std::cout << std::setw(12) << bw;
+            if (csv.is_open()) {
+                csv << "bandwidth," << level.name << "," << t << "," << bw
+                    << "," << std::endl;
+            }
+            if (std::string(level.name) == "DRAM") {
+                dram_bw = std::max(dram_bw, bw);
+            }
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "\nRoof: peak " << peak << " GFLOP/s, DRAM " << dram_bw
+              << " GB/s, ridge point " << peak / dram_bw << " FLOP/byte"
+              << std::endl;
+
+    // Kernels
+    Matrix A(size, size), B(size, size);
+    for (size_t i = 0; i < A.data.size(); i++) {
+        A.data[i] = static_cast<double>(rand()) / RAND_MAX;
+        B.data[i] = static_cast<double>(rand()) / RAND_MAX;
+    }
+    std::vector<KernelPoint> points = {
+        place_kernel("naive", naive_matrix_multiply, A, B),
+        place_kernel("loop_interchange", loop_interchange_matrix_multiply, A,
+                     B),
+        place_kernel("parallel_loop", parallel_loop_matrix_multiply, A, B),
+        place_kernel(
+            "tiled",
+            [](const Matrix& a, const Matrix& b) {
+                return tiled_matrix_multiply(a, b);
+            },
+            A, B),
+        place_kernel("divide_conquer", divide_conquer_matrix_multiply, A, B),
+        place_kernel("avx2", avx2_matrix_multiply, A, B),
+        place_kernel("optimized", optimized_matrix_multiply, A, B),
+    };
+
+    std::cout << "\nKernels at " << size << " x " << size << std::endl;
+    std::cout << std::setw(18) << "kernel" << std::setw(12) << "GFLOP/s"
+              << std::setw(12) << "FLOP/byte" << std::setw(12) << "roof"
+              << std::setw(10) << "% roof" << "  traffic" << std::endl;
+    for (const auto& p : points) {
+        double roof = std::min(peak, dram_bw * p.intensity);
+        std::cout << std::setw(18) << p.name << std::setw(12) << p.gflops
+                  << std::setw(12) << p.intensity << std::setw(12) << roof
+                  << std::setw(10) << 100.0 * p.gflops / roof << "  "
+                  << (p.measured ? "LLC misses" : "compulsory") << std::endl;
+        if (csv.is_open()) {
+            csv << "kernel," << p.name << "," << max_threads << ","
+                << p.gflops << "," << p.intensity << std::endl;
+        }
+    }
+
+    plot(peak, dram_bw, points);
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Scaling benchmark: multi-process SUMMA vs the single-process OpenMP path.
+//
+// For each process/thread count P the SUMMA grid is the most square
+// factorisation of P, and the OpenMP kernels run with P threads. Inputs are
+// placed in shared memory once, outside the timed region, as a service
+// keeping its operands in shared memory would.
+//
+// Usage: ./summa_bench [size] [max_procs] [panel_width]
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include "summa_gemm.h"
+
+Matrix createRandomMatrix(int rows, int cols) {
+    Matrix mat(rows, cols);
+    for (double& x : mat.data) {
+        x = static_cast<double>(rand()) / RAND_MAX;
+    }
+    return mat;
+}
+
+// Best of `repeat` runs in seconds
+template <typename Func>
+double time_best(Func func, int repeat = 3) {
+    double best = 1e30;
+    for (int r = 0; r < repeat; r++) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+// Most square grid_rows x grid_cols = procs with grid_rows <= grid_cols
+void square_grid(int procs, int* grid_rows, int* grid_cols) {
+    int r = 1;
+    for (int d = 1; d * d <= procs; d++) {
+        if (procs % d == 0) {
+            r = d;
+        }
+    }
+    *grid_rows = r;
+    *grid_cols = procs / r;
+}
+
+int main(int argc, char* argv[]) {
+    int size = argc > 1 ? std::atoi(argv[1]) : 1024;
+    int max_procs = argc > 2
+                        ? std::atoi(argv[2])
+                        : static_cast<int>(std::thread::hardware_concurrency());
+    int panel = argc > 3 ? std::atoi(argv[3]) : 256;
+    if (size <= 0 || max_procs <= 0 || panel <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [size] [max_procs] [panel_width]"
+                  << std::endl;
+        return 1;
+    }
+
+    Matrix A = createRandomMatrix(size, size);
+    Matrix B = createRandomMatrix(size, size);
+    SharedMatrix sa(A), sb(B);
+    const double gflop = 2.0 * size * size * size / 1e9;
+
+    std::cout << "Matrix size: " << size << " x " << size
+              << ", panel width: " << panel << std::endl;
+    std::cout << std::setw(4) << "P" << std::setw(7) << "grid"
+              << std::setw(12) << "SUMMA s" << std::setw(9) << "GFLOP/s"
+              << std::setw(9) << "speedup" << std::setw(12) << "omp loop s"
+              << std::setw(9) << "speedup" << std::setw(12) << "omp tiled s"
+              << std::setw(9) << "speedup" << std::endl;
+
+    double summa_base = 0.0, loop_base = 0.0, tiled_base = 0.0;
+    for (int p = 1; p <= max_procs; p *= 2) {
+        int gr, gc;
+        square_grid(p, &gr, &gc);
+
+        double summa_s = time_best([&]() {
+            SharedMatrix sc(size, size);
+            summa_gemm(sa, sb, sc, gr, gc, panel);
+        });
+
+        // optimized_matrix_multiply pins its own thread count to the
+        // hardware concurrency, so the P-thread baselines are the loop and
+        // tiled OpenMP kernels
+        omp_set_num_threads(p);
+        double loop_s =
+            time_best([&]() { parallel_loop_matrix_multiply(A, B); });
+        double tiled_s = time_best([&]() { tiled_matrix_multiply(A, B); });
+
+        if (p == 1) {
+            summa_base = summa_s;
+            loop_base = loop_s;
+            tiled_base = tiled_s;
+        }
+        std::cout << std::setw(4) << p << std::setw(7)
+                  << (std::to_string(gr) + "x" + std::to_string(gc))
+                  << std::setw(12) << summa_s << std::setw(9)
+                  << gflop / summa_s << std::setw(9) << summa_base / summa_s
+                  << std::setw(12) << loop_s << std::setw(9)
+                  << loop_base / loop_s << std::setw(12) << tiled_s
+                  << std::setw(9) << tiled_base / tiled_s << std::endl;
+    }
+
+    Matrix check =
+        summa_matrix_multiply(A, B, 1, std::min(max_procs, 2), panel);
+    Matrix ref = parallel_loop_matrix_multiply(A, B);
+    double max_err = 0.0;
+    for (size_t i = 0; i < ref.data.size(); i++) {
+        max_err = std::max(max_err, std::abs(ref.data[i] - check.data[i]));
+    }
+    std::cout << "Max abs difference vs OpenMP: " << max_err << std::endl;
+
+    return max_err < 1e-6 ? 0 : 1;
+}
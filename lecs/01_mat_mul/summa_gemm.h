@@ -0,0 +1,351 @@
+#ifndef SUMMA_GEMM_H
+#define SUMMA_GEMM_H
+
+// Multi-process SUMMA matrix multiplication.
+//
+// P = grid_rows x grid_cols worker processes each own one block C(i, j).
+// K is walked in panels; at every step the process holding A(i, panel)
+// broadcasts it along grid row i, the process holding B(panel, j) broadcasts
+// along grid column j, and every process accumulates the panel product into
+// its block with the recursive blocked kernel. Each worker is single-threaded,
+// so nothing contends inside one OpenMP runtime.
+//
+// Broadcasts go through a PanelTransport. ShmTransport implements it with
+// double-buffered staging panels in POSIX shared memory and a process-shared
+// barrier; a message-passing transport can be swapped in for multi-node runs
+// without touching the algorithm.
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "matrix_multiplication.h"
+
+// Map an anonymous-looking POSIX shared memory segment. The name is unlinked
+// right away; forked children inherit the mapping.
+inline void* summa_shm_alloc(size_t bytes) {
+    static int counter = 0;
+    std::string name = "/summa_" + std::to_string(getpid()) + "_" +
+                       std::to_string(counter++);
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("shm_open failed for " + name);
+    }
+    shm_unlink(name.c_str());
+    if (ftruncate(fd, static_cast<off_t>(bytes)) < 0) {
+        close(fd);
+        throw std::runtime_error("ftruncate failed for " + name);
+    }
+    void* p =
+        mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        throw std::runtime_error("mmap failed for " + name);
+    }
+    return p;
+}
+
+// Row-major matrix whose storage lives in POSIX shared memory
+struct SharedMatrix {
+    int rows;
+    int cols;
+    double* data;
+
+    SharedMatrix(int r, int c)
+        : rows(r),
+          cols(c),
+          data(static_cast<double*>(summa_shm_alloc(bytes()))) {}
+
+    explicit SharedMatrix(const Matrix& m) : SharedMatrix(m.rows, m.cols) {
+        std::copy(m.data.begin(), m.data.end(), data);
+    }
+
+    SharedMatrix(const SharedMatrix&) = delete;
+    SharedMatrix& operator=(const SharedMatrix&) = delete;
+
+    ~SharedMatrix() { munmap(data, bytes()); }
+
+    size_t bytes() const {
+        return std::max<size_t>(static_cast<size_t>(rows) * cols, 1) *
+               sizeof(double);
+    }
+
+    Matrix to_matrix() const {
+        Matrix m(rows, cols);
+        std::copy(data, data + static_cast<size_t>(rows) * cols,
+                  m.data.begin());
+        return m;
+    }
+};
+
+// Process grid coordinates and block ranges of one worker
+struct SummaGrid {
+    int grid_rows;
+    int grid_cols;
+
+    int num_procs() const { return grid_rows * grid_cols; }
+
+    // Balanced split of [0, total) into `parts` contiguous ranges
+    static int split(int total, int parts, int idx) {
+        return static_cast<int>(static_cast<long long>(total) * idx / parts);
+    }
+
+    // Index of the range produced by split() that contains x
+    static int owner(int total, int parts, int x) {
+        int q = parts - 1;
+        while (q > 0 && split(total, parts, q) > x) {
+            q--;
+        }
+        return q;
+    }
+};
+
+// Interface for broadcasting panels within a process row or column
+class PanelTransport {
+   public:
+    virtual ~PanelTransport() = default;
+
+    // Called by every process of grid row `row` at K step `step`. The
+    // process in column `root_col` passes its packed A panel (rows x width,
+    // leading dimension width); everyone gets back a pointer to that panel.
+    virtual const double* broadcast_row(int step, int row, int root_col,
+                                        int my_col, const double* panel,
+                                        size_t count) = 0;
+
+    // Same along grid column `col` for the packed B panel
+    virtual const double* broadcast_col(int step, int col, int root_row,
+                                        int my_row, const double* panel,
+                                        size_t count) = 0;
+
+    // Collective point between publishing and consuming a step's panels
+    virtual void step_barrier() = 0;
+};
+
+// Shared-memory transport. Each grid row and column gets two staging panels
+// used on alternate steps; with one barrier per step a fast process can only
+// run one step ahead, so it never overwrites a panel still being read.
+class ShmTransport : public PanelTransport {
+   public:
+    ShmTransport(const SummaGrid& grid, size_t max_row_panel,
+                 size_t max_col_panel)
+        : grid_(grid),
+          row_panel_(std::max<size_t>(max_row_panel, 1)),
+          col_panel_(std::max<size_t>(max_col_panel, 1)) {
+        bytes_ = sizeof(pthread_barrier_t) +
+                 2 * sizeof(double) * (grid.grid_rows * row_panel_ +
+                                       grid.grid_cols * col_panel_);
+        base_ = static_cast<char*>(summa_shm_alloc(bytes_));
+
+        pthread_barrierattr_t attr;
+        pthread_barrierattr_init(&attr);
+        pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_barrier_init(barrier(), &attr, grid.num_procs());
+        pthread_barrierattr_destroy(&attr);
+    }
+
+    ~ShmTransport() override {
+        pthread_barrier_destroy(barrier());
+        munmap(base_, bytes_);
+    }
+
+    const double* broadcast_row(int step, int row, int root_col, int my_col,
+                                const double* panel, size_t count) override {
+        double* slot = staging() + ((step & 1) * grid_.grid_rows + row) *
+                                       row_panel_;
+        if (my_col == root_col) {
+            std::memcpy(slot, panel, count * sizeof(double));
+        }
+        return slot;
+    }
+
+    const double* broadcast_col(int step, int col, int root_row, int my_row,
+                                const double* panel, size_t count) override {
+        double* slot = staging() + 2 * grid_.grid_rows * row_panel_ +
+                       ((step & 1) * grid_.grid_cols + col) * col_panel_;
+        if (my_row == root_row) {
+            std::memcpy(slot, panel, count * sizeof(double));
+        }
+        return slot;
+    }
+
+    void step_barrier() override { pthread_barrier_wait(barrier()); }
+
+   private:
+    pthread_barrier_t* barrier() {
+        return reinterpret_cast<pthread_barrier_t*>(base_);
+    }
+    double* staging() {
+        return reinterpret_cast<double*>(base_ + sizeof(pthread_barrier_t));
+    }
+
+    SummaGrid grid_;
+    size_t row_panel_;
+    size_t col_panel_;
+    size_t bytes_;
+    char* base_;
+};
+
+// Body of one SUMMA worker at grid position (my_row, my_col)
+inline void summa_worker(const SharedMatrix& A, const SharedMatrix& B,
+                         SharedMatrix& C, const SummaGrid& grid, int my_row,
+                         int my_col, int panel_width,
+                         PanelTransport& transport) {
+    const int m = A.rows, k = A.cols, n = B.cols;
+    const int r0 = SummaGrid::split(m, grid.grid_rows, my_row);
+    const int r1 = SummaGrid::split(m, grid.grid_rows, my_row + 1);
+    const int c0 = SummaGrid::split(n, grid.grid_cols, my_col);
+    const int c1 = SummaGrid::split(n, grid.grid_cols, my_col + 1);
+    const int mb = r1 - r0, nb = c1 - c0;
+
+    std::vector<double> a_pack(static_cast<size_t>(mb) * panel_width);
+    std::vector<double> b_pack(static_cast<size_t>(panel_width) * nb);
+
+    for (int k0 = 0, step = 0; k0 < k; step++) {
+        // Panel k0 of A lives in the grid column owning those K columns,
+        // panel k0 of B in the grid row owning those K rows. Panels stop at
+        // ownership boundaries so each one has exactly one root.
+        const int a_root = SummaGrid::owner(k, grid.grid_cols, k0);
+        const int b_root = SummaGrid::owner(k, grid.grid_rows, k0);
+        const int k_end =
+            std::min({k0 + panel_width,
+                      SummaGrid::split(k, grid.grid_cols, a_root + 1),
+                      SummaGrid::split(k, grid.grid_rows, b_root + 1)});
+        const int kb = k_end - k0;
+
+        if (my_col == a_root) {
+            for (int i = 0; i < mb; i++) {
+                std::memcpy(&a_pack[static_cast<size_t>(i) * kb],
+                            &A.data[static_cast<size_t>(r0 + i) * k + k0],
+                            kb * sizeof(double));
+            }
+        }
+        if (my_row == b_root) {
+            for (int kk = 0; kk < kb; kk++) {
+                std::memcpy(&b_pack[static_cast<size_t>(kk) * nb],
+                            &B.data[static_cast<size_t>(k0 + kk) * n + c0],
+                            nb * sizeof(double));
+            }
+        }
+
+        const double* a_panel =
+            transport.broadcast_row(step, my_row, a_root, my_col, a_pack.data(),
+                                    static_cast<size_t>(mb) * kb);
+        const double* b_panel =
+            transport.broadcast_col(step, my_col, b_root, my_row, b_pack.data(),
+                                    static_cast<size_t>(kb) * nb);
+        transport.step_barrier();
+
+        if (mb > 0 && nb > 0) {
+            matrix_mult_recursive(a_panel, b_panel,
+                                  C.data + static_cast<size_t>(r0) * n + c0, mb,
+                                  kb, kb, nb, kb, nb, n);
+        }
+        k0 = k_end;
+    }
+}
+
+// C = A * B on a grid_rows x grid_cols grid of forked worker processes.
+// C must be zero-initialised (fresh shared memory is).
+inline void summa_gemm(const SharedMatrix& A, const SharedMatrix& B,
+                       SharedMatrix& C, int grid_rows, int grid_cols,
+                       int panel_width = 256) {
+    if (A.cols != B.rows || C.rows != A.rows || C.cols != B.cols) {
+        throw std::invalid_argument("Incompatible matrix dimensions");
+    }
+    if (grid_rows <= 0 || grid_cols <= 0 || panel_width <= 0) {
+        throw std::invalid_argument("Invalid SUMMA grid or panel width");
+    }
+
+    SummaGrid grid{grid_rows, grid_cols};
+    const int max_mb = (A.rows + grid_rows - 1) / grid_rows;
+    const int max_nb = (B.cols + grid_cols - 1) / grid_cols;
+    ShmTransport transport(grid, static_cast<size_t>(max_mb) * panel_width,
+                           static_cast<size_t>(panel_width) * max_nb);
+
+    std::vector<pid_t> children;
+    for (int p = 0; p < grid.num_procs(); p++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            for (pid_t child : children) {
+                kill(child, SIGKILL);
+                waitpid(child, nullptr, 0);
+            }
+            throw std::runtime_error("fork failed");
+        }
+        if (pid == 0) {
+            // Never unwind into the parent's stack from the child
+            try {
+                summa_worker(A, B, C, grid, p / grid_cols, p % grid_cols,
+                             panel_width, transport);
+                _exit(0);
+            } catch (...) {
+                _exit(1);
+            }
+        }
+        children.push_back(pid);
+    }
+
+    // Reap only our own workers: the caller may have other children whose
+    // status is not ours to collect. The peers of a failed worker would wait
+    // at the next step barrier forever, so kill them all on the first
+    // failure. While several workers run they are polled, so a failure is
+    // seen whichever worker it hits; the last one is waited on directly.
+    // Reaped entries are zeroed so a recycled pid is never signalled.
+    bool ok = true;
+    size_t running = children.size();
+    while (running > 0) {
+        bool reaped = false;
+        for (pid_t& child : children) {
+            if (child <= 0) {
+                continue;
+            }
+            int status = 0;
+            pid_t pid = waitpid(child, &status, running > 1 ? WNOHANG : 0);
+            if (pid == 0 || (pid < 0 && errno == EINTR)) {
+                continue;
+            }
+            // pid < 0 otherwise: the child is gone without a status for us
+            child = 0;
+            running--;
+            reaped = true;
+            if (ok && !(pid > 0 && WIFEXITED(status) &&
+                        WEXITSTATUS(status) == 0)) {
+                ok = false;
+                for (pid_t other : children) {
+                    if (other > 0) {
+                        kill(other, SIGKILL);
+                    }
+                }
+            }
+        }
+        if (!reaped && running > 1) {
+            usleep(200);
+        }
+    }
+    if (!ok) {
+        throw std::runtime_error("SUMMA worker process failed");
+    }
+}
+
+// Convenience wrapper for ordinary matrices (copies through shared memory)
+inline Matrix summa_matrix_multiply(const Matrix& A, const Matrix& B,
+                                    int grid_rows, int grid_cols,
+                                    int panel_width = 256) {
+    if (A.cols != B.rows) {
+        throw std::invalid_argument("Incompatible matrix dimensions");
+    }
+    SharedMatrix sa(A), sb(B), sc(A.rows, B.cols);
+    summa_gemm(sa, sb, sc, grid_rows, grid_cols, panel_width);
+    return sc.to_matrix();
+}
+
+#endif  // SUMMA_GEMM_H
@@ -0,0 +1,50 @@
+// Work/span profile of the recursive matrix multiplication.
+//
+// Built with -DFJ_WORK_SPAN and without -fopenmp (see `make workspan`), so
+// the task tree runs as its serial elision while the profiler measures total
+// work and critical-path span for each call site. Comparing the default
+// threshold with a finer one separates a lack of parallelism in the
+// algorithm from spawn overhead: a finer split raises parallelism but also
+// raises the burdened span.
+//
+// Usage: ./work_span [size] [fine_threshold]
+
+#include <cstdlib>
+#include <iostream>
+
+#include "matrix_multiplication.h"
+
+Matrix createRandomMatrix(int rows, int cols) {
+    Matrix mat(rows, cols);
+    for (double& x : mat.data) {
+        x = static_cast<double>(rand()) / RAND_MAX;
+    }
+    return mat;
+}
+
+int main(int argc, char* argv[]) {
+    int size = argc > 1 ? std::atoi(argv[1]) : 1024;
+    int fine = argc > 2 ? std::atoi(argv[2]) : 32;
+    if (size <= 0 || fine <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [size] [fine_threshold]"
+                  << std::endl;
+        return 1;
+    }
+
+    Matrix A = createRandomMatrix(size, size);
+    Matrix B = createRandomMatrix(size, size);
+    std::cout << "Matrix size: " << size << " x " << size << "\n" << std::endl;
+
+    // Default threshold (128), through the public entry point
+    divide_conquer_matrix_multiply(A, B);
+
+    // Same recursion with a finer base case
+    Matrix C(size, size);
+    {
+        FJ_REGION("matrix_mult_recursive, fine threshold");
+        matrix_mult_recursive(A.data.data(), B.data.data(), C.data.data(),
+                              size, size, size, size, size, size, size, fine);
+    }
+
+    return FJ_REPORT();
+}
@@ -1,78 +1,360 @@
+#include <pthread.h>
+#include <sched.h>
 #include <tbb/tbb.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <getopt.h>
 #include <iostream>
+#include <thread>
+#include <vector>
 
-#define MATRIX_SIZE 1024
+#include "aligned_matrix.h"
+#include "matrix_compare.h"
+#include "tbb_gemm.h"
 
-// Matrix data structures
-double matrixA[MATRIX_SIZE][MATRIX_SIZE];
-double matrixB[MATRIX_SIZE][MATRIX_SIZE];
-double matrixC_sequential[MATRIX_SIZE][MATRIX_SIZE];
-double matrixC_parallel[MATRIX_SIZE][MATRIX_SIZE];
+#define DEFAULT_MATRIX_SIZE 1024
+// Above this size the O(n^3) sequential reference is skipped unless -v
+#define VERIFY_LIMIT 2048
+// An element matches if |par - seq| <= VERIFY_ABS_TOL + VERIFY_REL_TOL*|seq|
+#define VERIFY_ABS_TOL 1e-6
+#define VERIFY_REL_TOL 1e-9
 
-// Initialize matrix with random values
-void initialize_matrices() {
-    for (int i = 0; i < MATRIX_SIZE; i++) {
-        for (int j = 0; j < MATRIX_SIZE; j++) {
-            matrixA[i][j] = static_cast<double>(rand()) / RAND_MAX;
-            matrixB[i][j] = static_cast<double>(rand()) / RAND_MAX;
-            matrixC_sequential[i][j] = 0.0;
-            matrixC_parallel[i][j] = 0.0;
-        }
+// Matrix data structures, all sized and laid out at run time
+AlignedMatrix matrixA;
+AlignedMatrix matrixB;
+AlignedMatrix matrixC_sequential;
+AlignedMatrix matrixC_parallel;
+
+// Allocate all four matrices as n x n with row stride ld. The sequential
+// result is only needed when verifying.
+bool allocate_matrices(int n, int ld, bool huge_pages, bool with_reference) {
+    if (matrix_alloc(&matrixA, n, n, ld, huge_pages) != 0 ||
+        matrix_alloc(&matrixB, n, n, ld, huge_pages) != 0 ||
+        matrix_alloc(&matrixC_parallel, n, n, ld, huge_pages) != 0 ||
+        (with_reference &&
+         matrix_alloc(&matrixC_sequential, n, n, ld, huge_pages) != 0)) {
+        std::cerr << "Cannot allocate " << n << " x " << n << " matrices"
+                  << std::endl;
+        return false;
     }
+    return true;
 }
 
-// Sequential matrix multiplication
-void sequential_matrix_mul() {
-    for (int i = 0; i < MATRIX_SIZE; i++) {
-        for (int j = 0; j < MATRIX_SIZE; j++) {
-            matrixC_sequential[i][j] = 0.0;
-            for (int k = 0; k < MATRIX_SIZE; k++) {
-                matrixC_sequential[i][j] += matrixA[i][k] * matrixB[k][j];
+void free_matrices() {
+    matrix_free(&matrixA);
+    matrix_free(&matrixB);
+    matrix_free(&matrixC_sequential);
+    matrix_free(&matrixC_parallel);
+}
+
+// Initialize matrix with random values. Rows are filled in parallel so each
+// page is first touched by a worker rather than all by the main thread.
+void initialize_matrices() {
+    uint64_t seed = static_cast<uint64_t>(std::time(nullptr));
+    tbb::parallel_for(tbb::blocked_range<int>(0, matrixA.rows),
+                      [&](const tbb::blocked_range<int>& rows) {
+                          int b = rows.begin(), e = rows.end();
+                          matrix_fill_rows(&matrixA, b, e, seed);
+                          matrix_fill_rows(&matrixB, b, e, ~seed);
+                          matrix_zero_rows(&matrixC_parallel, b, e);
+                          if (matrixC_sequential.data != nullptr) {
+                              matrix_zero_rows(&matrixC_sequential, b, e);
+                          }
+                      });
+}
+
+// C = A * B over rows [row_begin, row_end), leading n x n blocks.
+// Written i-k-j: with the row stride only known at run time the compiler
+// can no longer interchange an i-j-k nest itself, and the j loop over rows
+// of B and C is the one that vectorises.
+void multiply_rows(AlignedMatrix* C, int row_begin, int row_end, int n) {
+    for (int i = row_begin; i < row_end; i++) {
+        double* c = matrix_row(C, i);
+        const double* a = matrix_row(&matrixA, i);
+        for (int j = 0; j < n; j++) {
+            c[j] = 0.0;
+        }
+        for (int k = 0; k < n; k++) {
+            const double a_ik = a[k];
+            const double* b = matrix_row(&matrixB, k);
+            for (int j = 0; j < n; j++) {
+                c[j] += a_ik * b[j];
             }
         }
     }
 }
 
+// Sequential matrix multiplication
+void sequential_matrix_mul(int n) {
+    multiply_rows(&matrixC_sequential, 0, n, n);
+}
+
 // TBB parallel matrix multiplication functor
 class ParallelMatrixMultiply {
    private:
-    const int grain_size;
+    const int n;
 
    public:
-    ParallelMatrixMultiply(int grain = 1) : grain_size(grain) {}
+    ParallelMatrixMultiply(int size) : n(size) {}
 
     void operator()(const tbb::blocked_range<int>& range) const {
-        for (int i = range.begin(); i < range.end(); ++i) {
-            for (int j = 0; j < MATRIX_SIZE; j++) {
-                matrixC_parallel[i][j] = 0.0;
-                for (int k = 0; k < MATRIX_SIZE; k++) {
-                    matrixC_parallel[i][j] += matrixA[i][k] * matrixB[k][j];
+        multiply_rows(&matrixC_parallel, range.begin(), range.end(), n);
+    }
+};
+
+// Verify results: compare the leading n x n blocks with a parallel
+// reduction and print the error summary
+bool verify_results(int n) {
+    MatrixCompareResult empty;
+    matrix_compare_init(&empty);
+    MatrixCompareResult total = tbb::parallel_reduce(
+        tbb::blocked_range<int>(0, n), empty,
+        [n](const tbb::blocked_range<int>& r, MatrixCompareResult part) {
+            matrix_compare_rows(matrixC_sequential.data,
+                                matrixC_sequential.ld, matrixC_parallel.data,
+                                matrixC_parallel.ld, r.begin(), r.end(), n,
+                                VERIFY_ABS_TOL, VERIFY_REL_TOL, &part);
+            return part;
+        },
+        [](MatrixCompareResult left, const MatrixCompareResult& right) {
+            matrix_compare_merge(&left, &right);
+            return left;
+        });
+    matrix_compare_print(stdout, &total);
+    return matrix_compare_ok(&total);
+}
+
+// Time num_runs calls of run(), printing each one, and return the mean.
+// Per-run times show the affinity_partitioner warming up after its first run.
+template <typename Kernel>
+double time_runs(const char* label, int num_runs, Kernel run) {
+    double total = 0.0;
+    for (int r = 0; r < num_runs; r++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        run();
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+        total += elapsed.count();
+        std::cout << "  " << label << " run " << r + 1 << ": "
+                  << elapsed.count() << " seconds" << std::endl;
+    }
+    return total / num_runs;
+}
+
+// Pins every thread that joins an arena to the CPU matching its arena slot,
+// counting through the CPUs of the process affinity mask so taskset and
+// cgroup limits are respected. all_pinned() is false if the mask could not
+// be read or any thread could not be pinned.
+class PinningObserver : public tbb::task_scheduler_observer {
+   public:
+    explicit PinningObserver(tbb::task_arena& arena)
+        : tbb::task_scheduler_observer(arena), failed_(false) {
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &allowed)) {
+                    cpus_.push_back(cpu);
                 }
             }
         }
+        if (cpus_.empty()) {
+            failed_ = true;
+        }
+        observe(true);
+    }
+
+    void on_scheduler_entry(bool) override {
+        if (cpus_.empty()) {
+            return;
+        }
+        int slot = tbb::this_task_arena::current_thread_index();
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpus_[slot % cpus_.size()], &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+            failed_ = true;
+        }
     }
+
+    bool all_pinned() const { return !failed_; }
+
+   private:
+    std::vector<int> cpus_;
+    std::atomic<bool> failed_;
 };
 
-// Verify results
-bool verify_results() {
-    for (int i = 0; i < MATRIX_SIZE; i++) {
-        for (int j = 0; j < MATRIX_SIZE; j++) {
-            if (std::fabs(matrixC_sequential[i][j] - matrixC_parallel[i][j]) >
-                0.000001) {
-                return false;  // Not equal
+// Median time of `trials` tiled multiplications of the leading n x n blocks
+// in a pinned arena of num_threads threads; the best time goes to *best and
+// whether every thread was actually pinned to *pinned
+double median_time(int n, int num_threads, int trials, double* best,
+                   bool* pinned) {
+    tbb::task_arena arena(num_threads);
+    PinningObserver pinning(arena);
+    std::vector<double> times(trials);
+    for (double& t : times) {
+        auto start = std::chrono::high_resolution_clock::now();
+        arena.execute([&]() {
+            tbb_tiled_matrix_mul(matrixA.data, matrixB.data,
+                                 matrixC_parallel.data, n, matrixA.ld);
+        });
+        auto end = std::chrono::high_resolution_clock::now();
+        t = std::chrono::duration<double>(end - start).count();
+    }
+    std::sort(times.begin(), times.end());
+    *best = times.front();
+    *pinned = pinning.all_pinned();
+    return times[trials / 2];
+}
+
+// CSV driver label: rows whose threads could not all be pinned are marked
+static const char* driver_name(bool pinned) {
+    return pinned ? "tbb" : "tbb-unpinned";
+}
+
+// Scaling sweep over 1..max_threads threads, written as CSV to stdout in
+// the same format as the pthreads driver. Strong scaling keeps each size
+// fixed: speedup = T(1) / T(p). Weak scaling grows the first size with
+// n ~ cbrt(p) so work per thread stays constant, and reports
+// efficiency = T(1) * (W(p) / W(1)) / (p * T(p)). The matrices are
+// allocated once for the largest size; smaller runs use their leading blocks.
+int run_scaling(int argc, char* argv[], int size, int pad, bool huge_pages) {
+    int max_threads = static_cast<int>(std::thread::hardware_concurrency());
+    int trials = 5;
+    std::vector<int> sizes = {size};
+
+    if (argc > 0) {
+        max_threads = std::atoi(argv[0]);
+    }
+    if (argc > 1) {
+        trials = std::atoi(argv[1]);
+    }
+    if (argc > 2) {
+        sizes.clear();
+        for (int s = 2; s < argc; s++) {
+            sizes.push_back(std::atoi(argv[s]));
+            if (sizes.back() <= 0) {
+                std::cerr << "Sizes must be positive" << std::endl;
+                return 1;
             }
         }
     }
-    return true;  // Equal
+    if (max_threads <= 0 || trials <= 0) {
+        std::cerr << "Usage: matrix_mul_tbb --scaling [max_threads] [trials] "
+                     "[size ...]"
+                  << std::endl;
+        return 1;
+    }
+
+    tbb::global_control global_limit(
+        tbb::global_control::max_allowed_parallelism, max_threads);
+    int max_size = static_cast<int>(std::lround(sizes[0] *
+                                                std::cbrt(max_threads)));
+    max_size = std::max(max_size, *std::max_element(sizes.begin(),
+                                                    sizes.end()));
+    if (!allocate_matrices(max_size, matrix_padded_ld(max_size, pad),
+                           huge_pages, false)) {
+        return 1;
+    }
+    initialize_matrices();
+
+    std::printf(
+        "driver,scaling,size,threads,trials,best_s,median_s,speedup,"
+        "efficiency\n");
+    for (int n : sizes) {
+        double t1 = 0.0;
+        for (int p = 1; p <= max_threads; p++) {
+            double best;
+            bool pinned;
+            double median = median_time(n, p, trials, &best, &pinned);
+            if (p == 1) {
+                t1 = median;
+            }
+            std::printf("%s,strong,%d,%d,%d,%.6f,%.6f,%.3f,%.3f\n",
+                        driver_name(pinned), n, p, trials, best, median,
+                        t1 / median, t1 / median / p);
+            std::fflush(stdout);
+        }
+    }
+
+    double t1 = 0.0;
+    for (int p = 1; p <= max_threads; p++) {
+        int n = static_cast<int>(std::lround(sizes[0] * std::cbrt(p)));
+        double best;
+        bool pinned;
+        double median = median_time(n, p, trials, &best, &pinned);
+        if (p == 1) {
+            t1 = median;
+        }
+        double work_ratio = std::pow(static_cast<double>(n) / sizes[0], 3.0);
+        double efficiency = t1 * work_ratio / (p * median);
+        std::printf("%s,weak,%d,%d,%d,%.6f,%.6f,%.3f,%.3f\n",
+                    driver_name(pinned), n, p, trials, best, median,
+                    efficiency * p, efficiency);
+        std::fflush(stdout);
+    }
+
+    free_matrices();
+    return 0;
+}
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog
+              << " [-n size] [-p pad] [-H] [-v | -s] [threads] [runs]\n"
+              << "       " << prog
+              << " --scaling [-n size] [-p pad] [-H] [max_threads] [trials] "
+                 "[size ...]\n"
+              << "  -n  matrix size (default " << DEFAULT_MATRIX_SIZE << ")\n"
+              << "  -p  extra doubles of padding per row\n"
+              << "  -H  allocate on huge pages\n"
+              << "  -v  always verify against the sequential multiply\n"
+              << "  -s  skip the sequential multiply and verification"
+              << std::endl;
 }
 
 int main(int argc, char* argv[]) {
     int num_threads = 8;  // Default number of threads
+    int num_runs = 5;     // Repetitions of each tiled benchmark
+    int size = DEFAULT_MATRIX_SIZE;
+    int pad = 0;
+    bool huge_pages = false;
+    int verify = -1;  // -1: only up to VERIFY_LIMIT
+    bool scaling = false;
+
+    static const struct option long_options[] = {
+        {"scaling", no_argument, nullptr, 'S'}, {nullptr, 0, nullptr, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:p:Hvs", long_options,
+                              nullptr)) != -1) {
+        switch (opt) {
+            case 'n': size = std::atoi(optarg); break;
+            case 'p': pad = std::atoi(optarg); break;
+            case 'H': huge_pages = true; break;
+            case 'v': verify = 1; break;
+            case 's': verify = 0; break;
+            case 'S': scaling = true; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (size <= 0 || pad < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (scaling) {
+        return run_scaling(argc - optind, argv + optind, size, pad,
+                           huge_pages);
+    }
+    if (verify < 0) {
+        verify = size <= VERIFY_LIMIT;
+    }
+    argc -= optind - 1;
+    argv += optind - 1;
 
     // Check if number of threads is provided as command line argument
     if (argc > 1) {
@@ -83,60 +365,120 @@ int main(int argc, char* argv[]) {
             num_threads = 8;
         }
     }
+    if (argc > 2) {
+        num_runs = std::atoi(argv[2]);
+        if (num_runs <= 0) {
+            std::cout << "Invalid number of runs. Using default (5)."
+                      << std::endl;
+            num_runs = 5;
+        }
+    }
 
-    std::cout << "Matrix Size: " << MATRIX_SIZE << " x " << MATRIX_SIZE
-              << std::endl;
+    const int ld = matrix_padded_ld(size, pad);
+    std::cout << "Matrix Size: " << size << " x " << size << " (row stride "
+              << ld << (huge_pages ? ", huge pages" : "") << ")" << std::endl;
     std::cout << "Number of threads: " << num_threads << std::endl;
 
-    // Set the seed for random number generation
-    std::srand(static_cast<unsigned>(std::time(nullptr)));
+    // Set the global thread count for TBB
+    tbb::global_control global_limit(
+        tbb::global_control::max_allowed_parallelism, num_threads);
+
+    if (!allocate_matrices(size, ld, huge_pages, verify)) {
+        return 1;
+    }
     initialize_matrices();
 
     // ====== Sequential multiplication ======
-    std::cout << "\nPerforming sequential matrix multiplication..."
-              << std::endl;
-    auto seq_start = std::chrono::high_resolution_clock::now();
-    sequential_matrix_mul();
-    auto seq_end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> seq_elapsed = seq_end - seq_start;
-    std::cout << "Sequential execution time: " << seq_elapsed.count()
-              << " seconds" << std::endl;
+    std::chrono::duration<double> seq_elapsed(0.0);
+    if (verify) {
+        std::cout << "\nPerforming sequential matrix multiplication..."
+                  << std::endl;
+        auto seq_start = std::chrono::high_resolution_clock::now();
+        sequential_matrix_mul(size);
+        auto seq_end = std::chrono::high_resolution_clock::now();
+        seq_elapsed = seq_end - seq_start;
+        std::cout << "Sequential execution time: " << seq_elapsed.count()
+                  << " seconds" << std::endl;
+    }
 
     // ====== Parallel multiplication with TBB ======
     std::cout << "\nPerforming parallel matrix multiplication with TBB using "
               << num_threads << " threads..." << std::endl;
 
-    // Set the global thread count for TBB
-    tbb::global_control global_limit(
-        tbb::global_control::max_allowed_parallelism, num_threads);
-
     auto par_start = std::chrono::high_resolution_clock::now();
 
     // Use TBB's parallel_for to divide the work
-    tbb::parallel_for(tbb::blocked_range<int>(0, MATRIX_SIZE),
-                      ParallelMatrixMultiply(), tbb::auto_partitioner());
+    tbb::parallel_for(tbb::blocked_range<int>(0, size),
+                      ParallelMatrixMultiply(size), tbb::auto_partitioner());
 
     auto par_end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> par_elapsed = par_end - par_start;
     std::cout << "Parallel execution time: " << par_elapsed.count()
               << " seconds" << std::endl;
 
-    // ====== Result verification ======
-    std::cout << "\nVerifying results..." << std::endl;
-    if (verify_results()) {
-        std::cout << "Results match! The parallel implementation is correct."
+    if (verify) {
+        // ====== Result verification ======
+        std::cout << "\nVerifying results..." << std::endl;
+        if (verify_results(size)) {
+            std::cout
+                << "Results match! The parallel implementation is correct."
+                << std::endl;
+        } else {
+            std::cout << "Results do not match! There is an error in the "
+                         "implementation."
+                      << std::endl;
+        }
+
+        // Calculate speedup
+        double speedup = seq_elapsed.count() / par_elapsed.count();
+        std::cout << "\nSpeedup achieved: " << speedup << "x" << std::endl;
+        std::cout << "Efficiency: " << (speedup / num_threads) * 100 << "%"
                   << std::endl;
-    } else {
-        std::cout
-            << "Results do not match! There is an error in the implementation."
-            << std::endl;
     }
 
-    // Calculate speedup
-    double speedup = seq_elapsed.count() / par_elapsed.count();
-    std::cout << "\nSpeedup achieved: " << speedup << "x" << std::endl;
-    std::cout << "Efficiency: " << (speedup / num_threads) * 100 << "%"
+    // ====== Tiled 2D multiplication ======
+    // Both kernels are i-k-j and vectorise over j. The row kernel streams
+    // all n rows of B for every row of C; the tiled kernel blocks C and B so
+    // a tile of C and the panel of B it needs stay in cache. Each variant is
+    // run num_runs times so the affinity_partitioner can replay its
+    // tile-to-thread mapping from the first run.
+    const double* A = matrixA.data;
+    const double* B = matrixB.data;
+    double* C = matrixC_parallel.data;
+    bool tiled_ok = true;
+
+    std::cout << "\nTiled 2D i-k-j kernel, auto_partitioner (" << num_runs
+              << " runs)..." << std::endl;
+    double auto_avg = time_runs("auto", num_runs, [&]() {
+        tbb_tiled_matrix_mul(A, B, C, size, ld);
+    });
+    tiled_ok = tiled_ok && (!verify || verify_results(size));
+
+    std::cout << "\nTiled 2D i-k-j kernel, affinity_partitioner (" << num_runs
+              << " runs)..." << std::endl;
+    static tbb::affinity_partitioner affinity;
+    double affinity_avg = time_runs("affinity", num_runs, [&]() {
+        tbb_tiled_matrix_mul(A, B, C, size, ld, affinity);
+    });
+    tiled_ok = tiled_ok && (!verify || verify_results(size));
+
+    if (verify) {
+        std::cout << "\nTiled results "
+                  << (tiled_ok ? "match" : "do not match")
+                  << " the sequential result." << std::endl;
+    }
+    // Speedups are relative to the sequential run, or to the row-parallel
+    // kernel when the sequential reference was skipped
+    double base = verify ? seq_elapsed.count() : par_elapsed.count();
+    std::cout << "\nRow-parallel kernel:          " << par_elapsed.count()
+              << " seconds" << std::endl;
+    std::cout << "Tiled, auto_partitioner:      " << auto_avg
+              << " seconds (avg), speedup " << base / auto_avg << "x"
+              << std::endl;
+    std::cout << "Tiled, affinity_partitioner:  " << affinity_avg
+              << " seconds (avg), speedup " << base / affinity_avg << "x"
               << std::endl;
 
-    return 0;
+    free_matrices();
+    return tiled_ok ? 0 : 1;
 }
\ No newline at end of file
@@ -1,143 +1,633 @@
+#define _GNU_SOURCE
+#include <getopt.h>
 #include <math.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
 
-#define MATRIX_SIZE 1024
+#include "aligned_matrix.h"
+#include "matrix_compare.h"
+#include "thread_pool.h"
+#include "topology.h"
 
-// Matrix data structures
-double matrixA[MATRIX_SIZE][MATRIX_SIZE];
-double matrixB[MATRIX_SIZE][MATRIX_SIZE];
-double matrixC_sequential[MATRIX_SIZE][MATRIX_SIZE];
-double matrixC_parallel[MATRIX_SIZE][MATRIX_SIZE];
+#define DEFAULT_MATRIX_SIZE 1024
+// Above this size the O(n^3) sequential reference is skipped unless -v
+#define VERIFY_LIMIT 2048
+// An element matches if |par - seq| <= VERIFY_ABS_TOL + VERIFY_REL_TOL*|seq|
+#define VERIFY_ABS_TOL 1e-6
+#define VERIFY_REL_TOL 1e-9
+
+// Matrix data structures, all sized and laid out at run time
+AlignedMatrix matrixA;
+AlignedMatrix matrixB;
+AlignedMatrix matrixC_sequential;
+AlignedMatrix matrixC_parallel;
+
+// Element (i, j) of an AlignedMatrix
+#define AT(m, i, j) ((m).data[(size_t)(i) * (m).ld + (j)])
 
 // Thread function arguments
 typedef struct {
     int start_row;
     int end_row;
+    int n;  // multiply the leading n x n blocks
 } ThreadArgs;
 
-// Initialize matrix with random values
-void initialize_matrices() {
-    for (int i = 0; i < MATRIX_SIZE; i++) {
-        for (int j = 0; j < MATRIX_SIZE; j++) {
-            matrixA[i][j] = (double)rand() / RAND_MAX;
-            matrixB[i][j] = (double)rand() / RAND_MAX;
-            matrixC_sequential[i][j] = 0.0;
-            matrixC_parallel[i][j] = 0.0;
-        }
+// Allocate all four matrices as n x n with row stride ld. The sequential
+// result is only needed when verifying.
+int allocate_matrices(int n, int ld, int huge_pages, int with_reference) {
+    if (matrix_alloc(&matrixA, n, n, ld, huge_pages) != 0 ||
+        matrix_alloc(&matrixB, n, n, ld, huge_pages) != 0 ||
+        matrix_alloc(&matrixC_parallel, n, n, ld, huge_pages) != 0 ||
+        (with_reference &&
+         matrix_alloc(&matrixC_sequential, n, n, ld, huge_pages) != 0)) {
+        fprintf(stderr, "Cannot allocate %d x %d matrices\n", n, n);
+        return -1;
+    }
+    return 0;
+}
+
+void free_matrices() {
+    matrix_free(&matrixA);
+    matrix_free(&matrixB);
+    matrix_free(&matrixC_sequential);
+    matrix_free(&matrixC_parallel);
+}
+
+// First-touch a block of rows of every matrix from the worker that owns it
+static void initialize_rows(void* ctx, long begin, long end, int worker) {
+    uint64_t seed = *(const uint64_t*)ctx;
+    (void)worker;
+    matrix_fill_rows(&matrixA, (int)begin, (int)end, seed);
+    matrix_fill_rows(&matrixB, (int)begin, (int)end, ~seed);
+    matrix_zero_rows(&matrixC_parallel, (int)begin, (int)end);
+    if (matrixC_sequential.data != NULL) {
+        matrix_zero_rows(&matrixC_sequential, (int)begin, (int)end);
     }
 }
 
+// Initialize matrix with random values, one block of rows per pool thread
+void initialize_matrices(ThreadPool* pool) {
+    uint64_t seed = (uint64_t)time(NULL);
+    long rows = matrixA.rows;
+    long rows_per_thread = (rows + pool_size(pool) - 1) / pool_size(pool);
+    pool_parallel_for(pool, 0, rows, rows_per_thread, initialize_rows, &seed);
+}
+
 // Sequential matrix multiplication
-void sequential_matrix_mul() {
-    for (int i = 0; i < MATRIX_SIZE; i++) {
-        for (int j = 0; j < MATRIX_SIZE; j++) {
-            matrixC_sequential[i][j] = 0.0;
-            for (int k = 0; k < MATRIX_SIZE; k++) {
-                matrixC_sequential[i][j] += matrixA[i][k] * matrixB[k][j];
+void sequential_matrix_mul(int n) {
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            AT(matrixC_sequential, i, j) = 0.0;
+            for (int k = 0; k < n; k++) {
+                AT(matrixC_sequential, i, j) +=
+                    AT(matrixA, i, k) * AT(matrixB, k, j);
+            }
+        }
+    }
+}
+
+// Rows [start_row, end_row) of the parallel product, i-j-k order
+void multiply_rows(int start_row, int end_row, int n) {
+    for (int i = start_row; i < end_row; i++) {
+        for (int j = 0; j < n; j++) {
+            AT(matrixC_parallel, i, j) = 0.0;
+            for (int k = 0; k < n; k++) {
+                AT(matrixC_parallel, i, j) +=
+                    AT(matrixA, i, k) * AT(matrixB, k, j);
+            }
+        }
+    }
+}
+
+// Cache-blocked kernel. B is walked in KC x NC panels that stay in L2
+// while a thread's rows stream over them. Each MR x NR block of C is held
+// in vector registers across the whole k loop and updated with
+// broadcast(A[i][k]) * B[k][j..j+NR], so C is loaded and stored once per K
+// panel instead of once per multiply-add.
+#define KC 256
+#define NC 256
+#define MR 4
+#define NR 8
+
+// GCC vector extension sized to one hardware register. Written explicitly
+// because left to itself the compiler vectorises the micro-kernel along k
+// instead of along the NR columns.
+#if defined(__AVX__)
+#define VL 4
+#else
+#define VL 2
+#endif
+typedef double vecd __attribute__((vector_size(VL * 8), aligned(8)));
+#define VN (NR / VL)
+
+// C[i.., j..] (+)= A[i.., k0..k1] * B[k0..k1, j..]; full MR x NR block
+static inline void micro_kernel(int i, int j, int k0, int k1) {
+    vecd acc[MR][VN];
+    for (int r = 0; r < MR; r++) {
+        for (int v = 0; v < VN; v++) {
+            acc[r][v] = k0 == 0 ? (vecd){0.0}
+                                : *(const vecd*)&AT(matrixC_parallel, i + r,
+                                                    j + VL * v);
+        }
+    }
+    for (int k = k0; k < k1; k++) {
+        const vecd* b = (const vecd*)&AT(matrixB, k, j);
+        for (int r = 0; r < MR; r++) {
+            const double a = AT(matrixA, i + r, k);
+            for (int v = 0; v < VN; v++) {
+                acc[r][v] += a * b[v];
+            }
+        }
+    }
+    for (int r = 0; r < MR; r++) {
+        for (int v = 0; v < VN; v++) {
+            *(vecd*)&AT(matrixC_parallel, i + r, j + VL * v) = acc[r][v];
+        }
+    }
+}
+
+// Same for the ragged mr x nr blocks at the bottom and right edges
+static void edge_kernel(int i, int j, int mr, int nr, int k0, int k1) {
+    double acc[MR][NR];
+    for (int r = 0; r < mr; r++) {
+        for (int c = 0; c < nr; c++) {
+            acc[r][c] = k0 == 0 ? 0.0 : AT(matrixC_parallel, i + r, j + c);
+        }
+    }
+    for (int k = k0; k < k1; k++) {
+        const double* b = &AT(matrixB, k, j);
+        for (int r = 0; r < mr; r++) {
+            const double a = AT(matrixA, i + r, k);
+            for (int c = 0; c < nr; c++) {
+                acc[r][c] += a * b[c];
+            }
+        }
+    }
+    for (int r = 0; r < mr; r++) {
+        for (int c = 0; c < nr; c++) {
+            AT(matrixC_parallel, i + r, j + c) = acc[r][c];
+        }
+    }
+}
+
+void multiply_rows_blocked(int start_row, int end_row, int n) {
+    for (int k0 = 0; k0 < n; k0 += KC) {
+        int k1 = k0 + KC < n ? k0 + KC : n;
+        for (int j0 = 0; j0 < n; j0 += NC) {
+            int j1 = j0 + NC < n ? j0 + NC : n;
+            for (int i = start_row; i < end_row; i += MR) {
+                int mr = end_row - i < MR ? end_row - i : MR;
+                for (int j = j0; j < j1; j += NR) {
+                    int nr = j1 - j < NR ? j1 - j : NR;
+                    if (mr == MR && nr == NR) {
+                        micro_kernel(i, j, k0, k1);
+                    } else {
+                        edge_kernel(i, j, mr, nr, k0, k1);
+                    }
+                }
             }
         }
     }
 }
 
+// Kernel used by both the create/join and the pool paths (-k)
+typedef void (*RowKernel)(int start_row, int end_row, int n);
+RowKernel row_kernel = multiply_rows;
+const char* kernel_name = "naive";
+
 // Thread function for parallel matrix multiplication
 void* parallel_matrix_mul(void* arg) {
     ThreadArgs* args = (ThreadArgs*)arg;
-    int start_row = args->start_row;
-    int end_row = args->end_row;
+    row_kernel(args->start_row, args->end_row, args->n);
+    pthread_exit(NULL);
+}
 
-    for (int i = start_row; i < end_row; i++) {
-        for (int j = 0; j < MATRIX_SIZE; j++) {
-            matrixC_parallel[i][j] = 0.0;
-            for (int k = 0; k < MATRIX_SIZE; k++) {
-                matrixC_parallel[i][j] += matrixA[i][k] * matrixB[k][j];
-            }
+// Pool task: a chunk of rows; ctx points at the matrix size
+static void multiply_chunk(void* ctx, long begin, long end, int worker) {
+    (void)worker;
+    row_kernel((int)begin, (int)end, *(const int*)ctx);
+}
+
+// CPUs to pin threads to, in placement order (see -a); NULL leaves
+// placement to the OS
+int* pin_cpus = NULL;
+int num_pin_cpus = 0;
+PinPolicy pin_policy = PIN_NONE;
+
+// Barrier that ends each pool phase (see -b)
+BarrierKind pool_barrier = BARRIER_CENTRAL;
+
+// Discover the topology, print it to `out` and build the CPU order for
+// `policy`. Returns 0 on success.
+static int setup_pinning(PinPolicy policy, int num_threads, FILE* out) {
+    CpuTopology topo;
+    pin_policy = policy;
+    if (policy == PIN_NONE) {
+        return 0;
+    }
+    if (topology_discover(&topo) != 0) {
+        fprintf(stderr, "Cannot read the CPU topology\n");
+        return -1;
+    }
+    topology_print(out, &topo);
+    pin_cpus = malloc(topo.num_cpus * sizeof(int));
+    num_pin_cpus = pin_cpus != NULL
+                       ? topology_cpu_order(&topo, policy, pin_cpus)
+                       : 0;
+    if (num_pin_cpus == 0) {
+        // Also covers a failed allocation inside topology_cpu_order; the
+        // callers pin thread i to pin_cpus[i % num_pin_cpus]
+        fprintf(stderr, "Cannot build the CPU order for pinning\n");
+        free(pin_cpus);
+        pin_cpus = NULL;
+        topology_free(&topo);
+        return -1;
+    }
+
+    fprintf(out, "Pinning (%s):", pin_policy_name(policy));
+    for (int i = 0; i < num_threads && i < num_pin_cpus; i++) {
+        fprintf(out, " %d", pin_cpus[i]);
+    }
+    fputc('\n', out);
+    if (num_threads > num_pin_cpus) {
+        fprintf(out, "Note: %d threads on %d CPUs, some will share\n",
+                num_threads, num_pin_cpus);
+    }
+    topology_free(&topo);
+    return 0;
+}
+
+// Multiply the leading n x n blocks with num_threads threads and return the
+// wall time in seconds. Thread i is pinned to pin_cpus[i % num_pin_cpus]
+// when a pinning policy is set.
+double timed_parallel_mul(int n, int num_threads) {
+    pthread_t threads[num_threads];
+    ThreadArgs thread_args[num_threads];
+    int rows_per_thread = n / num_threads;
+    struct timespec start_time, end_time;
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    for (int i = 0; i < num_threads; i++) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (pin_cpus != NULL) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(pin_cpus[i % num_pin_cpus], &cpus);
+            pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
         }
+        thread_args[i].start_row = i * rows_per_thread;
+        thread_args[i].end_row =
+            (i == num_threads - 1) ? n : (i + 1) * rows_per_thread;
+        thread_args[i].n = n;
+        pthread_create(&threads[i], &attr, parallel_matrix_mul,
+                       (void*)&thread_args[i]);
+        pthread_attr_destroy(&attr);
     }
 
-    pthread_exit(NULL);
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    return (end_time.tv_sec - start_time.tv_sec) +
+           (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+}
+
+// Same product on a persistent pool. Rows are handed out in chunks of about
+// an eighth of a thread's share, so early finishers take over the tail;
+// chunks are whole MR-row strips so the blocked kernel rarely hits edges.
+double timed_pool_mul(ThreadPool* pool, int n) {
+    long chunk = n / (8L * pool_size(pool));
+    chunk = (chunk + MR - 1) / MR * MR;
+    struct timespec start_time, end_time;
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    pool_parallel_for(pool, 0, n, chunk > 0 ? chunk : MR, multiply_chunk,
+                      &n);
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    return (end_time.tv_sec - start_time.tv_sec) +
+           (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+}
+
+// Verification job: one partial result per pool worker, merged at the end
+typedef struct {
+    MatrixCompareResult* parts;
+    int n;
+} CompareJob;
+
+// Pool task: compare a chunk of rows into the calling worker's slot
+static void compare_chunk(void* ctx, long begin, long end, int worker) {
+    CompareJob* job = (CompareJob*)ctx;
+    matrix_compare_rows(matrixC_sequential.data, matrixC_sequential.ld,
+                        matrixC_parallel.data, matrixC_parallel.ld,
+                        (int)begin, (int)end, job->n, VERIFY_ABS_TOL,
+                        VERIFY_REL_TOL, &job->parts[worker]);
+}
+
+// Verify results: compare the leading n x n blocks in parallel on the pool
+// and print the error summary. Returns 1 if every element is in tolerance.
+int verify_results(ThreadPool* pool, int n) {
+    int workers = pool_size(pool);
+    MatrixCompareResult parts[workers];
+    MatrixCompareResult total;
+    CompareJob job = {parts, n};
+    long chunk = n / (8L * workers);
+
+    for (int w = 0; w < workers; w++) {
+        matrix_compare_init(&parts[w]);
+    }
+    pool_parallel_for(pool, 0, n, chunk > 0 ? chunk : 1, compare_chunk,
+                      &job);
+    matrix_compare_init(&total);
+    for (int w = 0; w < workers; w++) {
+        matrix_compare_merge(&total, &parts[w]);
+    }
+    matrix_compare_print(stdout, &total);
+    return matrix_compare_ok(&total);
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
 }
 
-// Verify results
-int verify_results() {
-    for (int i = 0; i < MATRIX_SIZE; i++) {
-        for (int j = 0; j < MATRIX_SIZE; j++) {
-            if (fabs(matrixC_sequential[i][j] - matrixC_parallel[i][j]) >
-                0.000001) {
-                return 0;  // Not equal
+// Run `trials` pinned multiplications; return the median, store the best
+static double median_time(int n, int num_threads, int trials, double* best) {
+    double times[trials];
+    ThreadPool* pool = pool_create(num_threads, pin_cpus, num_pin_cpus,
+                                   pool_barrier);
+    for (int t = 0; t < trials; t++) {
+        times[t] = timed_pool_mul(pool, n);
+    }
+    pool_destroy(pool);
+    qsort(times, trials, sizeof(double), compare_double);
+    *best = times[0];
+    return times[trials / 2];
+}
+
+// Scaling sweep over 1..max_threads threads, written as CSV to stdout.
+// Strong scaling keeps each size fixed: speedup = T(1) / T(p). Weak scaling
+// grows the first size with n ~ cbrt(p) so work per thread stays constant,
+// and reports efficiency = T(1) * (W(p) / W(1)) / (p * T(p)).
+// The matrices are allocated once for the largest size; smaller runs use
+// their leading blocks.
+int run_scaling(int argc, char* argv[], int size, int pad, int huge_pages) {
+    int max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int trials = 5;
+    int sizes[argc > 2 ? argc - 2 : 1];
+    int num_sizes = 1;
+    sizes[0] = size;
+
+    if (argc > 0) {
+        max_threads = atoi(argv[0]);
+    }
+    if (argc > 1) {
+        trials = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        num_sizes = argc - 2;
+        for (int s = 0; s < num_sizes; s++) {
+            sizes[s] = atoi(argv[s + 2]);
+            if (sizes[s] <= 0) {
+                fprintf(stderr, "Sizes must be positive\n");
+                return 1;
+            }
+        }
+    }
+    if (max_threads <= 0 || trials <= 0) {
+        fprintf(stderr,
+                "Usage: matrix_mul --scaling [max_threads] [trials] "
+                "[size ...]\n");
+        return 1;
+    }
+
+    int max_size = (int)lround(sizes[0] * cbrt((double)max_threads));
+    for (int s = 0; s < num_sizes; s++) {
+        max_size = sizes[s] > max_size ? sizes[s] : max_size;
+    }
+    if (allocate_matrices(max_size, matrix_padded_ld(max_size, pad),
+                          huge_pages, 0) != 0) {
+        return 1;
+    }
+    ThreadPool* init_pool =
+        pool_create(max_threads, pin_cpus, num_pin_cpus, pool_barrier);
+    initialize_matrices(init_pool);
+    pool_destroy(init_pool);
+
+    printf(
+        "driver,scaling,size,threads,trials,best_s,median_s,speedup,"
+        "efficiency\n");
+    for (int s = 0; s < num_sizes; s++) {
+        double t1 = 0.0;
+        for (int p = 1; p <= max_threads; p++) {
+            double best;
+            double median = median_time(sizes[s], p, trials, &best);
+            if (p == 1) {
+                t1 = median;
             }
+            printf("pthreads-%s-%s,strong,%d,%d,%d,%.6f,%.6f,%.3f,%.3f\n",
+                   kernel_name, pin_policy_name(pin_policy), sizes[s], p,
+                   trials, best, median, t1 / median, t1 / median / p);
+            fflush(stdout);
+        }
+    }
+
+    double t1 = 0.0;
+    for (int p = 1; p <= max_threads; p++) {
+        int n = (int)lround(sizes[0] * cbrt((double)p));
+        double best;
+        double median = median_time(n, p, trials, &best);
+        if (p == 1) {
+            t1 = median;
         }
+        double work_ratio = pow((double)n / sizes[0], 3.0);
+        double efficiency = t1 * work_ratio / (p * median);
+        printf("pthreads-%s-%s,weak,%d,%d,%d,%.6f,%.6f,%.3f,%.3f\n",
+               kernel_name, pin_policy_name(pin_policy), n, p, trials, best,
+               median, efficiency * p, efficiency);
+        fflush(stdout);
     }
-    return 1;  // Equal
+
+    free_matrices();
+    return 0;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [-n size] [-p pad] [-H] [-k kernel] [-a policy] "
+            "[-b barrier] [-v | -s] [-r runs] [threads]\n"
+            "       %s --scaling [-n size] [-p pad] [-H] [-k kernel] "
+            "[-a policy] [-b barrier] [max_threads] [trials] [size ...]\n"
+            "  -n  matrix size (default %d)\n"
+            "  -p  extra doubles of padding per row\n"
+            "  -H  allocate on huge pages\n"
+            "  -k  naive (i-j-k, default) or blocked (i-k-j, register "
+            "blocked)\n"
+            "  -a  pin threads: none, compact, scatter or cores (one per "
+            "core);\n"
+            "      default none, compact with --scaling\n"
+            "  -b  pool barrier: central (default), tournament, "
+            "dissemination\n"
+            "      or pthread\n"
+            "  -v  always verify against the sequential multiply\n"
+            "  -s  skip the sequential multiply and verification\n"
+            "  -r  time this many repeated products, pool vs create/join\n",
+            prog, prog, DEFAULT_MATRIX_SIZE);
 }
 
 int main(int argc, char* argv[]) {
     int num_threads = 8;  // Default number of threads
+    int size = DEFAULT_MATRIX_SIZE;
+    int pad = 0;
+    int huge_pages = 0;
+    int verify = -1;  // -1: only up to VERIFY_LIMIT
+    int scaling = 0;
+    int repeat_runs = 0;
+    int policy_set = 0;
+    PinPolicy policy = PIN_NONE;
+
+    static const struct option long_options[] = {
+        {"scaling", no_argument, NULL, 'S'}, {NULL, 0, NULL, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:p:Hk:a:b:vsr:", long_options,
+                              NULL)) != -1) {
+        switch (opt) {
+            case 'n': size = atoi(optarg); break;
+            case 'p': pad = atoi(optarg); break;
+            case 'H': huge_pages = 1; break;
+            case 'k':
+                if (strcmp(optarg, "blocked") == 0) {
+                    row_kernel = multiply_rows_blocked;
+                } else if (strcmp(optarg, "naive") != 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                kernel_name = optarg;
+                break;
+            case 'a':
+                if (pin_policy_parse(optarg, &policy) != 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                policy_set = 1;
+                break;
+            case 'b':
+                if (barrier_kind_parse(optarg, &pool_barrier) != 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'v': verify = 1; break;
+            case 's': verify = 0; break;
+            case 'r': repeat_runs = atoi(optarg); break;
+            case 'S': scaling = 1; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (size <= 0 || pad < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (scaling) {
+        // Unpinned threads migrate between trials, so sweeps pin by default
+        int max_threads = optind < argc ? atoi(argv[optind])
+                                        : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (setup_pinning(policy_set ? policy : PIN_COMPACT, max_threads,
+                          stderr) != 0) {
+            return 1;
+        }
+        int status = run_scaling(argc - optind, argv + optind, size, pad,
+                                 huge_pages);
+        free(pin_cpus);
+        return status;
+    }
+    if (verify < 0) {
+        verify = size <= VERIFY_LIMIT;
+    }
 
     // Check if number of threads is provided as command line argument
-    if (argc > 1) {
-        num_threads = atoi(argv[1]);
+    if (optind < argc) {
+        num_threads = atoi(argv[optind]);
         if (num_threads <= 0) {
             printf("Invalid number of threads. Using default (4).\n");
             num_threads = 4;
         }
     }
 
-    printf("Matrix Size: %d x %d\n", MATRIX_SIZE, MATRIX_SIZE);
+    int ld = matrix_padded_ld(size, pad);
+    printf("Matrix Size: %d x %d (row stride %d%s)\n", size, size, ld,
+           huge_pages ? ", huge pages" : "");
     printf("Number of threads: %d\n", num_threads);
+    printf("Kernel: %s\n", kernel_name);
+    printf("Pool barrier: %s\n", barrier_kind_name(pool_barrier));
+    if (setup_pinning(policy, num_threads, stdout) != 0) {
+        return 1;
+    }
 
-    srand(time(NULL));
-    initialize_matrices();
+    if (allocate_matrices(size, ld, huge_pages, verify) != 0) {
+        return 1;
+    }
+    ThreadPool* pool = pool_create(num_threads, pin_cpus, num_pin_cpus,
+                                   pool_barrier);
+    initialize_matrices(pool);
 
     // ====== 新的时间测量变量 ======
     struct timespec start_time, end_time;
     double elapsed_time;
 
     // ====== 串行乘法 ======
-    printf("\nPerforming sequential matrix multiplication...\n");
-    clock_gettime(CLOCK_MONOTONIC, &start_time);
-    sequential_matrix_mul();
-    clock_gettime(CLOCK_MONOTONIC, &end_time);
-    elapsed_time = (end_time.tv_sec - start_time.tv_sec) +
-                   (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
-    printf("Sequential execution time: %.6f seconds\n", elapsed_time);
+    if (verify) {
+        printf("\nPerforming sequential matrix multiplication...\n");
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+        sequential_matrix_mul(size);
+        clock_gettime(CLOCK_MONOTONIC, &end_time);
+        elapsed_time = (end_time.tv_sec - start_time.tv_sec) +
+                       (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+        printf("Sequential execution time: %.6f seconds\n", elapsed_time);
+    }
 
     // ====== 并行乘法 ======
     printf("\nPerforming parallel matrix multiplication with %d threads...\n",
            num_threads);
-    pthread_t threads[num_threads];
-    ThreadArgs thread_args[num_threads];
-    int rows_per_thread = MATRIX_SIZE / num_threads;
-
-    clock_gettime(CLOCK_MONOTONIC, &start_time);
-
-    for (int i = 0; i < num_threads; i++) {
-        thread_args[i].start_row = i * rows_per_thread;
-        thread_args[i].end_row =
-            (i == num_threads - 1) ? MATRIX_SIZE : (i + 1) * rows_per_thread;
-        pthread_create(&threads[i], NULL, parallel_matrix_mul,
-                       (void*)&thread_args[i]);
-    }
-
-    for (int i = 0; i < num_threads; i++) {
-        pthread_join(threads[i], NULL);
-    }
-
-    clock_gettime(CLOCK_MONOTONIC, &end_time);
-    elapsed_time = (end_time.tv_sec - start_time.tv_sec) +
-                   (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+    elapsed_time = timed_pool_mul(pool, size);
     printf("Parallel execution time: %.6f seconds\n", elapsed_time);
 
     // ====== 结果验证 ======
-    printf("\nVerifying results...\n");
-    if (verify_results()) {
-        printf("Results match! The parallel implementation is correct.\n");
-    } else {
-        printf(
-            "Results do not match! There is an error in the implementation.\n");
+    if (verify) {
+        printf("\nVerifying results...\n");
+        if (verify_results(pool, size)) {
+            printf("Results match! The parallel implementation is correct.\n");
+        } else {
+            printf(
+                "Results do not match! There is an error in the "
+                "implementation.\n");
+        }
+    }
+
+    // Repeated products: thread start-up and the static split are paid on
+    // every run with create/join, once with the pool
+    if (repeat_runs > 0) {
+        double create_join = 0.0, pooled = 0.0;
+        printf("\nRepeating the product %d times...\n", repeat_runs);
+        for (int r = 0; r < repeat_runs; r++) {
+            create_join += timed_parallel_mul(size, num_threads);
+            pooled += timed_pool_mul(pool, size);
+        }
+        printf("Create/join per run: %.6f seconds\n",
+               create_join / repeat_runs);
+        printf("Thread pool per run: %.6f seconds (%.2fx)\n",
+               pooled / repeat_runs, create_join / pooled);
     }
 
+    pool_destroy(pool);
+    free_matrices();
+    free(pin_cpus);
     return 0;
 }
@@ -0,0 +1,172 @@
+#define _GNU_SOURCE
+#include "thread_pool.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "flag.h"
+#include "spin.h"
+
+typedef struct {
+    _Alignas(CACHE_LINE) ThreadPool* pool;
+    int id;
+} Worker;
+
+struct ThreadPool {
+    int num_threads;
+    int pinned;
+    cpu_set_t caller_affinity;
+    pthread_t* threads;
+    Worker* workers;
+
+    // Current phase, written by the caller before bumping `generation`
+    pool_task_fn fn;
+    void* ctx;
+    long end;
+    long chunk;
+
+    _Alignas(CACHE_LINE) atomic_long next;  // first index not yet handed out
+    Flag generation;  // bumped once per phase, workers park on it
+    int stop;
+
+    Barrier* done;  // end of each phase
+};
+
+static void run_chunks(ThreadPool* pool, int worker) {
+    for (;;) {
+        long begin = atomic_fetch_add_explicit(&pool->next, pool->chunk,
+                                               memory_order_relaxed);
+        if (begin >= pool->end) {
+            return;
+        }
+        long end = begin + pool->chunk < pool->end ? begin + pool->chunk
+                                                   : pool->end;
+        pool->fn(pool->ctx, begin, end, worker);
+    }
+}
+
+static void* worker_main(void* arg) {
+    Worker* self = (Worker*)arg;
+    ThreadPool* pool = self->pool;
+    int seen = 0;
+
+    for (;;) {
+        // The caller cannot start another phase before this worker reaches
+        // the done barrier, so the next generation is always seen + 1
+        flag_await(&pool->generation, ++seen);
+        if (pool->stop) {
+            return NULL;
+        }
+        run_chunks(pool, self->id);
+        barrier_wait(pool->done, self->id);
+    }
+}
+
+static void pin_to_cpu(pthread_t thread, int cpu) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+}
+
+ThreadPool* pool_create(int num_threads, const int* cpus, int num_cpus,
+                        BarrierKind barrier) {
+    int pin = cpus != NULL && num_cpus > 0;
+    ThreadPool* pool;
+    if (num_threads < 1 ||
+        posix_memalign((void**)&pool, CACHE_LINE, sizeof(*pool)) != 0) {
+        return NULL;
+    }
+    pool->num_threads = num_threads;
+    pool->pinned = pin;
+    pool->threads = malloc(num_threads * sizeof(pthread_t));
+    if (posix_memalign((void**)&pool->workers, CACHE_LINE,
+                       num_threads * sizeof(Worker)) != 0) {
+        pool->workers = NULL;
+    }
+    pool->done = barrier_create(barrier, num_threads);
+    if (pool->threads == NULL || pool->workers == NULL || pool->done == NULL) {
+        barrier_destroy(pool->done);
+        free(pool->threads);
+        free(pool->workers);
+        free(pool);
+        return NULL;
+    }
+    pool->fn = NULL;
+    pool->ctx = NULL;
+    pool->end = 0;
+    pool->chunk = 1;
+    atomic_init(&pool->next, 0);
+    flag_init(&pool->generation, 0);
+    pool->stop = 0;
+
+    if (pin) {
+        pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                               &pool->caller_affinity);
+        pin_to_cpu(pthread_self(), cpus[0]);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].id = i;
+        if (i == 0) {
+            continue;  // the caller
+        }
+        if (pthread_create(&pool->threads[i], NULL, worker_main,
+                           &pool->workers[i]) != 0) {
+            // Stop the workers started so far; pool_destroy joins threads
+            // 1..num_threads-1, so shrink the pool to those
+            pool->num_threads = i;
+            pool_destroy(pool);
+            return NULL;
+        }
+        if (pin) {
+            pin_to_cpu(pool->threads[i], cpus[i % num_cpus]);
+        }
+    }
+    return pool;
+}
+
+void pool_parallel_for(ThreadPool* pool, long begin, long end, long chunk,
+                       pool_task_fn fn, void* ctx) {
+    if (begin >= end) {
+        return;
+    }
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->end = end;
+    pool->chunk = chunk > 0 ? chunk : 1;
+    atomic_store_explicit(&pool->next, begin, memory_order_relaxed);
+
+    // The store of the new generation publishes the fields above
+    int generation = atomic_load_explicit(&pool->generation.value,
+                                          memory_order_relaxed);
+    flag_set(&pool->generation, generation + 1);
+
+    run_chunks(pool, 0);
+    barrier_wait(pool->done, 0);
+}
+
+int pool_size(const ThreadPool* pool) { return pool->num_threads; }
+
+void pool_destroy(ThreadPool* pool) {
+    if (pool == NULL) {
+        return;
+    }
+    pool->stop = 1;
+    int generation = atomic_load_explicit(&pool->generation.value,
+                                          memory_order_relaxed);
+    flag_set(&pool->generation, generation + 1);
+    for (int i = 1; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    if (pool->pinned) {
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                               &pool->caller_affinity);
+    }
+    barrier_destroy(pool->done);
+    free(pool->threads);
+    free(pool->workers);
+    free(pool);
+}
@@ -0,0 +1,39 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// Persistent worker pool for fork-join loops.
+//
+// Threads are created once by pool_create and parked between phases, so a
+// parallel loop costs a wake-up and a barrier instead of a pthread_create and
+// pthread_join per thread. The calling thread takes part as worker 0.
+//
+// pool_parallel_for hands out [begin, end) in chunks from a shared atomic
+// counter: a worker that finishes early just takes the next chunk, so no
+// thread is stuck with a fixed, larger share. The phase ends with a barrier
+// from ../sync/barrier.h; the spinning ones cost far less per phase than
+// pthread_barrier_t when phases are short.
+
+#include "barrier.h"
+
+// Loop body: process [begin, end) on worker `worker` (0..size-1)
+typedef void (*pool_task_fn)(void* ctx, long begin, long end, int worker);
+
+typedef struct ThreadPool ThreadPool;
+
+// Start num_threads - 1 workers. With a CPU list (see topology.h), worker i
+// and the caller as worker 0 are bound to cpus[i % num_cpus] until
+// pool_destroy. Pass NULL to leave placement to the OS. Each phase ends
+// with a barrier of the given kind.
+ThreadPool* pool_create(int num_threads, const int* cpus, int num_cpus,
+                        BarrierKind barrier);
+
+// Run fn over [begin, end) in chunks of `chunk` and return when all chunks
+// are done. Not reentrant: call from the thread that created the pool.
+void pool_parallel_for(ThreadPool* pool, long begin, long end, long chunk,
+                       pool_task_fn fn, void* ctx);
+
+int pool_size(const ThreadPool* pool);
+
+void pool_destroy(ThreadPool* pool);
+
+#endif  // THREAD_POOL_H
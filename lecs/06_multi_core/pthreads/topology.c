@@ -0,0 +1,166 @@
+#define _GNU_SOURCE
+#include "topology.h"
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* const policy_names[] = {"none", "compact", "scatter",
+                                           "cores"};
+
+// Read a single integer from a sysfs file, or return fallback
+static int read_sysfs_int(int cpu, const char* name, int fallback) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s",
+             cpu, name);
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        return fallback;
+    }
+    int value;
+    if (fscanf(f, "%d", &value) != 1) {
+        value = fallback;
+    }
+    fclose(f);
+    return value;
+}
+
+static int compare_compact(const void* a, const void* b) {
+    const CpuInfo* x = (const CpuInfo*)a;
+    const CpuInfo* y = (const CpuInfo*)b;
+    if (x->package != y->package) {
+        return x->package - y->package;
+    }
+    if (x->core != y->core) {
+        return x->core - y->core;
+    }
+    return x->cpu - y->cpu;
+}
+
+static int compare_scatter(const void* a, const void* b) {
+    const CpuInfo* x = (const CpuInfo*)a;
+    const CpuInfo* y = (const CpuInfo*)b;
+    if (x->smt != y->smt) {
+        return x->smt - y->smt;
+    }
+    if (x->core_slot != y->core_slot) {
+        return x->core_slot - y->core_slot;
+    }
+    return x->package - y->package;
+}
+
+int topology_discover(CpuTopology* topo) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return -1;
+    }
+    topo->num_cpus = CPU_COUNT(&allowed);
+    topo->cpus = malloc(topo->num_cpus * sizeof(CpuInfo));
+    if (topo->cpus == NULL) {
+        return -1;
+    }
+
+    int n = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && n < topo->num_cpus; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        topo->cpus[n].cpu = cpu;
+        topo->cpus[n].package = read_sysfs_int(cpu, "physical_package_id", 0);
+        topo->cpus[n].core = read_sysfs_int(cpu, "core_id", cpu);
+        n++;
+    }
+    qsort(topo->cpus, n, sizeof(CpuInfo), compare_compact);
+
+    // Siblings are now adjacent: number the hardware threads of each core
+    // and the cores of each package
+    topo->num_cores = 0;
+    topo->num_packages = 0;
+    int slot = 0;
+    for (int i = 0; i < n; i++) {
+        CpuInfo* c = &topo->cpus[i];
+        const CpuInfo* prev = i > 0 ? &topo->cpus[i - 1] : NULL;
+        if (prev == NULL || prev->package != c->package) {
+            topo->num_packages++;
+            topo->num_cores++;
+            slot = 0;
+            c->smt = 0;
+        } else if (prev->core != c->core) {
+            topo->num_cores++;
+            slot++;
+            c->smt = 0;
+        } else {
+            c->smt = prev->smt + 1;
+        }
+        c->core_slot = slot;
+    }
+    return 0;
+}
+
+void topology_free(CpuTopology* topo) {
+    free(topo->cpus);
+    topo->cpus = NULL;
+    topo->num_cpus = 0;
+}
+
+void topology_print(FILE* out, const CpuTopology* topo) {
+    fprintf(out, "Topology: %d package(s), %d core(s), %d CPU(s)\n",
+            topo->num_packages, topo->num_cores, topo->num_cpus);
+    for (int i = 0; i < topo->num_cpus; i++) {
+        const CpuInfo* c = &topo->cpus[i];
+        if (i == 0 || c->package != topo->cpus[i - 1].package) {
+            fprintf(out, "  package %d:", c->package);
+        }
+        // Cores as CPU lists, siblings joined by commas
+        fprintf(out, "%s%d", c->smt == 0 ? " " : ",", c->cpu);
+        if (i + 1 == topo->num_cpus ||
+            topo->cpus[i + 1].package != c->package) {
+            fputc('\n', out);
+        }
+    }
+}
+
+int topology_cpu_order(const CpuTopology* topo, PinPolicy policy, int* order) {
+    int n = 0;
+    switch (policy) {
+        case PIN_NONE: break;
+        case PIN_COMPACT:
+            for (int i = 0; i < topo->num_cpus; i++) {
+                order[n++] = topo->cpus[i].cpu;
+            }
+            break;
+        case PIN_CORES:
+            for (int i = 0; i < topo->num_cpus; i++) {
+                if (topo->cpus[i].smt == 0) {
+                    order[n++] = topo->cpus[i].cpu;
+                }
+            }
+            break;
+        case PIN_SCATTER: {
+            CpuInfo* sorted = malloc(topo->num_cpus * sizeof(CpuInfo));
+            if (sorted == NULL) {
+                break;
+            }
+            memcpy(sorted, topo->cpus, topo->num_cpus * sizeof(CpuInfo));
+            qsort(sorted, topo->num_cpus, sizeof(CpuInfo), compare_scatter);
+            for (int i = 0; i < topo->num_cpus; i++) {
+                order[n++] = sorted[i].cpu;
+            }
+            free(sorted);
+            break;
+        }
+    }
+    return n;
+}
+
+int pin_policy_parse(const char* name, PinPolicy* policy) {
+    for (int p = PIN_NONE; p <= PIN_CORES; p++) {
+        if (strcmp(name, policy_names[p]) == 0) {
+            *policy = (PinPolicy)p;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char* pin_policy_name(PinPolicy policy) { return policy_names[policy]; }
@@ -0,0 +1,58 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <stdio.h>
+
+// CPU topology from sysfs and the pinning policies built on it.
+//
+// topology_discover reads /sys/devices/system/cpu/cpuN/topology for every
+// CPU this process may run on (its sched_getaffinity mask), so a taskset or
+// cgroup limit is respected. Logical CPU numbers say nothing about layout:
+// SMT siblings are often N and N + ncores, so pinning thread i to CPU i can
+// put two threads on one core while other cores sit idle.
+//
+// A policy turns the topology into an ordered CPU list; thread i runs on
+// entry i % length:
+//   compact  fill a core's hardware threads, then the next core, then the
+//            next package (shares caches, contends for a core)
+//   scatter  one thread per core, round-robin over packages, and only then
+//            the second hardware thread of each core
+//   cores    first hardware thread of each core only, in compact order;
+//            threads beyond the core count wrap around
+
+typedef enum { PIN_NONE, PIN_COMPACT, PIN_SCATTER, PIN_CORES } PinPolicy;
+
+typedef struct {
+    int cpu;        // logical CPU number
+    int package;    // physical_package_id
+    int core;       // core_id, only unique within a package
+    int core_slot;  // index of the core within its package
+    int smt;        // index of this hardware thread within its core
+} CpuInfo;
+
+typedef struct {
+    CpuInfo* cpus;  // allowed CPUs, sorted by package, core, CPU number
+    int num_cpus;
+    int num_cores;
+    int num_packages;
+} CpuTopology;
+
+// Returns 0 on success. Without sysfs every CPU is its own core.
+int topology_discover(CpuTopology* topo);
+
+void topology_free(CpuTopology* topo);
+
+// One line of counts, then one line per package listing its cores
+void topology_print(FILE* out, const CpuTopology* topo);
+
+// Fill order[] (room for topo->num_cpus entries) with the CPUs in the order
+// threads should be placed and return how many were written; 0 for
+// PIN_NONE.
+int topology_cpu_order(const CpuTopology* topo, PinPolicy policy, int* order);
+
+// Parse none|compact|scatter|cores; returns 0 on success
+int pin_policy_parse(const char* name, PinPolicy* policy);
+
+const char* pin_policy_name(PinPolicy policy);
+
+#endif  // TOPOLOGY_H
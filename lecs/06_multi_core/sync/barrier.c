@@ -0,0 +1,189 @@
+#include "barrier.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flag.h"
+#include "spin.h"
+
+static const char* const kind_names[] = {"pthread", "central", "tournament",
+                                         "dissemination"};
+
+// Per-thread state, one cache line each
+typedef struct {
+    _Alignas(CACHE_LINE) int sense;
+    int parity;  // dissemination only
+} Local;
+
+struct Barrier {
+    BarrierKind kind;
+    int parties;
+    int rounds;  // ceil(log2(parties))
+    Local* local;
+
+    pthread_barrier_t pthread;
+
+    // central
+    _Alignas(CACHE_LINE) atomic_int remaining;
+    Flag sense;
+
+    // tournament: arrive[i] is set by thread i when it loses its round,
+    // release[i] by the winner that wakes it
+    Flag* arrive;
+    Flag* release;
+
+    // dissemination: flags[(i * 2 + parity) * rounds + k]
+    Flag* flags;
+};
+
+static void* alloc_lines(size_t count, size_t size) {
+    void* p;
+    if (posix_memalign(&p, CACHE_LINE, count * size) != 0) {
+        return NULL;
+    }
+    memset(p, 0, count * size);
+    return p;
+}
+
+Barrier* barrier_create(BarrierKind kind, int parties) {
+    if (parties < 1) {
+        return NULL;
+    }
+    Barrier* b = alloc_lines(1, sizeof(Barrier));
+    if (b == NULL) {
+        return NULL;
+    }
+    b->kind = kind;
+    b->parties = parties;
+    b->rounds = 0;
+    while ((1 << b->rounds) < parties) {
+        b->rounds++;
+    }
+    b->local = alloc_lines(parties, sizeof(Local));
+    if (b->local == NULL) {
+        barrier_destroy(b);
+        return NULL;
+    }
+
+    switch (kind) {
+        case BARRIER_PTHREAD:
+            pthread_barrier_init(&b->pthread, NULL, parties);
+            break;
+        case BARRIER_CENTRAL:
+            atomic_init(&b->remaining, parties);
+            break;
+        case BARRIER_TOURNAMENT:
+            b->arrive = alloc_lines(parties, sizeof(Flag));
+            b->release = alloc_lines(parties, sizeof(Flag));
+            if (b->arrive == NULL || b->release == NULL) {
+                barrier_destroy(b);
+                return NULL;
+            }
+            break;
+        case BARRIER_DISSEMINATION:
+            // Flags start at 0 and the first episode waits for 1
+            for (int i = 0; i < parties; i++) {
+                b->local[i].sense = 1;
+            }
+            if (b->rounds > 0) {
+                b->flags = alloc_lines((size_t)parties * 2 * b->rounds,
+                                       sizeof(Flag));
+                if (b->flags == NULL) {
+                    barrier_destroy(b);
+                    return NULL;
+                }
+            }
+            break;
+    }
+    return b;
+}
+
+static void central_wait(Barrier* b, Local* local) {
+    int sense = local->sense = !local->sense;
+    if (atomic_fetch_sub_explicit(&b->remaining, 1, memory_order_acq_rel) ==
+        1) {
+        atomic_store_explicit(&b->remaining, b->parties, memory_order_relaxed);
+        flag_set(&b->sense, sense);
+    } else {
+        flag_await(&b->sense, sense);
+    }
+}
+
+static void tournament_wait(Barrier* b, Local* local, int id) {
+    int sense = local->sense = !local->sense;
+    int k = 0;
+
+    // Arrival: win rounds until this thread loses one (thread 0 never does)
+    for (; k < b->rounds; k++) {
+        int bit = 1 << k;
+        if (id & bit) {
+            flag_set(&b->arrive[id], sense);
+            flag_await(&b->release[id], sense);
+            break;
+        }
+        if (id + bit < b->parties) {
+            flag_await(&b->arrive[id + bit], sense);
+        }
+    }
+    // Wake-up: release the threads this one beat, latest round first
+    while (--k >= 0) {
+        int loser = id + (1 << k);
+        if (loser < b->parties) {
+            flag_set(&b->release[loser], sense);
+        }
+    }
+}
+
+static void dissemination_wait(Barrier* b, Local* local, int id) {
+    int sense = local->sense;
+    int parity = local->parity;
+    for (int k = 0; k < b->rounds; k++) {
+        int partner = (id + (1 << k)) % b->parties;
+        flag_set(&b->flags[(partner * 2 + parity) * b->rounds + k], sense);
+        flag_await(&b->flags[(id * 2 + parity) * b->rounds + k], sense);
+    }
+    // Alternating parity lets one episode's flags be reused two later
+    if (parity == 1) {
+        local->sense = !sense;
+    }
+    local->parity = !parity;
+}
+
+void barrier_wait(Barrier* b, int id) {
+    switch (b->kind) {
+        case BARRIER_PTHREAD: pthread_barrier_wait(&b->pthread); break;
+        case BARRIER_CENTRAL: central_wait(b, &b->local[id]); break;
+        case BARRIER_TOURNAMENT: tournament_wait(b, &b->local[id], id); break;
+        case BARRIER_DISSEMINATION:
+            dissemination_wait(b, &b->local[id], id);
+            break;
+    }
+}
+
+void barrier_destroy(Barrier* b) {
+    if (b == NULL) {
+        return;
+    }
+    if (b->kind == BARRIER_PTHREAD && b->local != NULL) {
+        pthread_barrier_destroy(&b->pthread);
+    }
+    free(b->local);
+    free(b->arrive);
+    free(b->release);
+    free(b->flags);
+    free(b);
+}
+
+int barrier_kind_parse(const char* name, BarrierKind* kind) {
+    for (int k = BARRIER_PTHREAD; k <= BARRIER_DISSEMINATION; k++) {
+        if (strcmp(name, kind_names[k]) == 0) {
+            *kind = (BarrierKind)k;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char* barrier_kind_name(BarrierKind kind) { return kind_names[kind]; }
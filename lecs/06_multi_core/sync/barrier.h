@@ -0,0 +1,45 @@
+#ifndef SYNC_BARRIER_H
+#define SYNC_BARRIER_H
+
+// Reusable barriers for a fixed group of threads.
+//
+// Every party calls barrier_wait with its own id in [0, parties); nobody
+// returns until all of them have arrived. The barriers other than
+// BARRIER_PTHREAD wait by spinning on a flag for a while and then sleeping on
+// it with a futex, so a short episode costs a few cache-line transfers and a
+// long one does not burn the core.
+//
+//   central        one counter and a shared sense flag; the last to arrive
+//                  flips the sense. O(1) rounds, but every arrival hits the
+//                  same line.
+//   tournament     pairwise tree: in round k thread i waits for i + 2^k and
+//                  thread i + 2^k drops out; thread 0 wins and wakes the
+//                  tree back down. log2(P) rounds, no shared counter.
+//   dissemination  in round k every thread signals (i + 2^k) mod P and waits
+//                  for (i - 2^k) mod P. log2(P) rounds, no tree to wake.
+//   pthread        pthread_barrier_t, for comparison.
+//
+// Per-thread state lives in the barrier, so a thread only needs its id.
+
+typedef enum {
+    BARRIER_PTHREAD,
+    BARRIER_CENTRAL,
+    BARRIER_TOURNAMENT,
+    BARRIER_DISSEMINATION,
+} BarrierKind;
+
+typedef struct Barrier Barrier;
+
+// NULL if parties < 1 or out of memory
+Barrier* barrier_create(BarrierKind kind, int parties);
+
+void barrier_wait(Barrier* b, int id);
+
+void barrier_destroy(Barrier* b);
+
+// Returns 0 and sets *kind if name is a kind name, -1 otherwise
+int barrier_kind_parse(const char* name, BarrierKind* kind);
+
+const char* barrier_kind_name(BarrierKind kind);
+
+#endif  // SYNC_BARRIER_H
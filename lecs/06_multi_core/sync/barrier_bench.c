@@ -0,0 +1,180 @@
+// Barrier latency: every thread runs a fixed number of barrier episodes,
+// optionally spinning `work` pauses between them like the compute phase of
+// an iterative kernel. Sweeps thread count for each barrier in barrier.h.
+//
+// Reports nanoseconds per episode as seen by thread 0, minus the work. Each
+// thread also publishes the episode it has reached and, after the barrier,
+// checks that its neighbour has reached it too; a barrier that lets a
+// thread through early fails the run.
+//
+// Output is CSV on stdout, one row per configuration.
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "barrier.h"
+#include "spin.h"
+
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_long episode;
+} Progress;
+
+typedef struct {
+    _Alignas(CACHE_LINE) Barrier* barrier;
+    Progress* progress;
+    int id;
+    int parties;
+    long episodes;
+    int work;
+    long early;    // episodes where the neighbour had not arrived
+    double seconds;  // thread 0 only
+} Worker;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* worker_main(void* arg) {
+    Worker* w = (Worker*)arg;
+    Progress* neighbour = &w->progress[(w->id + 1) % w->parties];
+    long early = 0;
+
+    barrier_wait(w->barrier, w->id);  // start together
+    double t0 = now();
+    for (long e = 1; e <= w->episodes; e++) {
+        for (int i = 0; i < w->work; i++) {
+            cpu_relax();
+        }
+        atomic_store_explicit(&w->progress[w->id].episode, e,
+                              memory_order_relaxed);
+        barrier_wait(w->barrier, w->id);
+        early += atomic_load_explicit(&neighbour->episode,
+                                      memory_order_relaxed) < e;
+    }
+    w->seconds = now() - t0;
+    w->early = early;
+    return NULL;
+}
+
+// Time of `work` pauses alone, to subtract from the episode time
+static double work_seconds(int work, long episodes) {
+    double t0 = now();
+    for (long e = 0; e < episodes; e++) {
+        for (int i = 0; i < work; i++) {
+            cpu_relax();
+        }
+        __asm__ __volatile__("" ::: "memory");
+    }
+    return now() - t0;
+}
+
+typedef struct {
+    double ns_per_episode;
+    long early;
+} BarrierResult;
+
+static BarrierResult run_barrier(BarrierKind kind, int parties, long episodes,
+                                 int work) {
+    Barrier* barrier = barrier_create(kind, parties);
+    Progress* progress;
+    if (barrier == NULL ||
+        posix_memalign((void**)&progress, CACHE_LINE,
+                       parties * sizeof(Progress)) != 0) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (int t = 0; t < parties; t++) {
+        atomic_init(&progress[t].episode, 0);
+    }
+
+    pthread_t threads[parties];
+    Worker workers[parties];
+    for (int t = 0; t < parties; t++) {
+        workers[t] = (Worker){barrier, progress, t, parties, episodes, work,
+                              0, 0.0};
+        if (t > 0) {
+            pthread_create(&threads[t], NULL, worker_main, &workers[t]);
+        }
+    }
+    worker_main(&workers[0]);
+
+    BarrierResult result = {0.0, 0};
+    for (int t = 0; t < parties; t++) {
+        if (t > 0) {
+            pthread_join(threads[t], NULL);
+        }
+        result.early += workers[t].early;
+    }
+    double seconds = workers[0].seconds - work_seconds(work, episodes);
+    result.ns_per_episode = (seconds > 0 ? seconds : 0) / episodes * 1e9;
+
+    free(progress);
+    barrier_destroy(barrier);
+    return result;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [-t max_threads] [-e episodes] [-w work] [-b barrier]\n"
+            "  -t  sweep 1, 2, 4, ... up to this many threads "
+            "(default nproc)\n"
+            "  -e  barrier episodes per configuration (default 20000)\n"
+            "  -w  pauses of work between episodes (default 0)\n"
+            "  -b  only this barrier: pthread, central, tournament, "
+            "dissemination\n",
+            prog);
+}
+
+int main(int argc, char* argv[]) {
+    int max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    long episodes = 20000;
+    int work = 0;
+    const char* only = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:e:w:b:")) != -1) {
+        switch (opt) {
+            case 't': max_threads = atoi(optarg); break;
+            case 'e': episodes = atol(optarg); break;
+            case 'w': work = atoi(optarg); break;
+            case 'b': only = optarg; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    BarrierKind only_kind;
+    if (max_threads < 1 || episodes < 1 || work < 0 ||
+        (only != NULL && barrier_kind_parse(only, &only_kind) != 0)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int status = 0;
+    printf("barrier,threads,work,episodes,ns_per_episode\n");
+    for (int k = BARRIER_PTHREAD; k <= BARRIER_DISSEMINATION; k++) {
+        if (only != NULL && (BarrierKind)k != only_kind) {
+            continue;
+        }
+        for (int p = 1; p <= max_threads; p *= 2) {
+            BarrierResult r = run_barrier((BarrierKind)k, p, episodes, work);
+            if (r.early > 0) {
+                fprintf(stderr, "%s: %ld episodes passed early\n",
+                        barrier_kind_name((BarrierKind)k), r.early);
+                status = 1;
+            }
+            printf("%s,%d,%d,%ld,%.1f\n", barrier_kind_name((BarrierKind)k),
+                   p, work, episodes, r.ns_per_episode);
+            fflush(stdout);
+        }
+    }
+    return status;
+}
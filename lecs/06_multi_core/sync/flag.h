@@ -0,0 +1,54 @@
+#ifndef SYNC_FLAG_H
+#define SYNC_FLAG_H
+
+// A word that one thread sets and others wait on: waiters spin for a while,
+// then sleep on a futex. The flag counts its sleepers so the signaller can
+// skip the wake syscall while everyone is still spinning.
+//
+// A zero-filled Flag is ready to use and holds 0.
+
+#include <stdatomic.h>
+
+#include "futex.h"
+#include "spin.h"
+
+// Spin iterations before a waiter sleeps on the flag
+#define FLAG_SPIN_LIMIT 4000
+
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_int value;
+    atomic_int sleepers;
+} Flag;
+
+static inline void flag_init(Flag* f, int value) {
+    atomic_init(&f->value, value);
+    atomic_init(&f->sleepers, 0);
+}
+
+// Wait until the flag holds `want`; acquires what the setter published
+static inline void flag_await(Flag* f, int want) {
+    unsigned spins = 0;
+    for (int i = 0; i < FLAG_SPIN_LIMIT; i++) {
+        if (atomic_load_explicit(&f->value, memory_order_acquire) == want) {
+            return;
+        }
+        spin_backoff(&spins);
+    }
+    // seq_cst against the store in flag_set: either the signaller sees us
+    // counted or we see its value before sleeping
+    atomic_fetch_add(&f->sleepers, 1);
+    int seen;
+    while ((seen = atomic_load(&f->value)) != want) {
+        futex_wait(&f->value, seen);
+    }
+    atomic_fetch_sub(&f->sleepers, 1);
+}
+
+static inline void flag_set(Flag* f, int value) {
+    atomic_store(&f->value, value);
+    if (atomic_load(&f->sleepers) > 0) {
+        futex_wake_all(&f->value);
+    }
+}
+
+#endif  // SYNC_FLAG_H
@@ -0,0 +1,25 @@
+#ifndef SYNC_FUTEX_H
+#define SYNC_FUTEX_H
+
+// Thin wrappers over the Linux futex syscall for process-private words.
+
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdatomic.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Sleep while *addr == expected (returns at once if it already differs)
+static inline void futex_wait(atomic_int* addr, int expected) {
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static inline void futex_wake(atomic_int* addr, int count) {
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+static inline void futex_wake_all(atomic_int* addr) {
+    futex_wake(addr, INT_MAX);
+}
+
+#endif  // SYNC_FUTEX_H
@@ -0,0 +1,323 @@
+// Lock contention: every thread repeatedly takes one shared lock, updates
+// `cs` cache lines of shared data inside it and spins `think` pauses outside
+// it, for a fixed time. Sweeps thread count and critical-section length for
+// pthread_mutex, pthread_spin and the locks in locks.h.
+//
+// Reports acquisitions per second and fairness (fewest / most acquisitions
+// of any one thread; FIFO locks stay near 1). A shared plain counter
+// incremented inside the critical section must match the total, which
+// catches a lock that lets two threads in at once.
+//
+// Output is CSV on stdout, one row per configuration.
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "locks.h"
+
+#define MAX_CS_LINES 64
+
+// Data touched inside the critical section, one counter per cache line
+static struct {
+    _Alignas(CACHE_LINE) uint64_t value;
+} shared[MAX_CS_LINES];
+static uint64_t shared_count;
+
+// ------------------------------------------------ lock adapters
+
+// Each lock gets an optional per-thread state (queue node or handle)
+typedef struct {
+    const char* name;
+    void* (*create)(void);
+    void (*destroy)(void* lock);
+    void* (*thread_init)(void* lock);
+    void (*thread_fini)(void* state);
+    void (*acquire)(void* lock, void* state);
+    void (*release)(void* lock, void* state);
+} LockOps;
+
+static void* no_state(void* lock) {
+    (void)lock;
+    return NULL;
+}
+
+static void free_state(void* state) { free(state); }
+
+static void* aligned_alloc_line(size_t size) {
+    void* p;
+    return posix_memalign(&p, CACHE_LINE, size) == 0 ? p : NULL;
+}
+
+static void* mutex_create(void) {
+    pthread_mutex_t* m = aligned_alloc_line(sizeof(pthread_mutex_t));
+    pthread_mutex_init(m, NULL);
+    return m;
+}
+static void mutex_destroy(void* l) {
+    pthread_mutex_destroy(l);
+    free(l);
+}
+static void mutex_acquire(void* l, void* s) {
+    (void)s;
+    pthread_mutex_lock(l);
+}
+static void mutex_release(void* l, void* s) {
+    (void)s;
+    pthread_mutex_unlock(l);
+}
+
+static void* spin_create(void) {
+    pthread_spinlock_t* l = aligned_alloc_line(sizeof(pthread_spinlock_t));
+    pthread_spin_init(l, PTHREAD_PROCESS_PRIVATE);
+    return (void*)l;
+}
+static void spin_destroy(void* l) {
+    pthread_spin_destroy(l);
+    free(l);
+}
+static void spin_acquire(void* l, void* s) {
+    (void)s;
+    pthread_spin_lock(l);
+}
+static void spin_release(void* l, void* s) {
+    (void)s;
+    pthread_spin_unlock(l);
+}
+
+static void* ticket_create(void) {
+    TicketLock* l = aligned_alloc_line(sizeof(TicketLock));
+    ticket_init(l);
+    return l;
+}
+static void ticket_acquire(void* l, void* s) {
+    (void)s;
+    ticket_lock(l);
+}
+static void ticket_release(void* l, void* s) {
+    (void)s;
+    ticket_unlock(l);
+}
+
+static void* mcs_create(void) {
+    McsLock* l = aligned_alloc_line(sizeof(McsLock));
+    mcs_init(l);
+    return l;
+}
+static void* mcs_thread_init(void* l) {
+    (void)l;
+    return aligned_alloc_line(sizeof(McsNode));
+}
+static void mcs_acquire(void* l, void* s) { mcs_lock(l, s); }
+static void mcs_release(void* l, void* s) { mcs_unlock(l, s); }
+
+static void* clh_create(void) {
+    ClhLock* l = aligned_alloc_line(sizeof(ClhLock));
+    clh_init(l);
+    return l;
+}
+static void clh_free(void* l) {
+    clh_destroy(l);
+    free(l);
+}
+static void* clh_thread_init(void* l) {
+    (void)l;
+    ClhHandle* h = malloc(sizeof(ClhHandle));
+    clh_handle_init(h);
+    return h;
+}
+static void clh_thread_fini(void* s) {
+    clh_handle_destroy(s);
+    free(s);
+}
+static void clh_acquire(void* l, void* s) { clh_lock(l, s); }
+static void clh_release(void* l, void* s) { clh_unlock(l, s); }
+
+static void* futex_create(void) {
+    FutexMutex* m = aligned_alloc_line(sizeof(FutexMutex));
+    futex_mutex_init(m);
+    return m;
+}
+static void futex_acquire(void* l, void* s) {
+    (void)s;
+    futex_mutex_lock(l);
+}
+static void futex_release(void* l, void* s) {
+    (void)s;
+    futex_mutex_unlock(l);
+}
+
+static const LockOps locks[] = {
+    {"pthread_mutex", mutex_create, mutex_destroy, no_state, free_state,
+     mutex_acquire, mutex_release},
+    {"pthread_spin", spin_create, spin_destroy, no_state, free_state,
+     spin_acquire, spin_release},
+    {"ticket", ticket_create, free, no_state, free_state, ticket_acquire,
+     ticket_release},
+    {"mcs", mcs_create, free, mcs_thread_init, free_state, mcs_acquire,
+     mcs_release},
+    {"clh", clh_create, clh_free, clh_thread_init, clh_thread_fini,
+     clh_acquire, clh_release},
+    {"futex", futex_create, free, no_state, free_state, futex_acquire,
+     futex_release},
+};
+
+// ------------------------------------------------ benchmark
+
+typedef struct {
+    _Alignas(CACHE_LINE) const LockOps* ops;
+    void* lock;
+    int cs_lines;
+    int think;
+    atomic_int* stop;
+    pthread_barrier_t* start;
+    uint64_t acquisitions;
+} Worker;
+
+static void* worker_main(void* arg) {
+    Worker* w = (Worker*)arg;
+    void* state = w->ops->thread_init(w->lock);
+    uint64_t count = 0;
+
+    pthread_barrier_wait(w->start);
+    while (!atomic_load_explicit(w->stop, memory_order_relaxed)) {
+        w->ops->acquire(w->lock, state);
+        for (int i = 0; i < w->cs_lines; i++) {
+            shared[i].value++;
+        }
+        shared_count++;
+        w->ops->release(w->lock, state);
+        count++;
+        for (int i = 0; i < w->think; i++) {
+            cpu_relax();
+        }
+    }
+    w->ops->thread_fini(state);
+    w->acquisitions = count;
+    return NULL;
+}
+
+typedef struct {
+    double per_second;
+    double fairness;
+    int exclusive;  // the shared counter matched the total
+} LockResult;
+
+static LockResult run_contention(const LockOps* ops, int num_threads,
+                                 int cs_lines, int think, double seconds) {
+    pthread_t threads[num_threads];
+    Worker workers[num_threads];
+    pthread_barrier_t start;
+    atomic_int stop = 0;
+    void* lock = ops->create();
+    LockResult result;
+
+    shared_count = 0;
+    pthread_barrier_init(&start, NULL, num_threads + 1);
+    for (int t = 0; t < num_threads; t++) {
+        workers[t] = (Worker){ops, lock, cs_lines, think, &stop, &start, 0};
+        pthread_create(&threads[t], NULL, worker_main, &workers[t]);
+    }
+    pthread_barrier_wait(&start);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    struct timespec duration = {(time_t)seconds,
+                                (long)((seconds - (time_t)seconds) * 1e9)};
+    nanosleep(&duration, NULL);
+    atomic_store(&stop, 1);
+
+    uint64_t total = 0, fewest = UINT64_MAX, most = 0;
+    for (int t = 0; t < num_threads; t++) {
+        pthread_join(threads[t], NULL);
+        uint64_t n = workers[t].acquisitions;
+        total += n;
+        fewest = n < fewest ? n : fewest;
+        most = n > most ? n : most;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    pthread_barrier_destroy(&start);
+    ops->destroy(lock);
+    result.per_second = total / elapsed;
+    result.fairness = most > 0 ? (double)fewest / most : 1.0;
+    result.exclusive = shared_count == total;
+    return result;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [-t max_threads] [-d seconds] [-w think] "
+            "[-l lock] [cs_lines ...]\n"
+            "  -t  sweep 1, 2, 4, ... up to this many threads "
+            "(default nproc)\n"
+            "  -d  seconds per configuration (default 0.2)\n"
+            "  -w  pauses between acquisitions (default 0)\n"
+            "  -l  only this lock: pthread_mutex, pthread_spin, ticket, "
+            "mcs, clh, futex\n"
+            "  cs_lines: cache lines written in the critical section "
+            "(default 0 4 32, max %d)\n",
+            prog, MAX_CS_LINES);
+}
+
+int main(int argc, char* argv[]) {
+    int max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    double seconds = 0.2;
+    int think = 0;
+    const char* only = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:d:w:l:")) != -1) {
+        switch (opt) {
+            case 't': max_threads = atoi(optarg); break;
+            case 'd': seconds = atof(optarg); break;
+            case 'w': think = atoi(optarg); break;
+            case 'l': only = optarg; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    int default_cs[] = {0, 4, 32};
+    int num_cs = argc > optind ? argc - optind : 3;
+    int cs[num_cs];
+    for (int i = 0; i < num_cs; i++) {
+        cs[i] = argc > optind ? atoi(argv[optind + i]) : default_cs[i];
+        if (cs[i] < 0 || cs[i] > MAX_CS_LINES) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (max_threads < 1 || seconds <= 0 || think < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int status = 0;
+    printf("lock,threads,cs_lines,think,macq_per_s,fairness\n");
+    for (size_t k = 0; k < sizeof(locks) / sizeof(locks[0]); k++) {
+        if (only != NULL && strcmp(only, locks[k].name) != 0) {
+            continue;
+        }
+        for (int c = 0; c < num_cs; c++) {
+            for (int p = 1; p <= max_threads; p *= 2) {
+                LockResult r =
+                    run_contention(&locks[k], p, cs[c], think, seconds);
+                if (!r.exclusive) {
+                    fprintf(stderr, "%s: mutual exclusion violated\n",
+                            locks[k].name);
+                    status = 1;
+                }
+                printf("%s,%d,%d,%d,%.3f,%.3f\n", locks[k].name, p, cs[c],
+                       think, r.per_second / 1e6, r.fairness);
+                fflush(stdout);
+            }
+        }
+    }
+    return status;
+}
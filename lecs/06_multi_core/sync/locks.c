@@ -0,0 +1,79 @@
+#include "locks.h"
+
+#include <stdlib.h>
+
+#include "futex.h"
+
+static ClhNode* clh_node_alloc(void) {
+    ClhNode* node;
+    if (posix_memalign((void**)&node, CACHE_LINE, sizeof(ClhNode)) != 0) {
+        return NULL;
+    }
+    atomic_init(&node->locked, 0);
+    return node;
+}
+
+int clh_init(ClhLock* lock) {
+    // The tail starts as a released node, so the first taker finds the
+    // lock free
+    ClhNode* dummy = clh_node_alloc();
+    if (dummy == NULL) {
+        return -1;
+    }
+    atomic_init(&lock->tail, dummy);
+    return 0;
+}
+
+void clh_destroy(ClhLock* lock) {
+    free(atomic_load(&lock->tail));
+    atomic_store(&lock->tail, NULL);
+}
+
+// Nodes migrate between threads, but there is always one per handle plus
+// the one at the tail, so each owner frees exactly one
+int clh_handle_init(ClhHandle* handle) {
+    handle->node = clh_node_alloc();
+    handle->pred = NULL;
+    return handle->node == NULL ? -1 : 0;
+}
+
+void clh_handle_destroy(ClhHandle* handle) {
+    free(handle->node);
+    handle->node = NULL;
+}
+
+void futex_mutex_lock_slow(FutexMutex* m) {
+    // Spin up to twice the recent average, so a lock that is usually
+    // released quickly is waited for and one held for long is slept on
+    int estimate = atomic_load_explicit(&m->spin_estimate,
+                                        memory_order_relaxed);
+    int limit = 2 * estimate + 10;
+    if (limit > FUTEX_MUTEX_MAX_SPIN) {
+        limit = FUTEX_MUTEX_MAX_SPIN;
+    }
+    for (int spins = 0; spins < limit; spins++) {
+        int expected = 0;
+        if (atomic_load_explicit(&m->state, memory_order_relaxed) == 0 &&
+            atomic_compare_exchange_weak_explicit(&m->state, &expected, 1,
+                                                  memory_order_acquire,
+                                                  memory_order_relaxed)) {
+            atomic_store_explicit(&m->spin_estimate,
+                                  estimate + (spins - estimate) / 8,
+                                  memory_order_relaxed);
+            return;
+        }
+        cpu_relax();
+    }
+    atomic_store_explicit(&m->spin_estimate,
+                          estimate + (limit - estimate) / 8,
+                          memory_order_relaxed);
+
+    // Mark the lock contended before sleeping, so the holder's unlock
+    // knows to wake us. We own it once the exchange returns 0.
+    while (atomic_exchange_explicit(&m->state, 2, memory_order_acquire) !=
+           0) {
+        futex_wait(&m->state, 2);
+    }
+}
+
+void futex_mutex_wake(FutexMutex* m) { futex_wake(&m->state, 1); }
@@ -0,0 +1,199 @@
+#ifndef SYNC_LOCKS_H
+#define SYNC_LOCKS_H
+
+// Mutual-exclusion locks that stay fast under contention.
+//
+// A test-and-set spinlock such as pthread_spin_lock has every waiter
+// spinning on the lock word, so each release invalidates that line in all
+// waiting cores and they all race to take it. These locks differ in what a
+// waiter spins on:
+//
+//   TicketLock  FIFO; waiters still read one shared `serving` word, but
+//               only write once (taking a ticket), and back off in
+//               proportion to their distance from the head of the queue
+//   McsLock     FIFO; each waiter spins on a flag in its own queue node,
+//               which its predecessor clears on release, so a handoff
+//               touches one remote line. Needs a node per acquisition.
+//   ClhLock     FIFO; each waiter spins on its predecessor's node. The
+//               releasing thread takes over that node for its next
+//               acquisition, so each thread keeps one handle.
+//   FutexMutex  not FIFO; spins for a while that adapts to how long the
+//               lock was recently held, then sleeps in the kernel, so it
+//               does not burn a CPU when the holder has been descheduled
+//
+// The queue locks fall back to sched_yield after a short spin (see
+// spin_backoff), which keeps them usable with more threads than CPUs.
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "spin.h"
+
+// ---------------------------------------------------------------- ticket
+
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_uint next;  // next ticket to hand out
+    _Alignas(CACHE_LINE) atomic_uint serving;
+} TicketLock;
+
+static inline void ticket_init(TicketLock* lock) {
+    atomic_init(&lock->next, 0);
+    atomic_init(&lock->serving, 0);
+}
+
+static inline void ticket_lock(TicketLock* lock) {
+    unsigned me = atomic_fetch_add_explicit(&lock->next, 1,
+                                            memory_order_relaxed);
+    unsigned spins = 0;
+    for (;;) {
+        unsigned serving =
+            atomic_load_explicit(&lock->serving, memory_order_acquire);
+        if (serving == me) {
+            return;
+        }
+        // Roughly one pause per thread ahead of us before looking again
+        for (unsigned i = me - serving; i > 1; i--) {
+            cpu_relax();
+        }
+        spin_backoff(&spins);
+    }
+}
+
+static inline void ticket_unlock(TicketLock* lock) {
+    unsigned serving =
+        atomic_load_explicit(&lock->serving, memory_order_relaxed);
+    atomic_store_explicit(&lock->serving, serving + 1, memory_order_release);
+}
+
+// ---------------------------------------------------------------- MCS
+
+typedef struct McsNode {
+    _Alignas(CACHE_LINE) _Atomic(struct McsNode*) next;
+    atomic_int locked;
+} McsNode;
+
+typedef struct {
+    _Alignas(CACHE_LINE) _Atomic(McsNode*) tail;
+} McsLock;
+
+static inline void mcs_init(McsLock* lock) { atomic_init(&lock->tail, NULL); }
+
+// `me` must stay valid and unused elsewhere until the matching unlock
+static inline void mcs_lock(McsLock* lock, McsNode* me) {
+    atomic_store_explicit(&me->next, NULL, memory_order_relaxed);
+    atomic_store_explicit(&me->locked, 1, memory_order_relaxed);
+    McsNode* pred =
+        atomic_exchange_explicit(&lock->tail, me, memory_order_acq_rel);
+    if (pred == NULL) {
+        return;
+    }
+    atomic_store_explicit(&pred->next, me, memory_order_release);
+    unsigned spins = 0;
+    while (atomic_load_explicit(&me->locked, memory_order_acquire)) {
+        spin_backoff(&spins);
+    }
+}
+
+static inline void mcs_unlock(McsLock* lock, McsNode* me) {
+    McsNode* next = atomic_load_explicit(&me->next, memory_order_acquire);
+    if (next == NULL) {
+        McsNode* expected = me;
+        if (atomic_compare_exchange_strong_explicit(
+                &lock->tail, &expected, NULL, memory_order_release,
+                memory_order_relaxed)) {
+            return;  // nobody waiting
+        }
+        // A successor swapped the tail but has not linked itself yet
+        unsigned spins = 0;
+        while ((next = atomic_load_explicit(&me->next,
+                                            memory_order_acquire)) == NULL) {
+            spin_backoff(&spins);
+        }
+    }
+    atomic_store_explicit(&next->locked, 0, memory_order_release);
+}
+
+// ---------------------------------------------------------------- CLH
+
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_int locked;
+} ClhNode;
+
+typedef struct {
+    _Alignas(CACHE_LINE) _Atomic(ClhNode*) tail;
+} ClhLock;
+
+// Per-thread state: the node this thread will enqueue and, while it holds
+// the lock, its predecessor's node
+typedef struct {
+    ClhNode* node;
+    ClhNode* pred;
+} ClhHandle;
+
+// Returns 0 on success
+int clh_init(ClhLock* lock);
+
+// Only when no thread holds or waits for the lock
+void clh_destroy(ClhLock* lock);
+
+int clh_handle_init(ClhHandle* handle);
+
+void clh_handle_destroy(ClhHandle* handle);
+
+static inline void clh_lock(ClhLock* lock, ClhHandle* handle) {
+    atomic_store_explicit(&handle->node->locked, 1, memory_order_relaxed);
+    ClhNode* pred = atomic_exchange_explicit(&lock->tail, handle->node,
+                                             memory_order_acq_rel);
+    unsigned spins = 0;
+    while (atomic_load_explicit(&pred->locked, memory_order_acquire)) {
+        spin_backoff(&spins);
+    }
+    handle->pred = pred;
+}
+
+static inline void clh_unlock(ClhLock* lock, ClhHandle* handle) {
+    (void)lock;
+    ClhNode* node = handle->node;
+    handle->node = handle->pred;  // the predecessor is done with it
+    atomic_store_explicit(&node->locked, 0, memory_order_release);
+}
+
+// ---------------------------------------------------------------- futex
+
+// Upper bound for the adaptive spin before sleeping
+#define FUTEX_MUTEX_MAX_SPIN 1000
+
+typedef struct {
+    // 0 unlocked, 1 locked, 2 locked and a thread may be asleep
+    _Alignas(CACHE_LINE) atomic_int state;
+    // Running average of the spins it took to get the lock, which sets how
+    // long the next contended acquisition spins. Updated with plain relaxed
+    // loads and stores: a lost update only skews the estimate.
+    atomic_int spin_estimate;
+} FutexMutex;
+
+static inline void futex_mutex_init(FutexMutex* m) {
+    atomic_init(&m->state, 0);
+    atomic_init(&m->spin_estimate, 0);
+}
+
+void futex_mutex_lock_slow(FutexMutex* m);
+
+void futex_mutex_wake(FutexMutex* m);
+
+static inline void futex_mutex_lock(FutexMutex* m) {
+    int expected = 0;
+    if (!atomic_compare_exchange_strong_explicit(&m->state, &expected, 1,
+                                                 memory_order_acquire,
+                                                 memory_order_relaxed)) {
+        futex_mutex_lock_slow(m);
+    }
+}
+
+static inline void futex_mutex_unlock(FutexMutex* m) {
+    if (atomic_exchange_explicit(&m->state, 0, memory_order_release) == 2) {
+        futex_mutex_wake(m);
+    }
+}
+
+#endif  // SYNC_LOCKS_H
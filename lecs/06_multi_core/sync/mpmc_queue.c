@@ -0,0 +1,100 @@
+#include "mpmc_queue.h"
+
+#include <stdlib.h>
+
+int mpmc_init(MpmcQueue* q, size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    if (posix_memalign((void**)&q->cells, CACHE_LINE,
+                       size * sizeof(MpmcCell)) != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&q->cells[i].seq, i);
+        q->cells[i].data = NULL;
+    }
+    q->mask = size - 1;
+    atomic_init(&q->enqueue_pos, 0);
+    atomic_init(&q->dequeue_pos, 0);
+    return 0;
+}
+
+void mpmc_destroy(MpmcQueue* q) {
+    free(q->cells);
+    q->cells = NULL;
+}
+
+// Count the cells from pos on whose sequence is pos + i + offset, i.e. that
+// are ready for this side; stops at max
+static size_t ready_run(MpmcQueue* q, size_t pos, size_t offset,
+                        size_t max) {
+    size_t n = 0;
+    while (n < max) {
+        MpmcCell* cell = &q->cells[(pos + n) & q->mask];
+        if (atomic_load_explicit(&cell->seq, memory_order_acquire) !=
+            pos + n + offset) {
+            break;
+        }
+        n++;
+    }
+    return n;
+}
+
+size_t mpmc_enqueue_batch(MpmcQueue* q, void* const* items, size_t n) {
+    size_t pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        size_t ready = ready_run(q, pos, 0, n);
+        if (ready == 0) {
+            size_t seq = atomic_load_explicit(&q->cells[pos & q->mask].seq,
+                                              memory_order_acquire);
+            if ((intptr_t)seq - (intptr_t)pos < 0 || n == 0) {
+                return 0;  // full
+            }
+            // Another producer took pos; start again from the counter
+            pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&q->enqueue_pos, &pos,
+                                                  pos + ready,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+            for (size_t i = 0; i < ready; i++) {
+                MpmcCell* cell = &q->cells[(pos + i) & q->mask];
+                cell->data = items[i];
+                atomic_store_explicit(&cell->seq, pos + i + 1,
+                                      memory_order_release);
+            }
+            return ready;
+        }
+    }
+}
+
+size_t mpmc_dequeue_batch(MpmcQueue* q, void** items, size_t max) {
+    size_t pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+    for (;;) {
+        size_t ready = ready_run(q, pos, 1, max);
+        if (ready == 0) {
+            size_t seq = atomic_load_explicit(&q->cells[pos & q->mask].seq,
+                                              memory_order_acquire);
+            if ((intptr_t)seq - (intptr_t)(pos + 1) < 0 || max == 0) {
+                return 0;  // empty
+            }
+            pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&q->dequeue_pos, &pos,
+                                                  pos + ready,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+            for (size_t i = 0; i < ready; i++) {
+                MpmcCell* cell = &q->cells[(pos + i) & q->mask];
+                items[i] = cell->data;
+                atomic_store_explicit(&cell->seq, pos + i + q->mask + 1,
+                                      memory_order_release);
+            }
+            return ready;
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef SYNC_MPMC_QUEUE_H
+#define SYNC_MPMC_QUEUE_H
+
+// Bounded multi-producer multi-consumer queue of pointers (Vyukov).
+//
+// Every cell carries a sequence number that says whose turn it is: cell i
+// is free for the enqueuer of position p when seq == p, and holds data for
+// the dequeuer of position p when seq == p + 1. A thread claims a position
+// with one CAS on the shared enqueue or dequeue counter, fills or drains
+// the cell, and hands it on by publishing the next sequence number, so
+// producers only contend with producers and consumers with consumers.
+//
+// The batch calls claim several adjacent cells with a single CAS. They scan
+// forward from the current position while cells are ready; a cell seen
+// ready cannot be taken by anyone else without first moving the counter
+// past it, which would make the CAS fail. That spreads the cost of the
+// contended CAS over the whole batch.
+//
+// Capacity is a power of two. Operations never block: they return 0 (or a
+// short count) when the queue is full or empty.
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spin.h"
+
+typedef struct {
+    atomic_size_t seq;
+    void* data;
+} MpmcCell;
+
+typedef struct {
+    _Alignas(CACHE_LINE) MpmcCell* cells;  // read-only after init
+    size_t mask;
+    _Alignas(CACHE_LINE) atomic_size_t enqueue_pos;
+    _Alignas(CACHE_LINE) atomic_size_t dequeue_pos;
+} MpmcQueue;
+
+// capacity is rounded up to a power of two (at least 2). Returns 0 on
+// success.
+int mpmc_init(MpmcQueue* q, size_t capacity);
+
+void mpmc_destroy(MpmcQueue* q);
+
+static inline size_t mpmc_capacity(const MpmcQueue* q) { return q->mask + 1; }
+
+// Returns 1 if the item was stored, 0 if the queue is full
+static inline int mpmc_enqueue(MpmcQueue* q, void* item) {
+    size_t pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        MpmcCell* cell = &q->cells[pos & q->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(
+                    &q->enqueue_pos, &pos, pos + 1, memory_order_relaxed,
+                    memory_order_relaxed)) {
+                cell->data = item;
+                atomic_store_explicit(&cell->seq, pos + 1,
+                                      memory_order_release);
+                return 1;
+            }
+        } else if (dif < 0) {
+            return 0;  // the cell still holds last lap's item
+        } else {
+            pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+// Returns 1 and stores the item, or 0 if the queue is empty
+static inline int mpmc_dequeue(MpmcQueue* q, void** item) {
+    size_t pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+    for (;;) {
+        MpmcCell* cell = &q->cells[pos & q->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(
+                    &q->dequeue_pos, &pos, pos + 1, memory_order_relaxed,
+                    memory_order_relaxed)) {
+                *item = cell->data;
+                atomic_store_explicit(&cell->seq, pos + q->mask + 1,
+                                      memory_order_release);
+                return 1;
+            }
+        } else if (dif < 0) {
+            return 0;  // not written yet
+        } else {
+            pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+// Store up to n items in adjacent cells; returns how many were stored
+size_t mpmc_enqueue_batch(MpmcQueue* q, void* const* items, size_t n);
+
+// Take up to max items from adjacent cells; returns how many were taken
+size_t mpmc_dequeue_batch(MpmcQueue* q, void** items, size_t max);
+
+#endif  // SYNC_MPMC_QUEUE_H
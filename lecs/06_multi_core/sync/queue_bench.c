@@ -0,0 +1,418 @@
+// Producer-consumer handoff: the mutex + condition variable ring buffer from
+// multicore.md section 7.2 against the lock-free SPSC ring and MPMC queue.
+//
+// Throughput: P producers send `items` pointers to C consumers, each call
+// moving `batch` items, and the wall time gives items per second.
+// Latency: two threads bounce one token through a pair of queues and the
+// round trip is timed per bounce.
+//
+// Output is CSV on stdout, one row per configuration.
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mpmc_queue.h"
+#include "spin.h"
+#include "spsc_ring.h"
+
+#define MAX_BATCH 256
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ------------------------------------------------ mutex/condvar baseline
+
+// The multicore.md ring buffer, holding pointers, with batch variants that
+// move as many items as fit under one lock acquisition
+typedef struct {
+    void** buffer;
+    size_t capacity;
+    size_t in;
+    size_t out;
+    size_t count;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} CondRing;
+
+static void* cond_create(size_t capacity) {
+    CondRing* rb = malloc(sizeof(CondRing));
+    rb->buffer = malloc(capacity * sizeof(void*));
+    rb->capacity = capacity;
+    rb->in = rb->out = rb->count = 0;
+    pthread_mutex_init(&rb->mutex, NULL);
+    pthread_cond_init(&rb->not_empty, NULL);
+    pthread_cond_init(&rb->not_full, NULL);
+    return rb;
+}
+
+static void cond_destroy(void* q) {
+    CondRing* rb = (CondRing*)q;
+    pthread_mutex_destroy(&rb->mutex);
+    pthread_cond_destroy(&rb->not_empty);
+    pthread_cond_destroy(&rb->not_full);
+    free(rb->buffer);
+    free(rb);
+}
+
+// Blocks until at least one item fits
+static size_t cond_push(void* q, void* const* items, size_t n) {
+    CondRing* rb = (CondRing*)q;
+    pthread_mutex_lock(&rb->mutex);
+    while (rb->count == rb->capacity) {
+        pthread_cond_wait(&rb->not_full, &rb->mutex);
+    }
+    size_t room = rb->capacity - rb->count;
+    n = n < room ? n : room;
+    for (size_t i = 0; i < n; i++) {
+        rb->buffer[rb->in] = items[i];
+        rb->in = (rb->in + 1) % rb->capacity;
+    }
+    rb->count += n;
+    pthread_cond_signal(&rb->not_empty);
+    pthread_mutex_unlock(&rb->mutex);
+    return n;
+}
+
+// Blocks until at least one item is available
+static size_t cond_pop(void* q, void** items, size_t max) {
+    CondRing* rb = (CondRing*)q;
+    pthread_mutex_lock(&rb->mutex);
+    while (rb->count == 0) {
+        pthread_cond_wait(&rb->not_empty, &rb->mutex);
+    }
+    size_t n = max < rb->count ? max : rb->count;
+    for (size_t i = 0; i < n; i++) {
+        items[i] = rb->buffer[rb->out];
+        rb->out = (rb->out + 1) % rb->capacity;
+    }
+    rb->count -= n;
+    pthread_cond_signal(&rb->not_full);
+    pthread_mutex_unlock(&rb->mutex);
+    return n;
+}
+
+// ------------------------------------------------ lock-free adapters
+
+// The rings have cache-line aligned members, so plain malloc is not enough
+static void* spsc_create(size_t capacity) {
+    SpscRing* ring;
+    if (posix_memalign((void**)&ring, CACHE_LINE, sizeof(SpscRing)) != 0) {
+        return NULL;
+    }
+    if (spsc_init(ring, capacity) != 0) {
+        free(ring);
+        return NULL;
+    }
+    return ring;
+}
+
+static void spsc_free(void* q) {
+    spsc_destroy((SpscRing*)q);
+    free(q);
+}
+
+static size_t spsc_push_n(void* q, void* const* items, size_t n) {
+    return n == 1 ? (size_t)spsc_push((SpscRing*)q, items[0])
+                  : spsc_push_batch((SpscRing*)q, items, n);
+}
+
+static size_t spsc_pop_n(void* q, void** items, size_t max) {
+    return max == 1 ? (size_t)spsc_pop((SpscRing*)q, items)
+                    : spsc_pop_batch((SpscRing*)q, items, max);
+}
+
+static void* mpmc_create(size_t capacity) {
+    MpmcQueue* q;
+    if (posix_memalign((void**)&q, CACHE_LINE, sizeof(MpmcQueue)) != 0) {
+        return NULL;
+    }
+    if (mpmc_init(q, capacity) != 0) {
+        free(q);
+        return NULL;
+    }
+    return q;
+}
+
+static void mpmc_free(void* q) {
+    mpmc_destroy((MpmcQueue*)q);
+    free(q);
+}
+
+static size_t mpmc_push_n(void* q, void* const* items, size_t n) {
+    return n == 1 ? (size_t)mpmc_enqueue((MpmcQueue*)q, items[0])
+                  : mpmc_enqueue_batch((MpmcQueue*)q, items, n);
+}
+
+static size_t mpmc_pop_n(void* q, void** items, size_t max) {
+    return max == 1 ? (size_t)mpmc_dequeue((MpmcQueue*)q, items)
+                    : mpmc_dequeue_batch((MpmcQueue*)q, items, max);
+}
+
+// push/pop move up to n items and return how many moved; the lock-free
+// ones return 0 instead of blocking
+typedef struct {
+    const char* name;
+    void* (*create)(size_t capacity);
+    void (*destroy)(void* q);
+    size_t (*push)(void* q, void* const* items, size_t n);
+    size_t (*pop)(void* q, void** items, size_t max);
+    int single_producer;
+} QueueOps;
+
+static const QueueOps queues[] = {
+    {"mutex", cond_create, cond_destroy, cond_push, cond_pop, 0},
+    {"spsc", spsc_create, spsc_free, spsc_push_n, spsc_pop_n, 1},
+    {"mpmc", mpmc_create, mpmc_free, mpmc_push_n, mpmc_pop_n, 0},
+};
+
+static void* create_queue(const QueueOps* ops, size_t capacity) {
+    void* q = ops->create(capacity);
+    if (q == NULL) {
+        fprintf(stderr, "Cannot allocate a %s queue of %zu slots\n",
+                ops->name, capacity);
+        exit(1);
+    }
+    return q;
+}
+
+// Push all n items, backing off while the queue is full
+static void push_all(const QueueOps* ops, void* q, void* const* items,
+                     size_t n) {
+    unsigned spins = 0;
+    while (n > 0) {
+        size_t done = ops->push(q, items, n);
+        if (done == 0) {
+            spin_backoff(&spins);
+        }
+        items += done;
+        n -= done;
+    }
+}
+
+// Pop at least one and at most max items
+static size_t pop_some(const QueueOps* ops, void* q, void** items,
+                       size_t max) {
+    unsigned spins = 0;
+    size_t n;
+    while ((n = ops->pop(q, items, max)) == 0) {
+        spin_backoff(&spins);
+    }
+    return n;
+}
+
+// ------------------------------------------------ throughput
+
+typedef struct {
+    const QueueOps* ops;
+    void* q;
+    pthread_barrier_t* start;
+    long count;  // items to send or receive
+    size_t batch;
+    uint64_t sum;
+} Endpoint;
+
+static void* producer_main(void* arg) {
+    Endpoint* e = (Endpoint*)arg;
+    void* items[MAX_BATCH];
+    pthread_barrier_wait(e->start);
+    for (long sent = 0; sent < e->count;) {
+        size_t n = (size_t)(e->count - sent) < e->batch
+                       ? (size_t)(e->count - sent)
+                       : e->batch;
+        for (size_t i = 0; i < n; i++) {
+            items[i] = (void*)(uintptr_t)(sent + i + 1);
+        }
+        push_all(e->ops, e->q, items, n);
+        sent += n;
+    }
+    return NULL;
+}
+
+static void* consumer_main(void* arg) {
+    Endpoint* e = (Endpoint*)arg;
+    void* items[MAX_BATCH];
+    pthread_barrier_wait(e->start);
+    e->sum = 0;
+    for (long received = 0; received < e->count;) {
+        size_t max = (size_t)(e->count - received) < e->batch
+                         ? (size_t)(e->count - received)
+                         : e->batch;
+        size_t n = pop_some(e->ops, e->q, items, max);
+        for (size_t i = 0; i < n; i++) {
+            e->sum += (uintptr_t)items[i];
+        }
+        received += n;
+    }
+    return NULL;
+}
+
+// Returns seconds, or a negative value if items were lost or duplicated
+static double run_throughput(const QueueOps* ops, int producers,
+                             int consumers, long items, size_t batch,
+                             size_t capacity) {
+    int total = producers + consumers;
+    pthread_t threads[total];
+    Endpoint ends[total];
+    pthread_barrier_t start;
+    void* q = create_queue(ops, capacity);
+    long per_producer = items / producers;
+    long sent = per_producer * producers;
+
+    pthread_barrier_init(&start, NULL, total + 1);
+    for (int i = 0; i < total; i++) {
+        int is_producer = i < producers;
+        int index = is_producer ? i : i - producers;
+        int parts = is_producer ? producers : consumers;
+        long share = is_producer ? per_producer
+                                 : sent / parts + (index < sent % parts);
+        ends[i] = (Endpoint){ops, q, &start, share, batch, 0};
+        pthread_create(&threads[i], NULL,
+                       is_producer ? producer_main : consumer_main, &ends[i]);
+    }
+    pthread_barrier_wait(&start);
+    double t0 = now_seconds();
+    uint64_t sum = 0;
+    for (int i = 0; i < total; i++) {
+        pthread_join(threads[i], NULL);
+        sum += ends[i].sum;
+    }
+    double elapsed = now_seconds() - t0;
+
+    pthread_barrier_destroy(&start);
+    ops->destroy(q);
+    uint64_t expected = (uint64_t)producers * per_producer *
+                        (per_producer + 1) / 2;
+    return sum == expected ? elapsed : -1.0;
+}
+
+// ------------------------------------------------ latency
+
+typedef struct {
+    const QueueOps* ops;
+    void* ping;
+    void* pong;
+    long rounds;
+} PingPong;
+
+static void* echo_main(void* arg) {
+    PingPong* pp = (PingPong*)arg;
+    void* token;
+    for (long r = 0; r < pp->rounds; r++) {
+        pop_some(pp->ops, pp->ping, &token, 1);
+        push_all(pp->ops, pp->pong, &token, 1);
+    }
+    return NULL;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Round-trip times in ns: median and 99th percentile
+static void run_latency(const QueueOps* ops, long rounds, size_t capacity,
+                        double* median, double* p99) {
+    PingPong pp = {ops, create_queue(ops, capacity),
+                   create_queue(ops, capacity), rounds};
+    double* rtt = malloc(rounds * sizeof(double));
+    pthread_t echo;
+    void* token = (void*)(uintptr_t)1;
+
+    pthread_create(&echo, NULL, echo_main, &pp);
+    for (long r = 0; r < rounds; r++) {
+        double t0 = now_seconds();
+        push_all(ops, pp.ping, &token, 1);
+        pop_some(ops, pp.pong, &token, 1);
+        rtt[r] = (now_seconds() - t0) * 1e9;
+    }
+    pthread_join(echo, NULL);
+
+    qsort(rtt, rounds, sizeof(double), compare_double);
+    *median = rtt[rounds / 2];
+    *p99 = rtt[(long)(rounds * 0.99)];
+    free(rtt);
+    ops->destroy(pp.ping);
+    ops->destroy(pp.pong);
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [-n items] [-c capacity] [-b batch] [-t max_threads] "
+            "[-r rounds]\n"
+            "  -n  items per throughput run (default 4000000)\n"
+            "  -c  queue capacity (default 1024)\n"
+            "  -b  items per call in the batched runs (default 32, max %d)\n"
+            "  -t  largest producer and consumer count (default nproc)\n"
+            "  -r  ping-pong round trips for latency (default 100000)\n",
+            prog, MAX_BATCH);
+}
+
+int main(int argc, char* argv[]) {
+    long items = 4000000;
+    size_t capacity = 1024;
+    size_t batch = 32;
+    int max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    long rounds = 100000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:c:b:t:r:")) != -1) {
+        switch (opt) {
+            case 'n': items = atol(optarg); break;
+            case 'c': capacity = (size_t)atol(optarg); break;
+            case 'b': batch = (size_t)atol(optarg); break;
+            case 't': max_threads = atoi(optarg); break;
+            case 'r': rounds = atol(optarg); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (items <= 0 || capacity < 2 || batch < 1 || batch > MAX_BATCH ||
+        max_threads < 1 || rounds < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int status = 0;
+    printf("test,queue,producers,consumers,batch,items,seconds,"
+           "mitems_per_s,rtt_median_ns,rtt_p99_ns\n");
+    for (size_t k = 0; k < sizeof(queues) / sizeof(queues[0]); k++) {
+        const QueueOps* ops = &queues[k];
+        for (int p = 1; p <= max_threads; p *= 2) {
+            if (ops->single_producer && p > 1) {
+                break;
+            }
+            size_t batches[2] = {1, batch};
+            for (int b = 0; b < (batch > 1 ? 2 : 1); b++) {
+                double s = run_throughput(ops, p, p, items, batches[b],
+                                          capacity);
+                if (s < 0) {
+                    fprintf(stderr, "%s: items lost or duplicated\n",
+                            ops->name);
+                    status = 1;
+                    continue;
+                }
+                long moved = items / p * p;
+                printf("throughput,%s,%d,%d,%zu,%ld,%.6f,%.2f,,\n",
+                       ops->name, p, p, batches[b], moved, s,
+                       moved / s / 1e6);
+                fflush(stdout);
+            }
+        }
+        double median, p99;
+        run_latency(ops, rounds, capacity, &median, &p99);
+        printf("latency,%s,1,1,1,%ld,,,%.0f,%.0f\n", ops->name, rounds,
+               median, p99);
+        fflush(stdout);
+    }
+    return status;
+}
@@ -0,0 +1,126 @@
+#include "rcu.h"
+
+#include <stdlib.h>
+
+void rcu_init(RcuDomain* domain) {
+    atomic_init(&domain->epoch, 1);
+    pthread_mutex_init(&domain->lock, NULL);
+    domain->readers = NULL;
+    domain->retired = NULL;
+    domain->num_retired = 0;
+}
+
+static void free_retired(RcuRetired* list) {
+    while (list != NULL) {
+        RcuRetired* next = list->next;
+        list->free_fn(list->ptr);
+        free(list);
+        list = next;
+    }
+}
+
+void rcu_destroy(RcuDomain* domain) {
+    free_retired(domain->retired);
+    domain->retired = NULL;
+    domain->num_retired = 0;
+    while (domain->readers != NULL) {
+        RcuReader* next = domain->readers->next;
+        free(domain->readers);
+        domain->readers = next;
+    }
+    pthread_mutex_destroy(&domain->lock);
+}
+
+RcuReader* rcu_register(RcuDomain* domain) {
+    RcuReader* reader;
+    if (posix_memalign((void**)&reader, CACHE_LINE, sizeof(RcuReader)) !=
+        0) {
+        return NULL;
+    }
+    atomic_init(&reader->state, 0);
+    reader->domain = domain;
+    pthread_mutex_lock(&domain->lock);
+    reader->next = domain->readers;
+    domain->readers = reader;
+    pthread_mutex_unlock(&domain->lock);
+    return reader;
+}
+
+void rcu_unregister(RcuReader* reader) {
+    RcuDomain* domain = reader->domain;
+    pthread_mutex_lock(&domain->lock);
+    for (RcuReader** link = &domain->readers; *link != NULL;
+         link = &(*link)->next) {
+        if (*link == reader) {
+            *link = reader->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&domain->lock);
+    free(reader);
+}
+
+// Wait for every reader to be outside a critical section or inside one
+// that started in `epoch` or later; a concurrent rcu_synchronize may have
+// advanced the epoch again. Called with the domain lock held, so the reader
+// list is stable.
+static void wait_for_readers(RcuDomain* domain, unsigned long epoch) {
+    for (RcuReader* r = domain->readers; r != NULL; r = r->next) {
+        unsigned spins = 0;
+        for (;;) {
+            unsigned long state =
+                atomic_load_explicit(&r->state, memory_order_acquire);
+            if (!(state & 1) || state >> 1 >= epoch) {
+                break;
+            }
+            spin_backoff(&spins);
+        }
+    }
+}
+
+void rcu_synchronize(RcuDomain* domain) {
+    // Pairs with the fence in rcu_read_lock: either we see a reader's
+    // announcement below, or that reader sees everything published before
+    // this point
+    atomic_thread_fence(memory_order_seq_cst);
+    unsigned long epoch =
+        atomic_fetch_add_explicit(&domain->epoch, 1, memory_order_seq_cst) +
+        1;
+    pthread_mutex_lock(&domain->lock);
+    wait_for_readers(domain, epoch);
+    pthread_mutex_unlock(&domain->lock);
+}
+
+void rcu_retire(RcuDomain* domain, void* ptr, void (*free_fn)(void*)) {
+    RcuRetired* node = malloc(sizeof(RcuRetired));
+    if (node == NULL) {
+        // No room to defer: pay for a grace period now
+        rcu_synchronize(domain);
+        free_fn(ptr);
+        return;
+    }
+    node->ptr = ptr;
+    node->free_fn = free_fn;
+
+    pthread_mutex_lock(&domain->lock);
+    node->next = domain->retired;
+    domain->retired = node;
+    int full = ++domain->num_retired >= RCU_RETIRE_BATCH;
+    pthread_mutex_unlock(&domain->lock);
+    if (full) {
+        rcu_reclaim(domain);
+    }
+}
+
+void rcu_reclaim(RcuDomain* domain) {
+    // Everything on the list was unpublished before it was retired, so one
+    // grace period after taking the list covers all of it
+    pthread_mutex_lock(&domain->lock);
+    RcuRetired* list = domain->retired;
+    domain->retired = NULL;
+    domain->num_retired = 0;
+    pthread_mutex_unlock(&domain->lock);
+
+    rcu_synchronize(domain);
+    free_retired(list);
+}
@@ -0,0 +1,100 @@
+#ifndef SYNC_RCU_H
+#define SYNC_RCU_H
+
+// Epoch-based read-copy-update for read-mostly data behind a pointer.
+//
+// Readers enter a critical section, load the current pointer and use the
+// object without taking a lock. A writer builds a new object, publishes it
+// with one atomic exchange, and hands the old one to rcu_retire, which
+// frees it only after a grace period: once every reader that might still
+// see the old pointer has left its critical section.
+//
+// Grace periods are tracked with a global epoch. rcu_read_lock stores the
+// epoch it saw, tagged active, in the reader's own cache line; that store
+// is the only write a reader makes, and no other reader touches that line.
+// rcu_synchronize bumps the epoch and waits until each registered reader is
+// either inactive or has announced the new epoch. A reader announcing the
+// new epoch started after the bump, so it can only have loaded the new
+// pointer.
+//
+// Each reading thread registers once with rcu_register. Read-side critical
+// sections must not nest and must not block on a writer. rcu_retire batches
+// frees so the cost of a grace period is spread over RCU_RETIRE_BATCH
+// objects; rcu_reclaim flushes the batch.
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "spin.h"
+
+// Retired objects collected before a grace period is forced
+#define RCU_RETIRE_BATCH 64
+
+typedef struct RcuReader {
+    // epoch << 1 | active, written only by the owning thread
+    _Alignas(CACHE_LINE) atomic_ulong state;
+    struct RcuDomain* domain;
+    struct RcuReader* next;
+} RcuReader;
+
+typedef struct RcuRetired {
+    void* ptr;
+    void (*free_fn)(void*);
+    struct RcuRetired* next;
+} RcuRetired;
+
+typedef struct RcuDomain {
+    _Alignas(CACHE_LINE) atomic_ulong epoch;
+    // Guards the reader list and the retired list; readers never take it
+    _Alignas(CACHE_LINE) pthread_mutex_t lock;
+    RcuReader* readers;
+    RcuRetired* retired;
+    size_t num_retired;
+} RcuDomain;
+
+void rcu_init(RcuDomain* domain);
+
+// Frees everything still retired. No reader may be inside a critical
+// section.
+void rcu_destroy(RcuDomain* domain);
+
+// Per-thread reader record; NULL if out of memory
+RcuReader* rcu_register(RcuDomain* domain);
+
+void rcu_unregister(RcuReader* reader);
+
+static inline void rcu_read_lock(RcuReader* reader) {
+    unsigned long epoch =
+        atomic_load_explicit(&reader->domain->epoch, memory_order_acquire);
+    atomic_store_explicit(&reader->state, epoch << 1 | 1,
+                          memory_order_relaxed);
+    // Order the announcement before the pointer loads that follow; pairs
+    // with the fence in rcu_synchronize
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+static inline void rcu_read_unlock(RcuReader* reader) {
+    atomic_store_explicit(&reader->state, 0, memory_order_release);
+}
+
+// Load a pointer published with rcu_publish
+#define rcu_dereference(slot) \
+    atomic_load_explicit(&(slot), memory_order_acquire)
+
+// Publish a new object; returns the old one for rcu_retire
+static inline void* rcu_publish(void* _Atomic* slot, void* value) {
+    return atomic_exchange_explicit(slot, value, memory_order_acq_rel);
+}
+
+// Wait for a grace period: every critical section in progress when this is
+// called has ended when it returns
+void rcu_synchronize(RcuDomain* domain);
+
+// Free ptr with free_fn after a grace period. Call after it was unpublished.
+void rcu_retire(RcuDomain* domain, void* ptr, void (*free_fn)(void*));
+
+// Wait for a grace period and free everything retired so far
+void rcu_reclaim(RcuDomain* domain);
+
+#endif  // SYNC_RCU_H
@@ -0,0 +1,277 @@
+// Read-mostly shared data: reader scaling of pthread_rwlock, the seqlock
+// and RCU.
+//
+// The shared record stands in for an autotuned tiling table that every
+// kernel call consults: reader threads read it in a loop while one writer
+// replaces it every `interval` microseconds. Every field is derived from
+// the version, so a reader can tell a torn or freed record from a good one;
+// any such read is counted and fails the run.
+//
+// Output is CSV on stdout: total and per-reader reads per second for 1, 2,
+// 4, ... readers.
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rcu.h"
+#include "seqlock.h"
+
+// Block sizes for one kernel shape, one cache line
+typedef struct {
+    _Alignas(CACHE_LINE) uint64_t version;
+    int64_t mc, nc, kc, mr, nr;
+    double gflops;
+    uint64_t check;
+} TuningTable;
+
+static void fill_table(TuningTable* t, uint64_t version) {
+    t->version = version;
+    t->mc = 64 + (int64_t)(version % 8) * 16;
+    t->nc = 256 + (int64_t)(version % 4) * 128;
+    t->kc = 128 + (int64_t)(version % 16) * 8;
+    t->mr = 4 + (int64_t)(version % 2) * 2;
+    t->nr = 8;
+    t->gflops = (double)version * 0.5;
+    t->check = version * 0x9e3779b97f4a7c15ULL;
+}
+
+static int table_ok(const TuningTable* t) {
+    TuningTable expected;
+    fill_table(&expected, t->version);
+    return t->mc == expected.mc && t->nc == expected.nc &&
+           t->kc == expected.kc && t->mr == expected.mr &&
+           t->nr == expected.nr && t->gflops == expected.gflops &&
+           t->check == expected.check;
+}
+
+typedef enum { MODE_RWLOCK, MODE_SEQLOCK, MODE_RCU } Mode;
+
+static const char* const mode_names[] = {"rwlock", "seqlock", "rcu"};
+
+// Shared state for one run; the record behind each mode
+typedef struct {
+    Mode mode;
+    atomic_int stop;
+    pthread_barrier_t start;
+    pthread_rwlock_t rwlock;
+    TuningTable locked_table;  // rwlock
+    SeqLock seqlock;
+    TuningTable seq_table;  // seqlock
+    RcuDomain rcu;
+    void* _Atomic rcu_table;
+    int interval_us;
+} Shared;
+
+// Readers store a value derived from what they read here, so the reads
+// cannot be optimised away
+static volatile uint64_t sink_out;
+
+typedef struct {
+    _Alignas(CACHE_LINE) Shared* shared;
+    uint64_t reads;
+    uint64_t bad;
+    uint64_t writes;
+} Thread;
+
+static void* reader_main(void* arg) {
+    Thread* self = (Thread*)arg;
+    Shared* s = self->shared;
+    RcuReader* rcu_reader =
+        s->mode == MODE_RCU ? rcu_register(&s->rcu) : NULL;
+    uint64_t reads = 0, bad = 0, sink = 0;
+    TuningTable copy;
+
+    pthread_barrier_wait(&s->start);
+    while (!atomic_load_explicit(&s->stop, memory_order_relaxed)) {
+        switch (s->mode) {
+            case MODE_RWLOCK:
+                pthread_rwlock_rdlock(&s->rwlock);
+                copy = s->locked_table;
+                pthread_rwlock_unlock(&s->rwlock);
+                break;
+            case MODE_SEQLOCK:
+                seqlock_read(&s->seqlock, &copy, &s->seq_table,
+                             sizeof(copy));
+                break;
+            case MODE_RCU: {
+                rcu_read_lock(rcu_reader);
+                const TuningTable* t = rcu_dereference(s->rcu_table);
+                copy = *t;
+                rcu_read_unlock(rcu_reader);
+                break;
+            }
+        }
+        bad += !table_ok(&copy);
+        sink += (uint64_t)(copy.mc * copy.kc);
+        reads++;
+    }
+    if (rcu_reader != NULL) {
+        rcu_unregister(rcu_reader);
+    }
+    sink_out = sink;
+    self->reads = reads;
+    self->bad = bad;
+    return NULL;
+}
+
+static void* writer_main(void* arg) {
+    Thread* self = (Thread*)arg;
+    Shared* s = self->shared;
+    struct timespec pause = {0, (long)s->interval_us * 1000};
+    uint64_t version = 1;
+
+    pthread_barrier_wait(&s->start);
+    while (!atomic_load_explicit(&s->stop, memory_order_relaxed)) {
+        nanosleep(&pause, NULL);
+        version++;
+        TuningTable next;
+        fill_table(&next, version);
+        switch (s->mode) {
+            case MODE_RWLOCK:
+                pthread_rwlock_wrlock(&s->rwlock);
+                s->locked_table = next;
+                pthread_rwlock_unlock(&s->rwlock);
+                break;
+            case MODE_SEQLOCK:
+                seqlock_write(&s->seqlock, &s->seq_table, &next,
+                              sizeof(next));
+                break;
+            case MODE_RCU: {
+                TuningTable* fresh;
+                if (posix_memalign((void**)&fresh, CACHE_LINE,
+                                   sizeof(*fresh)) != 0) {
+                    break;
+                }
+                *fresh = next;
+                rcu_retire(&s->rcu, rcu_publish(&s->rcu_table, fresh),
+                           free);
+                break;
+            }
+        }
+    }
+    self->writes = version - 1;
+    return NULL;
+}
+
+typedef struct {
+    double reads_per_s;
+    uint64_t writes;
+    uint64_t bad;
+} ReadResult;
+
+static ReadResult run_readers(Mode mode, int readers, int interval_us,
+                              double seconds) {
+    Shared* s;
+    TuningTable* first;
+    if (posix_memalign((void**)&s, CACHE_LINE, sizeof(Shared)) != 0 ||
+        posix_memalign((void**)&first, CACHE_LINE, sizeof(*first)) != 0) {
+        perror("posix_memalign");
+        exit(1);
+    }
+    memset(s, 0, sizeof(*s));
+    s->mode = mode;
+    s->interval_us = interval_us;
+    atomic_init(&s->stop, 0);
+    pthread_barrier_init(&s->start, NULL, readers + 2);
+    pthread_rwlock_init(&s->rwlock, NULL);
+    fill_table(&s->locked_table, 1);
+    seqlock_init(&s->seqlock);
+    fill_table(&s->seq_table, 1);
+    rcu_init(&s->rcu);
+    fill_table(first, 1);
+    atomic_init(&s->rcu_table, first);
+
+    pthread_t threads[readers + 1];
+    Thread state[readers + 1];
+    for (int t = 0; t <= readers; t++) {
+        state[t] = (Thread){s, 0, 0, 0};
+        pthread_create(&threads[t], NULL, t == 0 ? writer_main : reader_main,
+                       &state[t]);
+    }
+    pthread_barrier_wait(&s->start);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    struct timespec duration = {(time_t)seconds,
+                                (long)((seconds - (time_t)seconds) * 1e9)};
+    nanosleep(&duration, NULL);
+    atomic_store(&s->stop, 1);
+
+    ReadResult result = {0.0, 0, 0};
+    uint64_t reads = 0;
+    for (int t = 0; t <= readers; t++) {
+        pthread_join(threads[t], NULL);
+        reads += state[t].reads;
+        result.bad += state[t].bad;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    result.reads_per_s = reads / elapsed;
+    result.writes = state[0].writes;
+
+    free(atomic_load(&s->rcu_table));
+    rcu_destroy(&s->rcu);
+    pthread_rwlock_destroy(&s->rwlock);
+    pthread_barrier_destroy(&s->start);
+    free(s);
+    return result;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [-t max_readers] [-w interval_us] [-d seconds]\n"
+            "  -t  sweep 1, 2, 4, ... up to this many readers "
+            "(default nproc)\n"
+            "  -w  microseconds between writer updates (default 100)\n"
+            "  -d  seconds per configuration (default 0.2)\n",
+            prog);
+}
+
+int main(int argc, char* argv[]) {
+    int max_readers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int interval_us = 100;
+    double seconds = 0.2;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:w:d:")) != -1) {
+        switch (opt) {
+            case 't': max_readers = atoi(optarg); break;
+            case 'w': interval_us = atoi(optarg); break;
+            case 'd': seconds = atof(optarg); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (max_readers < 1 || interval_us < 1 || interval_us >= 1000000 ||
+        seconds <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int status = 0;
+    printf("mode,readers,interval_us,mreads_per_s,mreads_per_s_per_reader,"
+           "writes,bad_reads\n");
+    for (int m = MODE_RWLOCK; m <= MODE_RCU; m++) {
+        for (int r = 1; r <= max_readers; r *= 2) {
+            ReadResult res = run_readers((Mode)m, r, interval_us, seconds);
+            if (res.bad > 0) {
+                fprintf(stderr, "%s: %llu torn or stale reads\n",
+                        mode_names[m], (unsigned long long)res.bad);
+                status = 1;
+            }
+            printf("%s,%d,%d,%.3f,%.3f,%llu,%llu\n", mode_names[m], r,
+                   interval_us, res.reads_per_s / 1e6,
+                   res.reads_per_s / 1e6 / r,
+                   (unsigned long long)res.writes,
+                   (unsigned long long)res.bad);
+            fflush(stdout);
+        }
+    }
+    return status;
+}
@@ -0,0 +1,107 @@
+#ifndef SYNC_SEQLOCK_H
+#define SYNC_SEQLOCK_H
+
+// Sequence lock for small, read-mostly records.
+//
+// A writer makes the sequence odd, updates the record and makes it even
+// again. A reader samples the sequence, copies the record and samples it
+// again; if it was odd or has changed the copy may be torn and the reader
+// retries. Readers never write shared memory, so any number of them can
+// read on different cores without moving a cache line, unlike the reader
+// count of pthread_rwlock. Writers exclude each other by claiming the odd
+// value with a CAS.
+//
+// The record is copied word by word with relaxed atomic accesses, which
+// keeps the racing reads well defined. seqlock_read and seqlock_write do
+// the whole protocol; records must be 8-byte aligned and a multiple of 8
+// bytes.
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spin.h"
+
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_uint seq;
+} SeqLock;
+
+static inline void seqlock_init(SeqLock* sl) { atomic_init(&sl->seq, 0); }
+
+// Start a read; returns the even sequence to validate against
+static inline unsigned seqlock_read_begin(const SeqLock* sl) {
+    unsigned spins = 0;
+    unsigned seq;
+    while ((seq = atomic_load_explicit(&sl->seq, memory_order_acquire)) &
+           1) {
+        spin_backoff(&spins);  // a write is in progress
+    }
+    return seq;
+}
+
+// Returns nonzero if what was read since seqlock_read_begin may be torn
+static inline int seqlock_read_retry(const SeqLock* sl, unsigned start) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&sl->seq, memory_order_relaxed) != start;
+}
+
+static inline void seqlock_write_begin(SeqLock* sl) {
+    unsigned spins = 0;
+    unsigned seq = atomic_load_explicit(&sl->seq, memory_order_relaxed);
+    for (;;) {
+        if (!(seq & 1) &&
+            atomic_compare_exchange_weak_explicit(&sl->seq, &seq, seq + 1,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+            break;
+        }
+        spin_backoff(&spins);
+        seq = atomic_load_explicit(&sl->seq, memory_order_relaxed);
+    }
+    // Keep the data stores below from moving above the odd sequence
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void seqlock_write_end(SeqLock* sl) {
+    unsigned seq = atomic_load_explicit(&sl->seq, memory_order_relaxed);
+    atomic_store_explicit(&sl->seq, seq + 1, memory_order_release);
+}
+
+// Word-wise copies for data shared under a seqlock
+static inline void seqlock_copy_out(void* dst, const void* src,
+                                    size_t bytes) {
+    uint64_t* d = (uint64_t*)dst;
+    const uint64_t* s = (const uint64_t*)src;
+    for (size_t i = 0; i < bytes / 8; i++) {
+        d[i] = __atomic_load_n(&s[i], __ATOMIC_RELAXED);
+    }
+}
+
+static inline void seqlock_copy_in(void* dst, const void* src,
+                                   size_t bytes) {
+    uint64_t* d = (uint64_t*)dst;
+    const uint64_t* s = (const uint64_t*)src;
+    for (size_t i = 0; i < bytes / 8; i++) {
+        __atomic_store_n(&d[i], s[i], __ATOMIC_RELAXED);
+    }
+}
+
+// Copy a consistent snapshot of `shared` into `out`
+static inline void seqlock_read(const SeqLock* sl, void* out,
+                                const void* shared, size_t bytes) {
+    unsigned seq;
+    do {
+        seq = seqlock_read_begin(sl);
+        seqlock_copy_out(out, shared, bytes);
+    } while (seqlock_read_retry(sl, seq));
+}
+
+// Replace `shared` with `in`
+static inline void seqlock_write(SeqLock* sl, void* shared, const void* in,
+                                 size_t bytes) {
+    seqlock_write_begin(sl);
+    seqlock_copy_in(shared, in, bytes);
+    seqlock_write_end(sl);
+}
+
+#endif  // SYNC_SEQLOCK_H
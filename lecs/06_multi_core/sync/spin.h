@@ -0,0 +1,32 @@
+#ifndef SYNC_SPIN_H
+#define SYNC_SPIN_H
+
+// Busy-wait helpers shared by the lock-free structures in this directory.
+
+#include <sched.h>
+
+#define CACHE_LINE 64
+
+// Spin iterations before a waiter gives up its time slice
+#define SPIN_YIELD_AFTER 256
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// One step of a wait loop: pause while the wait is short, then yield so an
+// oversubscribed machine still lets the thread we wait for run
+static inline void spin_backoff(unsigned* spins) {
+    if (*spins < SPIN_YIELD_AFTER) {
+        (*spins)++;
+        cpu_relax();
+    } else {
+        sched_yield();
+    }
+}
+
+#endif  // SYNC_SPIN_H
@@ -0,0 +1,25 @@
+#include "spsc_ring.h"
+
+#include <stdlib.h>
+
+int spsc_init(SpscRing* ring, size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    if (posix_memalign((void**)&ring->slots, CACHE_LINE,
+                       size * sizeof(void*)) != 0) {
+        return -1;
+    }
+    ring->mask = size - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->cached_head = 0;
+    ring->cached_tail = 0;
+    return 0;
+}
+
+void spsc_destroy(SpscRing* ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
@@ -0,0 +1,112 @@
+#ifndef SYNC_SPSC_RING_H
+#define SYNC_SPSC_RING_H
+
+// Bounded single-producer single-consumer ring of pointers.
+//
+// The mutex ring buffer in multicore.md section 7.2 takes a lock and may
+// signal a condition variable on every item. Here the producer owns `tail`
+// and the consumer owns `head`, each on its own cache line, so a handoff is
+// one slot write plus one release store. Each side also keeps a cached copy
+// of the other's index and rereads the shared one only when the cache says
+// the ring is full (or empty), so in steady state the two cores exchange
+// the index lines once per lap rather than once per item.
+//
+// Indices grow without wrapping; the slot is index & mask, which needs a
+// power-of-two capacity. Push and pop never block: they return 0 when the
+// ring is full or empty and the caller decides how to wait.
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "spin.h"
+
+typedef struct {
+    // Consumer side
+    _Alignas(CACHE_LINE) atomic_size_t head;  // next slot to read
+    size_t cached_tail;
+    // Producer side
+    _Alignas(CACHE_LINE) atomic_size_t tail;  // next slot to write
+    size_t cached_head;
+    // Read-only after init
+    _Alignas(CACHE_LINE) size_t mask;
+    void** slots;
+} SpscRing;
+
+// capacity is rounded up to a power of two. Returns 0 on success.
+int spsc_init(SpscRing* ring, size_t capacity);
+
+void spsc_destroy(SpscRing* ring);
+
+static inline size_t spsc_capacity(const SpscRing* ring) {
+    return ring->mask + 1;
+}
+
+// Producer only. Returns 1 if the item was stored, 0 if the ring is full.
+static inline int spsc_push(SpscRing* ring, void* item) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (tail - ring->cached_head > ring->mask) {
+        ring->cached_head =
+            atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail - ring->cached_head > ring->mask) {
+            return 0;
+        }
+    }
+    ring->slots[tail & ring->mask] = item;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+// Consumer only. Returns 1 and stores the item, or 0 if the ring is empty.
+static inline int spsc_pop(SpscRing* ring, void** item) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head == ring->cached_tail) {
+        ring->cached_tail =
+            atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head == ring->cached_tail) {
+            return 0;
+        }
+    }
+    *item = ring->slots[head & ring->mask];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return 1;
+}
+
+// Producer only. Store up to n items with a single index update; returns
+// how many were stored.
+static inline size_t spsc_push_batch(SpscRing* ring, void* const* items,
+                                     size_t n) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t room = ring->mask + 1 - (tail - ring->cached_head);
+    if (room < n) {
+        ring->cached_head =
+            atomic_load_explicit(&ring->head, memory_order_acquire);
+        room = ring->mask + 1 - (tail - ring->cached_head);
+    }
+    n = n < room ? n : room;
+    for (size_t i = 0; i < n; i++) {
+        ring->slots[(tail + i) & ring->mask] = items[i];
+    }
+    atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+    return n;
+}
+
+// Consumer only. Take up to max items with a single index update; returns
+// how many were taken.
+static inline size_t spsc_pop_batch(SpscRing* ring, void** items,
+                                    size_t max) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t avail = ring->cached_tail - head;
+    if (avail < max) {
+        ring->cached_tail =
+            atomic_load_explicit(&ring->tail, memory_order_acquire);
+        avail = ring->cached_tail - head;
+    }
+    size_t n = max < avail ? max : avail;
+    for (size_t i = 0; i < n; i++) {
+        items[i] = ring->slots[(head + i) & ring->mask];
+    }
+    atomic_store_explicit(&ring->head, head + n, memory_order_release);
+    return n;
+}
+
+#endif  // SYNC_SPSC_RING_H
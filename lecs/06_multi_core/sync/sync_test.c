@@ -0,0 +1,640 @@
+// Correctness tests for the sync library: single-threaded edge cases plus
+// multi-threaded stress runs that check every item arrives exactly once
+// and in order. Run with `make test`; exits non-zero on any failure.
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "barrier.h"
+#include "locks.h"
+#include "mpmc_queue.h"
+#include "rcu.h"
+#include "seqlock.h"
+#include "spsc_ring.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                      \
+    do {                                                                 \
+        if (!(cond)) {                                                   \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__,       \
+                    __LINE__, #cond);                                    \
+            failures++;                                                  \
+        }                                                                \
+    } while (0)
+
+#define RUN(test)                                                     \
+    do {                                                              \
+        int before = failures;                                        \
+        test();                                                       \
+        printf("[%s] %s\n", failures == before ? "  OK  " : "FAILED", \
+               #test);                                                \
+    } while (0)
+
+#define ITEM(v) ((void*)(uintptr_t)(v))
+#define VALUE(p) ((uintptr_t)(p))
+
+// ---------------------------------------------------------------- SPSC
+
+static void test_spsc_full_empty_wrap(void) {
+    SpscRing ring;
+    void* item;
+    CHECK(spsc_init(&ring, 5) == 0);
+    CHECK(spsc_capacity(&ring) == 8);
+    CHECK(!spsc_pop(&ring, &item));
+
+    for (uintptr_t i = 1; i <= 8; i++) {
+        CHECK(spsc_push(&ring, ITEM(i)));
+    }
+    CHECK(!spsc_push(&ring, ITEM(9)));
+    for (uintptr_t i = 1; i <= 8; i++) {
+        CHECK(spsc_pop(&ring, &item) && VALUE(item) == i);
+    }
+    CHECK(!spsc_pop(&ring, &item));
+
+    // Indices run far past the capacity
+    for (uintptr_t i = 0; i < 1000; i++) {
+        CHECK(spsc_push(&ring, ITEM(i)) && spsc_push(&ring, ITEM(i + 1)));
+        CHECK(spsc_pop(&ring, &item) && VALUE(item) == i);
+        CHECK(spsc_pop(&ring, &item) && VALUE(item) == i + 1);
+    }
+    spsc_destroy(&ring);
+}
+
+static void test_spsc_batch(void) {
+    SpscRing ring;
+    void* in[12];
+    void* out[12];
+    CHECK(spsc_init(&ring, 8) == 0);
+    for (uintptr_t i = 0; i < 12; i++) {
+        in[i] = ITEM(i);
+    }
+    CHECK(spsc_push_batch(&ring, in, 12) == 8);  // partial when short
+    CHECK(spsc_push_batch(&ring, in, 1) == 0);
+    CHECK(spsc_pop_batch(&ring, out, 3) == 3);
+    CHECK(VALUE(out[0]) == 0 && VALUE(out[2]) == 2);
+    CHECK(spsc_push_batch(&ring, in + 8, 4) == 3);  // wraps the slot array
+    CHECK(spsc_pop_batch(&ring, out, 12) == 8);
+    CHECK(VALUE(out[0]) == 3 && VALUE(out[4]) == 7 && VALUE(out[7]) == 10);
+    CHECK(spsc_pop_batch(&ring, out, 12) == 0);
+    spsc_destroy(&ring);
+}
+
+#define STREAM_ITEMS (1 << 20)
+
+typedef struct {
+    SpscRing* ring;
+    int batch;
+} SpscArgs;
+
+static void* spsc_producer(void* arg) {
+    SpscArgs* a = (SpscArgs*)arg;
+    void* items[32];
+    unsigned spins = 0;
+    for (uintptr_t next = 1; next <= STREAM_ITEMS;) {
+        size_t n = 1;
+        if (a->batch) {
+            n = next + 31 <= STREAM_ITEMS ? 32 : STREAM_ITEMS - next + 1;
+            for (size_t i = 0; i < n; i++) {
+                items[i] = ITEM(next + i);
+            }
+            n = spsc_push_batch(a->ring, items, n);
+        } else if (!spsc_push(a->ring, ITEM(next))) {
+            n = 0;
+        }
+        if (n == 0) {
+            spin_backoff(&spins);
+        }
+        next += n;
+    }
+    return NULL;
+}
+
+static void spsc_stream(int batch) {
+    SpscRing ring;
+    SpscArgs args = {&ring, batch};
+    pthread_t producer;
+    void* items[32];
+    uintptr_t expected = 1;
+    int in_order = 1;
+    unsigned spins = 0;
+
+    CHECK(spsc_init(&ring, 64) == 0);
+    pthread_create(&producer, NULL, spsc_producer, &args);
+    while (expected <= STREAM_ITEMS) {
+        size_t n = batch ? spsc_pop_batch(&ring, items, 32)
+                         : (size_t)spsc_pop(&ring, &items[0]);
+        if (n == 0) {
+            spin_backoff(&spins);
+        }
+        for (size_t i = 0; i < n; i++) {
+            in_order &= VALUE(items[i]) == expected++;
+        }
+    }
+    pthread_join(producer, NULL);
+    CHECK(in_order);
+    spsc_destroy(&ring);
+}
+
+static void test_spsc_threads(void) { spsc_stream(0); }
+
+static void test_spsc_threads_batch(void) { spsc_stream(1); }
+
+// ---------------------------------------------------------------- MPMC
+
+static void test_mpmc_full_empty_wrap(void) {
+    MpmcQueue q;
+    void* item;
+    CHECK(mpmc_init(&q, 3) == 0);
+    CHECK(mpmc_capacity(&q) == 4);
+    CHECK(!mpmc_dequeue(&q, &item));
+    for (uintptr_t i = 1; i <= 4; i++) {
+        CHECK(mpmc_enqueue(&q, ITEM(i)));
+    }
+    CHECK(!mpmc_enqueue(&q, ITEM(5)));
+    for (uintptr_t i = 1; i <= 4; i++) {
+        CHECK(mpmc_dequeue(&q, &item) && VALUE(item) == i);
+    }
+    CHECK(!mpmc_dequeue(&q, &item));
+    for (uintptr_t i = 0; i < 1000; i++) {
+        CHECK(mpmc_enqueue(&q, ITEM(i)));
+        CHECK(mpmc_dequeue(&q, &item) && VALUE(item) == i);
+    }
+    mpmc_destroy(&q);
+}
+
+static void test_mpmc_batch(void) {
+    MpmcQueue q;
+    void* in[6];
+    void* out[6];
+    CHECK(mpmc_init(&q, 4) == 0);
+    for (uintptr_t i = 0; i < 6; i++) {
+        in[i] = ITEM(i);
+    }
+    CHECK(mpmc_enqueue_batch(&q, in, 6) == 4);
+    CHECK(mpmc_enqueue_batch(&q, in, 1) == 0);
+    CHECK(mpmc_dequeue_batch(&q, out, 3) == 3 && VALUE(out[2]) == 2);
+    CHECK(mpmc_enqueue_batch(&q, in + 4, 2) == 2);
+    CHECK(mpmc_dequeue_batch(&q, out, 6) == 3);
+    CHECK(VALUE(out[0]) == 3 && VALUE(out[1]) == 4 && VALUE(out[2]) == 5);
+    CHECK(mpmc_dequeue_batch(&q, out, 6) == 0);
+    mpmc_destroy(&q);
+}
+
+#define MPMC_THREADS 4
+#define MPMC_ITEMS_PER_PRODUCER (1 << 18)
+#define MPMC_TOTAL ((long)MPMC_THREADS * MPMC_ITEMS_PER_PRODUCER)
+
+// Items encode (producer, sequence) so consumers can check per-producer
+// order: one consumer's dequeues take increasing positions, so it must see
+// each producer's items in the order they were sent.
+#define ENCODE(p, s) ITEM(((uintptr_t)(p) << 32) | (s))
+
+typedef struct {
+    MpmcQueue* q;
+    int id;
+    int batch;
+    atomic_long* consumed;
+    uint64_t sum;
+    int in_order;
+} MpmcArgs;
+
+static void* mpmc_producer(void* arg) {
+    MpmcArgs* a = (MpmcArgs*)arg;
+    void* items[16];
+    unsigned spins = 0;
+    for (uintptr_t s = 1; s <= MPMC_ITEMS_PER_PRODUCER;) {
+        size_t n = 1;
+        if (a->batch) {
+            n = s + 15 <= MPMC_ITEMS_PER_PRODUCER
+                    ? 16
+                    : MPMC_ITEMS_PER_PRODUCER - s + 1;
+            for (size_t i = 0; i < n; i++) {
+                items[i] = ENCODE(a->id, s + i);
+            }
+            n = mpmc_enqueue_batch(a->q, items, n);
+        } else if (!mpmc_enqueue(a->q, ENCODE(a->id, s))) {
+            n = 0;
+        }
+        if (n == 0) {
+            spin_backoff(&spins);
+        }
+        s += n;
+    }
+    return NULL;
+}
+
+static void* mpmc_consumer(void* arg) {
+    MpmcArgs* a = (MpmcArgs*)arg;
+    uintptr_t last[MPMC_THREADS] = {0};
+    void* items[16];
+    unsigned spins = 0;
+    a->sum = 0;
+    a->in_order = 1;
+    while (atomic_load_explicit(a->consumed, memory_order_relaxed) <
+           MPMC_TOTAL) {
+        size_t n = a->batch ? mpmc_dequeue_batch(a->q, items, 16)
+                            : (size_t)mpmc_dequeue(a->q, &items[0]);
+        if (n == 0) {
+            spin_backoff(&spins);
+            continue;
+        }
+        for (size_t i = 0; i < n; i++) {
+            uintptr_t v = VALUE(items[i]);
+            uintptr_t producer = v >> 32, s = v & 0xffffffffu;
+            a->in_order &= producer < MPMC_THREADS && s > last[producer];
+            if (producer < MPMC_THREADS) {
+                last[producer] = s;
+            }
+            a->sum += s;
+        }
+        atomic_fetch_add_explicit(a->consumed, (long)n,
+                                  memory_order_relaxed);
+    }
+    return NULL;
+}
+
+static void test_mpmc_threads(void) {
+    MpmcQueue q;
+    atomic_long consumed = 0;
+    pthread_t threads[2 * MPMC_THREADS];
+    MpmcArgs args[2 * MPMC_THREADS];
+
+    CHECK(mpmc_init(&q, 256) == 0);
+    for (int i = 0; i < 2 * MPMC_THREADS; i++) {
+        // Odd threads use the batch calls, so single and batch operations
+        // interleave on the same queue
+        args[i] = (MpmcArgs){&q, i % MPMC_THREADS, i & 1, &consumed, 0, 1};
+        pthread_create(&threads[i], NULL,
+                       i < MPMC_THREADS ? mpmc_producer : mpmc_consumer,
+                       &args[i]);
+    }
+    uint64_t sum = 0;
+    int in_order = 1;
+    for (int i = 0; i < 2 * MPMC_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        if (i >= MPMC_THREADS) {
+            sum += args[i].sum;
+            in_order &= args[i].in_order;
+        }
+    }
+    uint64_t per_producer = (uint64_t)MPMC_ITEMS_PER_PRODUCER *
+                            (MPMC_ITEMS_PER_PRODUCER + 1) / 2;
+    CHECK(atomic_load(&consumed) == MPMC_TOTAL);
+    CHECK(sum == per_producer * MPMC_THREADS);
+    CHECK(in_order);
+    void* item;
+    CHECK(!mpmc_dequeue(&q, &item));
+    mpmc_destroy(&q);
+}
+
+// ---------------------------------------------------------------- locks
+
+#define LOCK_THREADS 4
+#define LOCK_ITERATIONS 20000
+
+// Each thread increments a plain counter under the lock; any overlap of
+// critical sections loses increments
+typedef struct {
+    int kind;
+    void* lock;
+    long* counter;
+} LockArgs;
+
+enum { USE_TICKET, USE_MCS, USE_CLH, USE_FUTEX };
+
+static void* lock_worker(void* arg) {
+    LockArgs* a = (LockArgs*)arg;
+    McsNode node;
+    ClhHandle handle;
+    if (a->kind == USE_CLH) {
+        clh_handle_init(&handle);
+    }
+    for (int i = 0; i < LOCK_ITERATIONS; i++) {
+        switch (a->kind) {
+            case USE_TICKET: ticket_lock(a->lock); break;
+            case USE_MCS: mcs_lock(a->lock, &node); break;
+            case USE_CLH: clh_lock(a->lock, &handle); break;
+            case USE_FUTEX: futex_mutex_lock(a->lock); break;
+        }
+        long v = *a->counter;
+        if ((i & 255) == 0) {
+            sched_yield();  // get preempted inside the critical section
+        }
+        *a->counter = v + 1;
+        switch (a->kind) {
+            case USE_TICKET: ticket_unlock(a->lock); break;
+            case USE_MCS: mcs_unlock(a->lock, &node); break;
+            case USE_CLH: clh_unlock(a->lock, &handle); break;
+            case USE_FUTEX: futex_mutex_unlock(a->lock); break;
+        }
+    }
+    if (a->kind == USE_CLH) {
+        clh_handle_destroy(&handle);
+    }
+    return NULL;
+}
+
+static long hammer_lock(int kind, void* lock) {
+    pthread_t threads[LOCK_THREADS];
+    LockArgs args[LOCK_THREADS];
+    long counter = 0;
+    for (int t = 0; t < LOCK_THREADS; t++) {
+        args[t] = (LockArgs){kind, lock, &counter};
+        pthread_create(&threads[t], NULL, lock_worker, &args[t]);
+    }
+    for (int t = 0; t < LOCK_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    return counter;
+}
+
+static void test_ticket_lock(void) {
+    TicketLock lock;
+    ticket_init(&lock);
+    CHECK(hammer_lock(USE_TICKET, &lock) ==
+          (long)LOCK_THREADS * LOCK_ITERATIONS);
+    CHECK(atomic_load(&lock.next) == atomic_load(&lock.serving));
+}
+
+static void test_mcs_lock(void) {
+    McsLock lock;
+    mcs_init(&lock);
+    CHECK(hammer_lock(USE_MCS, &lock) ==
+          (long)LOCK_THREADS * LOCK_ITERATIONS);
+    CHECK(atomic_load(&lock.tail) == NULL);
+}
+
+static void test_clh_lock(void) {
+    ClhLock lock;
+    CHECK(clh_init(&lock) == 0);
+    CHECK(hammer_lock(USE_CLH, &lock) ==
+          (long)LOCK_THREADS * LOCK_ITERATIONS);
+    CHECK(atomic_load(&atomic_load(&lock.tail)->locked) == 0);
+    clh_destroy(&lock);
+}
+
+static void test_futex_mutex(void) {
+    FutexMutex m;
+    futex_mutex_init(&m);
+    CHECK(hammer_lock(USE_FUTEX, &m) ==
+          (long)LOCK_THREADS * LOCK_ITERATIONS);
+    CHECK(atomic_load(&m.state) == 0);
+}
+
+// ---------------------------------------------------------------- seqlock
+
+#define SEQ_WRITES 20000
+#define SEQ_READERS 3
+
+// Every word of a record equals its first, so a torn read shows up as a
+// mismatch
+typedef struct {
+    uint64_t words[8];
+} SeqRecord;
+
+typedef struct {
+    SeqLock* lock;
+    SeqRecord* record;
+    atomic_int* done;
+    long torn;
+    long reads;
+} SeqArgs;
+
+static void* seq_reader(void* arg) {
+    SeqArgs* a = (SeqArgs*)arg;
+    uint64_t last = 0;
+    while (!atomic_load(a->done)) {
+        SeqRecord copy;
+        seqlock_read(a->lock, &copy, a->record, sizeof(copy));
+        for (int i = 1; i < 8; i++) {
+            a->torn += copy.words[i] != copy.words[0];
+        }
+        a->torn += copy.words[0] < last;  // versions never go backwards
+        last = copy.words[0];
+        a->reads++;
+    }
+    return NULL;
+}
+
+static void test_seqlock(void) {
+    SeqLock lock;
+    SeqRecord record = {{0}};
+    atomic_int done = 0;
+    pthread_t threads[SEQ_READERS];
+    SeqArgs args[SEQ_READERS];
+
+    seqlock_init(&lock);
+    for (int t = 0; t < SEQ_READERS; t++) {
+        args[t] = (SeqArgs){&lock, &record, &done, 0, 0};
+        pthread_create(&threads[t], NULL, seq_reader, &args[t]);
+    }
+    for (uint64_t v = 1; v <= SEQ_WRITES; v++) {
+        SeqRecord next;
+        for (int i = 0; i < 8; i++) {
+            next.words[i] = v;
+        }
+        seqlock_write(&lock, &record, &next, sizeof(next));
+        if ((v & 63) == 0) {
+            sched_yield();  // let readers in between bursts of writes
+        }
+    }
+    atomic_store(&done, 1);
+    for (int t = 0; t < SEQ_READERS; t++) {
+        pthread_join(threads[t], NULL);
+        CHECK(args[t].torn == 0);
+        CHECK(args[t].reads > 0);
+    }
+    CHECK(atomic_load(&lock.seq) == 2 * SEQ_WRITES);
+}
+
+// ---------------------------------------------------------------- RCU
+
+#define RCU_UPDATES 5000
+#define RCU_READERS 3
+#define RCU_LIVE 0x11fe11fe11fe11feULL
+#define RCU_DEAD 0xdeaddeaddeaddeadULL
+
+typedef struct RcuObject {
+    atomic_ullong magic;
+    uint64_t version;
+    struct RcuObject* next_dead;
+} RcuObject;
+
+// Retired objects are poisoned instead of freed, so a reader that could
+// still see one after its grace period reads RCU_DEAD rather than reusing
+// freed memory. Only the writer thread calls this.
+static RcuObject* graveyard = NULL;
+
+static void poison(void* p) {
+    RcuObject* obj = (RcuObject*)p;
+    atomic_store(&obj->magic, RCU_DEAD);
+    obj->next_dead = graveyard;
+    graveyard = obj;
+}
+
+typedef struct {
+    RcuDomain* domain;
+    RcuObject* _Atomic* slot;
+    atomic_int* done;
+    long dead;
+    long reads;
+} RcuArgs;
+
+static void* rcu_reader_main(void* arg) {
+    RcuArgs* a = (RcuArgs*)arg;
+    RcuReader* reader = rcu_register(a->domain);
+    uint64_t last = 0;
+    while (!atomic_load(a->done)) {
+        rcu_read_lock(reader);
+        RcuObject* obj = rcu_dereference(*a->slot);
+        for (int i = 0; i < 16; i++) {
+            a->dead += atomic_load(&obj->magic) != RCU_LIVE;
+        }
+        a->dead += obj->version < last;
+        last = obj->version;
+        rcu_read_unlock(reader);
+        a->reads++;
+    }
+    rcu_unregister(reader);
+    return NULL;
+}
+
+static RcuObject* rcu_object(uint64_t version) {
+    RcuObject* obj = malloc(sizeof(RcuObject));
+    atomic_init(&obj->magic, RCU_LIVE);
+    obj->version = version;
+    obj->next_dead = NULL;
+    return obj;
+}
+
+static void test_rcu(void) {
+    RcuDomain domain;
+    RcuObject* _Atomic slot;
+    atomic_int done = 0;
+    pthread_t threads[RCU_READERS];
+    RcuArgs args[RCU_READERS];
+
+    rcu_init(&domain);
+    atomic_init(&slot, rcu_object(0));
+    for (int t = 0; t < RCU_READERS; t++) {
+        args[t] = (RcuArgs){&domain, &slot, &done, 0, 0};
+        pthread_create(&threads[t], NULL, rcu_reader_main, &args[t]);
+    }
+    for (uint64_t v = 1; v <= RCU_UPDATES; v++) {
+        RcuObject* old = rcu_publish((void* _Atomic*)&slot, rcu_object(v));
+        rcu_retire(&domain, old, poison);
+        if ((v & 15) == 0) {
+            sched_yield();
+        }
+    }
+    atomic_store(&done, 1);
+    for (int t = 0; t < RCU_READERS; t++) {
+        pthread_join(threads[t], NULL);
+        CHECK(args[t].dead == 0);
+        CHECK(args[t].reads > 0);
+    }
+
+    // Everything but the current object is retired; after a final grace
+    // period all of it has been handed to poison
+    rcu_reclaim(&domain);
+    long dead = 0;
+    while (graveyard != NULL) {
+        RcuObject* next = graveyard->next_dead;
+        free(graveyard);
+        graveyard = next;
+        dead++;
+    }
+    CHECK(dead == RCU_UPDATES);
+    free(atomic_load(&slot));
+    rcu_destroy(&domain);
+}
+
+// ---------------------------------------------------------------- barriers
+
+#define BARRIER_EPISODES 2000
+#define BARRIER_MAX_PARTIES 5
+
+typedef struct {
+    Barrier* barrier;
+    atomic_long* progress;
+    int id;
+    int parties;
+    long errors;
+} BarrierArgs;
+
+// After episode e's barrier every party has published e, and none can be
+// past e + 1 until this thread arrives again
+static void* barrier_party(void* arg) {
+    BarrierArgs* a = (BarrierArgs*)arg;
+    for (long e = 1; e <= BARRIER_EPISODES; e++) {
+        atomic_store(&a->progress[a->id], e);
+        barrier_wait(a->barrier, a->id);
+        for (int t = 0; t < a->parties; t++) {
+            long seen = atomic_load(&a->progress[t]);
+            a->errors += seen < e || seen > e + 1;
+        }
+    }
+    return NULL;
+}
+
+static void test_barriers(void) {
+    // Includes counts that are not powers of two, where the tournament has
+    // byes and dissemination partners wrap around
+    const int parties[] = {1, 2, 3, 4, 5};
+    for (int k = BARRIER_PTHREAD; k <= BARRIER_DISSEMINATION; k++) {
+        for (size_t c = 0; c < sizeof(parties) / sizeof(parties[0]); c++) {
+            int n = parties[c];
+            Barrier* barrier = barrier_create((BarrierKind)k, n);
+            atomic_long progress[BARRIER_MAX_PARTIES];
+            pthread_t threads[BARRIER_MAX_PARTIES];
+            BarrierArgs args[BARRIER_MAX_PARTIES];
+            CHECK(barrier != NULL);
+            for (int t = 0; t < n; t++) {
+                atomic_init(&progress[t], 0);
+            }
+            for (int t = 0; t < n; t++) {
+                args[t] = (BarrierArgs){barrier, progress, t, n, 0};
+                pthread_create(&threads[t], NULL, barrier_party, &args[t]);
+            }
+            for (int t = 0; t < n; t++) {
+                pthread_join(threads[t], NULL);
+                CHECK(args[t].errors == 0);
+            }
+            barrier_destroy(barrier);
+        }
+    }
+    BarrierKind kind;
+    CHECK(barrier_kind_parse("tournament", &kind) == 0);
+    CHECK(kind == BARRIER_TOURNAMENT);
+    CHECK(barrier_kind_parse("butterfly", &kind) == -1);
+    CHECK(barrier_create(BARRIER_CENTRAL, 0) == NULL);
+}
+
+int main(void) {
+    RUN(test_spsc_full_empty_wrap);
+    RUN(test_spsc_batch);
+    RUN(test_spsc_threads);
+    RUN(test_spsc_threads_batch);
+    RUN(test_mpmc_full_empty_wrap);
+    RUN(test_mpmc_batch);
+    RUN(test_mpmc_threads);
+    RUN(test_ticket_lock);
+    RUN(test_mcs_lock);
+    RUN(test_clh_lock);
+    RUN(test_futex_mutex);
+    RUN(test_seqlock);
+    RUN(test_rcu);
+    RUN(test_barriers);
+
+    if (failures > 0) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,350 @@
+#ifndef FORK_JOIN_POOL_H
+#define FORK_JOIN_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Work-stealing fork-join pool.
+//
+// A fixed set of threads is created once. Each worker owns a Chase-Lev
+// deque: it pushes and pops spawned tasks at the bottom (LIFO, so it keeps
+// working on the most recently split, cache-hot data) and idle workers steal
+// from the top of a random victim's deque (FIFO, so a thief takes the
+// oldest and therefore largest piece of work). A skewed split just leaves
+// more stealable tasks on one deque; nothing is assigned to a thread up
+// front.
+//
+// The thread that calls run() takes part as worker 0 until the root task
+// returns. TaskGroup::wait() does not block: the waiting worker pops and
+// steals other tasks until its own children are done, so a join never
+// parks a thread that could be working.
+//
+// Spawning from a thread that is not a worker of any pool runs the task
+// inline, which keeps callers correct when they are used outside run().
+
+class ForkJoinPool;
+
+namespace fork_join_detail {
+
+struct Task {
+    virtual ~Task() = default;
+    virtual void execute() = 0;
+    std::atomic<long>* pending = nullptr;  // the spawning group's counter
+};
+
+template <typename F>
+struct FunctionTask : Task {
+    explicit FunctionTask(F&& f) : fn(std::forward<F>(f)) {}
+    void execute() override { fn(); }
+    typename std::decay<F>::type fn;
+};
+
+// Chase-Lev work-stealing deque ("Correct and Efficient Work-Stealing for
+// Weak Memory Models", Le et al., PPoPP 2013). Only the owner calls push
+// and pop; any thread may call steal. The buffer grows on demand and old
+// buffers are kept until the deque is destroyed, since a thief may still be
+// reading one.
+class WorkDeque {
+   public:
+    explicit WorkDeque(int64_t capacity = 256)
+        : top_(0), bottom_(0) {
+        buffers_.emplace_back(new Buffer(capacity));
+        buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+    }
+
+    void push(Task* task) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        Buffer* buf = buffer_.load(std::memory_order_relaxed);
+        if (b - t > buf->capacity - 1) {
+            buf = grow(buf, t, b);
+        }
+        buf->put(b, task);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    Task* pop() {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Buffer* buf = buffer_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;  // empty
+        }
+        Task* task = buf->get(b);
+        if (t == b) {
+            // Last task: race thieves for it
+            if (!top_.compare_exchange_strong(t, t + 1,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                task = nullptr;
+            }
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    Task* steal() {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        Buffer* buf = buffer_.load(std::memory_order_acquire);
+        Task* task = buf->get(t);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return nullptr;  // lost to the owner or another thief
+        }
+        return task;
+    }
+
+   private:
+    struct Buffer {
+        explicit Buffer(int64_t cap)
+            : capacity(cap), slots(new std::atomic<Task*>[cap]) {}
+        Task* get(int64_t i) const {
+            return slots[i & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+        void put(int64_t i, Task* task) {
+            slots[i & (capacity - 1)].store(task, std::memory_order_relaxed);
+        }
+        const int64_t capacity;  // power of two
+        std::unique_ptr<std::atomic<Task*>[]> slots;
+    };
+
+    Buffer* grow(Buffer* old, int64_t t, int64_t b) {
+        buffers_.emplace_back(new Buffer(old->capacity * 2));
+        Buffer* buf = buffers_.back().get();
+        for (int64_t i = t; i < b; i++) {
+            buf->put(i, old->get(i));
+        }
+        buffer_.store(buf, std::memory_order_release);
+        return buf;
+    }
+
+    alignas(64) std::atomic<int64_t> top_;
+    alignas(64) std::atomic<int64_t> bottom_;
+    std::atomic<Buffer*> buffer_;
+    std::vector<std::unique_ptr<Buffer>> buffers_;  // owner only
+};
+
+}  // namespace fork_join_detail
+
+class ForkJoinPool {
+   public:
+    explicit ForkJoinPool(
+        int num_threads = static_cast<int>(std::thread::hardware_concurrency()))
+        : workers_(std::max(num_threads, 1)) {
+        for (size_t w = 0; w < workers_.size(); w++) {
+            workers_[w].pool = this;
+            workers_[w].index = static_cast<int>(w);
+            workers_[w].rng.seed(static_cast<unsigned>(w) * 2654435761u + 1);
+        }
+        // Worker 0 is whichever thread calls run()
+        threads_.reserve(workers_.size() - 1);
+        for (size_t w = 1; w < workers_.size(); w++) {
+            threads_.emplace_back([this, w]() { worker_loop(&workers_[w]); });
+        }
+    }
+
+    ForkJoinPool(const ForkJoinPool&) = delete;
+    ForkJoinPool& operator=(const ForkJoinPool&) = delete;
+
+    ~ForkJoinPool() {
+        stopping_.store(true);
+        wake_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    // Run root() as worker 0 on the calling thread and return when it does.
+    // Tasks spawned inside it go to this pool's workers. Call from one
+    // thread at a time.
+    template <typename F>
+    void run(F&& root) {
+        Worker* saved = current_;
+        current_ = &workers_[0];
+        root();
+        current_ = saved;
+    }
+
+    int num_threads() const { return static_cast<int>(workers_.size()); }
+
+    // Shared pool with one worker per hardware thread
+    static ForkJoinPool& default_pool() {
+        static ForkJoinPool pool;
+        return pool;
+    }
+
+   private:
+    friend class TaskGroup;
+    using Task = fork_join_detail::Task;
+
+    // Failed steal sweeps before an idle worker goes to sleep
+    static constexpr int kStealRounds = 64;
+
+    struct alignas(64) Worker {
+        ForkJoinPool* pool = nullptr;
+        int index = 0;
+        fork_join_detail::WorkDeque deque;
+        std::minstd_rand rng;
+    };
+
+    static Worker* current() { return current_; }
+
+    void push(Worker* self, Task* task) {
+        self->deque.push(task);
+        // seq_cst pairs with the idle count in sleep(): either the sleeper
+        // sees the new epoch or we see it counted and wake it
+        epoch_.fetch_add(1);
+        if (sleeping_.load() > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            work_ready_.notify_one();
+        }
+    }
+
+    // One attempt at finding work: own deque first, then one pass over
+    // the others starting at a random victim
+    Task* find_task(Worker* self) {
+        if (Task* task = self->deque.pop()) {
+            return task;
+        }
+        const int n = num_threads();
+        if (n == 1) {
+            return nullptr;
+        }
+        int start = static_cast<int>(self->rng() % n);
+        for (int i = 0; i < n; i++) {
+            int victim = (start + i) % n;
+            if (victim == self->index) {
+                continue;
+            }
+            if (Task* task = workers_[victim].deque.steal()) {
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    static void execute(Task* task) {
+        std::atomic<long>* pending = task->pending;
+        task->execute();
+        delete task;
+        pending->fetch_sub(1, std::memory_order_release);
+    }
+
+    void worker_loop(Worker* self) {
+        current_ = self;
+        int idle_rounds = 0;
+        while (!stopping_.load(std::memory_order_relaxed)) {
+            uint64_t seen = epoch_.load();
+            if (Task* task = find_task(self)) {
+                execute(task);
+                idle_rounds = 0;
+            } else if (++idle_rounds < kStealRounds) {
+                std::this_thread::yield();
+            } else {
+                sleep(seen);
+                idle_rounds = 0;
+            }
+        }
+        current_ = nullptr;
+    }
+
+    // Sleep until a push after `seen` or shutdown
+    void sleep(uint64_t seen) {
+        sleeping_.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_ready_.wait(lock, [this, seen]() {
+                return epoch_.load() != seen || stopping_.load();
+            });
+        }
+        sleeping_.fetch_sub(1);
+    }
+
+    void wake_all() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        work_ready_.notify_all();
+    }
+
+    std::vector<Worker> workers_;
+    std::vector<std::thread> threads_;
+    alignas(64) std::atomic<uint64_t> epoch_{0};  // bumped on every push
+    std::atomic<int> sleeping_{0};
+    std::atomic<bool> stopping_{false};
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+
+    static inline thread_local Worker* current_ = nullptr;
+};
+
+// A set of spawned tasks joined by wait(). The destructor waits, so tasks
+// never outlive the stack frame whose data they reference.
+class TaskGroup {
+   public:
+    TaskGroup() = default;
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+    ~TaskGroup() { wait(); }
+
+    // Make f available to other workers; runs it inline outside a pool
+    template <typename F>
+    void spawn(F&& f) {
+        ForkJoinPool::Worker* self = ForkJoinPool::current();
+        if (self == nullptr) {
+            f();
+            return;
+        }
+        auto* task = new fork_join_detail::FunctionTask<F>(std::forward<F>(f));
+        task->pending = &pending_;
+        pending_.fetch_add(1, std::memory_order_relaxed);
+        self->pool->push(self, task);
+    }
+
+    // Return once every spawned task has finished, running other tasks
+    // (ours or stolen) meanwhile
+    void wait() {
+        ForkJoinPool::Worker* self = ForkJoinPool::current();
+        while (pending_.load(std::memory_order_acquire) > 0) {
+            if (fork_join_detail::Task* task = self->pool->find_task(self)) {
+                ForkJoinPool::execute(task);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+   private:
+    std::atomic<long> pending_{0};
+};
+
+// Run body(0) .. body(count - 1) as tasks and join them. body(0) runs on the
+// calling worker; the rest are spawned for thieves.
+template <typename F>
+void fork_join_each(int count, const F& body) {
+    TaskGroup tasks;
+    for (int i = 1; i < count; i++) {
+        tasks.spawn([&body, i]() { body(i); });
+    }
+    if (count > 0) {
+        body(0);
+    }
+    tasks.wait();
+}
+
+#endif  // FORK_JOIN_POOL_H
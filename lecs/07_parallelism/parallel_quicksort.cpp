@@ -1,98 +1,481 @@
 #include <algorithm>
 #include <chrono>
+#include <cstdlib>
 #include <functional>
-#include <future>
 #include <iostream>
 #include <random>
+#include <string>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
-// Sequential quicksort implementation
+#include "fj_instrument.h"  // Fork-join hooks for the race detector
+#include "fork_join_pool.h"
+#include "pdq_sort.h"
+#include "radix_sort.h"
+#include "sample_sort.h"
+#include "simd_sort.h"
+
+// Swap two elements, reporting both writes to the fork-join instrumentation
 template <typename T>
-void quicksort_seq(std::vector<T>& arr, int left, int right) {
-    if (left >= right) {
-        return;
-    }
+inline void fj_swap(T& a, T& b) {
+    FJ_WRITE(&a);
+    FJ_WRITE(&b);
+    std::swap(a, b);
+}
+
+// Read an element, reporting the read to the fork-join instrumentation
+template <typename T>
+inline const T& fj_read(const T& x) {
+    FJ_READ(&x);
+    return x;
+}
+
+// A run of array indices [begin, end)
+struct Interval {
+    int begin;
+    int end;
+};
 
-    // Choose pivot (median of three)
+// Median of arr[left], arr[mid] and arr[right], moved to arr[right]
+template <typename T>
+void select_pivot(std::vector<T>& arr, int left, int right) {
     int mid = left + (right - left) / 2;
+    FJ_READ(&arr[left]);
+    FJ_READ(&arr[mid]);
+    FJ_READ(&arr[right]);
     if (arr[mid] < arr[left]) {
-        std::swap(arr[left], arr[mid]);
+        fj_swap(arr[left], arr[mid]);
     }
     if (arr[right] < arr[left]) {
-        std::swap(arr[left], arr[right]);
+        fj_swap(arr[left], arr[right]);
     }
     if (arr[mid] < arr[right]) {
-        std::swap(arr[mid], arr[right]);
+        fj_swap(arr[mid], arr[right]);
     }
-    T pivot = arr[right];
+}
 
-    // Partition
-    int i = left - 1;
-    for (int j = left; j < right; j++) {
-        if (arr[j] <= pivot) {
-            i++;
-            std::swap(arr[i], arr[j]);
+// Median-of-three pivot and Bentley-McIlroy three-way partition of
+// [left, right]. Keys equal to the pivot are swapped to the two ends as the
+// scans meet them and moved next to the pivot at the end, so a run of equal
+// keys is settled by this one pass. Returns the run of keys equal to the
+// pivot; the keys before it are smaller and the keys after it larger.
+template <typename T>
+Interval partition_3way(std::vector<T>& arr, int left, int right) {
+    select_pivot(arr, left, right);
+    const T pivot = arr[right];
+
+    // arr[right] == pivot stops the upward scan. [left, p) and [q, right)
+    // collect keys equal to the pivot.
+    int i = left - 1, j = right;
+    int p = left, q = right;
+    for (;;) {
+        while (fj_read(arr[++i]) < pivot) {
+        }
+        while (j > left && pivot < fj_read(arr[--j])) {
+        }
+        if (i >= j) {
+            break;
+        }
+        fj_swap(arr[i], arr[j]);  // now arr[i] <= pivot <= arr[j]
+        if (!(arr[i] < pivot)) {
+            fj_swap(arr[p++], arr[i]);
+        }
+        if (!(pivot < arr[j])) {
+            fj_swap(arr[--q], arr[j]);
         }
     }
-    i++;
-    std::swap(arr[i], arr[right]);
 
-    // Recursive calls
-    quicksort_seq(arr, left, i - 1);
-    quicksort_seq(arr, i + 1, right);
+    // [p, i) is smaller than the pivot and [i, q) larger: move the pivot to
+    // i and the equal keys from both ends next to it
+    fj_swap(arr[i], arr[right]);
+    int lt = i, gt = i + 1;
+    for (int k = left; k < p; k++) {
+        fj_swap(arr[k], arr[--lt]);
+    }
+    for (int k = right - 1; k >= q; k--) {
+        fj_swap(arr[k], arr[gt++]);
+    }
+    return {lt, gt};
 }
 
-// Parallel quicksort implementation
+// Heapsort of [left, right], for ranges quicksort keeps partitioning badly
 template <typename T>
-void quicksort_parallel(std::vector<T>& arr, int left, int right,
-                        int depth = 0) {
-    // Use sequential sort when the array is small or we've reached max
-    // recursion depth
-    const int SEQUENTIAL_THRESHOLD = 10000;
-    const int MAX_DEPTH = 4;  // Limit thread creation depth
-
-    if (right - left <= SEQUENTIAL_THRESHOLD || depth >= MAX_DEPTH) {
-        quicksort_seq(arr, left, right);
-        return;
+void heapsort_range(std::vector<T>& arr, int left, int right) {
+    const int n = right - left + 1;
+    T* a = arr.data() + left;
+    auto sift_down = [a](int root, int size) {
+        for (;;) {
+            int child = 2 * root + 1;
+            if (child >= size) {
+                return;
+            }
+            if (child + 1 < size &&
+                fj_read(a[child]) < fj_read(a[child + 1])) {
+                child++;
+            }
+            if (!(fj_read(a[root]) < fj_read(a[child]))) {
+                return;
+            }
+            fj_swap(a[root], a[child]);
+            root = child;
+        }
+    };
+    for (int root = n / 2 - 1; root >= 0; root--) {
+        sift_down(root, n);
+    }
+    for (int end = n - 1; end > 0; end--) {
+        fj_swap(a[0], a[end]);
+        sift_down(0, end);
     }
+}
 
-    // Choose pivot (median of three)
-    int mid = left + (right - left) / 2;
-    if (arr[mid] < arr[left]) {
-        std::swap(arr[left], arr[mid]);
+// Partitioning depth after which a quicksort gives up on its pivots: twice
+// the depth of perfectly balanced partitions
+inline int depth_limit(long n) {
+    int log = 0;
+    while (n > 1) {
+        n >>= 1;
+        log++;
     }
-    if (arr[right] < arr[left]) {
-        std::swap(arr[left], arr[right]);
+    return 2 * log;
+}
+
+// Sequential introsort of [left, right]. Three-way partitions leave runs
+// of equal keys out of both sides. Recursing into the smaller side and
+// looping on the larger keeps the stack within log2(n) frames; after
+// `depth` partitions along one path the range is heapsorted, which bounds
+// the worst case by O(n log n).
+template <typename T>
+void quicksort_seq(std::vector<T>& arr, int left, int right, int depth) {
+    while (left < right) {
+        if (depth-- == 0) {
+            heapsort_range(arr, left, right);
+            return;
+        }
+        Interval equal = partition_3way(arr, left, right);
+        if (equal.begin - left < right + 1 - equal.end) {
+            quicksort_seq(arr, left, equal.begin - 1, depth);
+            left = equal.end;
+        } else {
+            quicksort_seq(arr, equal.end, right, depth);
+            right = equal.begin - 1;
+        }
     }
-    if (arr[mid] < arr[right]) {
-        std::swap(arr[mid], arr[right]);
+}
+
+template <typename T>
+void quicksort_seq(std::vector<T>& arr, int left, int right) {
+    quicksort_seq(arr, left, right, depth_limit(right - left + 1));
+}
+
+// Run body(0) .. body(count - 1) as parallel tasks and join them
+template <typename F>
+void fork_each(int count, const F& body) {
+#if FJ_INSTRUMENTED
+    for (int c = 0; c < count; c++) {
+        FJ_SPAWN_SCOPE;
+        body(c);
     }
-    T pivot = arr[right];
+    FJ_SYNC();
+#else
+    fork_join_each(count, body);
+#endif
+}
 
-    // Partition
-    int i = left - 1;
-    for (int j = left; j < right; j++) {
-        if (arr[j] <= pivot) {
+// Hoare-style partition of [begin, end) into the elements for which
+// is_small holds and the rest; returns the first index of the rest
+template <typename T, typename Small>
+int partition_range(std::vector<T>& arr, int begin, int end,
+                    const Small& is_small) {
+    int i = begin, j = end;
+    for (;;) {
+        while (i < j && is_small(fj_read(arr[i]))) {
             i++;
-            std::swap(arr[i], arr[j]);
         }
+        while (i < j && !is_small(fj_read(arr[j - 1]))) {
+            j--;
+        }
+        if (i >= j) {
+            return i;
+        }
+        fj_swap(arr[i], arr[j - 1]);  // arr[i] is large, arr[j - 1] small
+        i++;
+        j--;
+    }
+}
+
+// Partition predicate against a pivot: the keys below it, or with or_equal
+// the keys not above it
+template <typename T>
+struct PivotTest {
+    T pivot;
+    bool or_equal;
+    bool operator()(const T& x) const {
+        return or_equal ? !(pivot < x) : x < pivot;
+    }
+};
+
+// Partition by a pivot. Uninstrumented builds use the vector kernel of
+// simd_partition where the key type and CPU allow it.
+template <typename T>
+int partition_range(std::vector<T>& arr, int begin, int end,
+                    const PivotTest<T>& test) {
+#if !FJ_INSTRUMENTED
+    if (simd_sort_level<T>() != SimdLevel::SCALAR) {
+        T* base = arr.data();
+        return static_cast<int>(simd_partition(base + begin, base + end,
+                                               test.pivot, test.or_equal) -
+                                base);
     }
-    i++;
-    std::swap(arr[i], arr[right]);
+#endif
+    // The generic Hoare loop above
+    return partition_range<T, PivotTest<T>>(arr, begin, end, test);
+}
 
-    // Launch a new thread for the left part and do the right part in the
-    // current thread
-    std::future<void> left_future =
-        std::async(std::launch::async, [&arr, left, i, depth]() {
-            quicksort_parallel(arr, left, i - 1, depth + 1);
+// Swap the elements of rank [lo, hi) in `a` with those of the same rank in
+// `b`, where ranks count through the concatenated intervals of each list
+template <typename T>
+void swap_ranks(std::vector<T>& arr, const std::vector<Interval>& a,
+                const std::vector<Interval>& b, long lo, long hi) {
+    size_t ia = 0, ib = 0;
+    long oa = lo, ob = lo;  // offsets into a[ia] and b[ib]
+    while (oa >= a[ia].end - a[ia].begin) {
+        oa -= a[ia].end - a[ia].begin;
+        ia++;
+    }
+    while (ob >= b[ib].end - b[ib].begin) {
+        ob -= b[ib].end - b[ib].begin;
+        ib++;
+    }
+    for (long r = lo; r < hi;) {
+        long run = std::min({a[ia].end - a[ia].begin - oa,
+                             b[ib].end - b[ib].begin - ob, hi - r});
+        for (long x = 0; x < run; x++) {
+            fj_swap(arr[a[ia].begin + oa + x], arr[b[ib].begin + ob + x]);
+        }
+        r += run;
+        oa += run;
+        ob += run;
+        if (oa == a[ia].end - a[ia].begin) {
+            ia++;
+            oa = 0;
+        }
+        if (ob == b[ib].end - b[ib].begin) {
+            ib++;
+            ob = 0;
+        }
+    }
+}
+
+// Each task of a parallel partition handles at least this many elements
+const int PARTITION_BLOCK = 1 << 14;
+
+// In-place parallel partition of [begin, end) into `tasks` pieces by
+// is_small, with the same result as partition_range.
+//
+// Phase 1 splits the range into contiguous chunks and partitions each one
+// locally, in parallel. The small elements then number S, so the boundary
+// belongs at begin + S; every large element left of it and every small
+// element right of it is misplaced, and there are equally many of each.
+// Both sets are unions of at most one interval per chunk, so phase 2 cuts
+// their ranks into equal pieces and swaps pairs in parallel. Span is
+// O(n / tasks + tasks) instead of the O(n) of a serial partition.
+template <typename T, typename Small>
+int partition_parallel_by(std::vector<T>& arr, int begin, int end, int tasks,
+                          const Small& is_small) {
+    const long n = end - begin;
+    auto chunk_begin = [begin, n, tasks](int c) {
+        return begin + static_cast<int>(n * c / tasks);
+    };
+
+    // Phase 1: local partitions
+    std::vector<int> split(tasks);
+    fork_each(tasks, [&](int c) {
+        split[c] = partition_range(arr, chunk_begin(c), chunk_begin(c + 1),
+                                   is_small);
+    });
+
+    int mid = begin;
+    for (int c = 0; c < tasks; c++) {
+        mid += split[c] - chunk_begin(c);
+    }
+
+    // Phase 2: swap misplaced large elements with misplaced small ones
+    std::vector<Interval> large, small;
+    long misplaced = 0;
+    for (int c = 0; c < tasks; c++) {
+        int from = chunk_begin(c), to = chunk_begin(c + 1), m = split[c];
+        if (m < std::min(to, mid)) {
+            large.push_back({m, std::min(to, mid)});
+            misplaced += std::min(to, mid) - m;
+        }
+        if (std::max(from, mid) < m) {
+            small.push_back({std::max(from, mid), m});
+        }
+    }
+    if (misplaced > 0) {
+        int pieces = static_cast<int>(std::max(
+            1L, std::min<long>(tasks, misplaced / PARTITION_BLOCK)));
+        fork_each(pieces, [&](int p) {
+            swap_ranks(arr, large, small, misplaced * p / pieces,
+                       misplaced * (p + 1) / pieces);
         });
+    }
+    return mid;
+}
 
-    // Sort the right part
-    quicksort_parallel(arr, i + 1, right, depth + 1);
+// Parallel three-way partition of [left, right] with the same result
+// contract as partition_3way. The first pass splits the keys <= pivot from
+// the larger ones. A median of three equal to one of the other samples
+// suggests many copies of the pivot; a second pass over the keys <= pivot
+// then splits off the equal ones, which would otherwise all go to the left
+// part and be partitioned again at every level below.
+template <typename T>
+Interval partition_parallel(std::vector<T>& arr, int left, int right,
+                            int tasks) {
+    select_pivot(arr, left, right);
+    const T pivot = arr[right];
+    const bool duplicates =
+        !(fj_read(arr[left]) < pivot) ||
+        !(pivot < fj_read(arr[left + (right - left) / 2]));
 
-    // Wait for the left part to complete
-    left_future.wait();
+    // The pivot at arr[right] stays out of the first pass
+    int mid = partition_parallel_by(arr, left, right, tasks,
+                                    PivotTest<T>{pivot, true});
+    fj_swap(arr[mid], arr[right]);
+    if (!duplicates) {
+        return {mid, mid + 1};
+    }
+
+    const PivotTest<T> is_less{pivot, false};
+    int pieces = std::min(tasks, (mid - left) / PARTITION_BLOCK);
+    int lt = pieces > 1 ? partition_parallel_by(arr, left, mid, pieces, is_less)
+                        : partition_range(arr, left, mid, is_less);
+    return {lt, mid + 1};
+}
+
+// Ranges this small are never split: a spawn costs about as much as
+// sorting them
+const int MIN_PARALLEL_RANGE = 4096;
+
+// Ranges are split until they hold about 1/(8p) of the input. Eight leaves
+// per worker give thieves enough pieces to even out skewed partitions;
+// the cutoff grows with n so the number of tasks stays O(p), not O(n).
+inline int parallel_cutoff(size_t n, int num_threads) {
+    size_t leaf = n / (8 * static_cast<size_t>(std::max(num_threads, 1)));
+    return static_cast<int>(
+        std::max(leaf, static_cast<size_t>(MIN_PARALLEL_RANGE)));
+}
+
+// Parameters fixed for one parallel sort
+struct ParallelSortConfig {
+    int cutoff;               // ranges shorter than this sort sequentially
+    int width;                // workers available
+    long total;               // elements in the whole sort
+    bool parallel_partition;  // partition large ranges in parallel
+};
+
+// Workers a range of n elements can use for its partition: its share of
+// the pool, as the other ranges at this depth are being sorted alongside
+inline int partition_tasks(long n, const ParallelSortConfig& config) {
+    if (!config.parallel_partition) {
+        return 1;
+    }
+    long share = (n * config.width + config.total - 1) / config.total;
+    return static_cast<int>(std::max(1L, std::min(share, n / PARTITION_BLOCK)));
+}
+
+// Fork-join introsort: the smaller part of each partition is spawned for
+// thieves and this worker loops on the larger one. Ranges below the cutoff,
+// or still large after `depth` partitions, are sorted sequentially.
+template <typename T>
+void quicksort_fork(std::vector<T>& arr, int left, int right,
+                    const ParallelSortConfig& config, int depth) {
+#if FJ_INSTRUMENTED
+    const bool vector_partition = false;
+#else
+    const bool vector_partition = simd_sort_level<T>() != SimdLevel::SCALAR;
+    TaskGroup tasks;
+#endif
+    while (right - left >= config.cutoff && depth-- > 0) {
+        int pieces = partition_tasks(right - left + 1, config);
+        // The vector kernel is worth the parallel partition's two passes on
+        // duplicates even for a single piece
+        Interval equal = pieces > 1 || vector_partition
+                             ? partition_parallel(arr, left, right, pieces)
+                             : partition_3way(arr, left, right);
+        int lo = left, hi = equal.begin - 1;  // the smaller part
+        if (equal.begin - left < right + 1 - equal.end) {
+            left = equal.end;
+        } else {
+            lo = equal.end;
+            hi = right;
+            right = equal.begin - 1;
+        }
+#if FJ_INSTRUMENTED
+        // Serial elision for the analysis tools: the spawned part runs to
+        // completion first, then the continuation, then the join
+        {
+            FJ_SPAWN_SCOPE;
+            quicksort_fork(arr, lo, hi, config, depth);
+        }
+#else
+        tasks.spawn([&arr, lo, hi, &config, depth]() {
+            quicksort_fork(arr, lo, hi, config, depth);
+        });
+#endif
+    }
+
+#if FJ_INSTRUMENTED
+    // quicksort_seq reports its accesses to the analysis tools
+    quicksort_seq(arr, left, right);
+    FJ_SYNC();
+#else
+    simd_sort(arr.data() + left, arr.data() + right + 1);
+    tasks.wait();
+#endif
+}
+
+// Workers assumed by the instrumented builds, which run the serial elision
+// but should still take the parallel code paths
+const int FJ_NOMINAL_WORKERS = 8;
+
+// Parallel quicksort on a work-stealing pool. Ranges large enough for
+// several workers are partitioned in parallel unless parallel_partition is
+// false, which leaves the O(n) top-level partition serial.
+template <typename T>
+void quicksort_parallel(std::vector<T>& arr, int left, int right,
+                        ForkJoinPool& pool, bool parallel_partition = true) {
+    if (left >= right) {
+        return;
+    }
+    long n = right - left + 1;
+#if FJ_INSTRUMENTED
+    int width = FJ_NOMINAL_WORKERS;
+#else
+    int width = pool.num_threads();
+#endif
+    ParallelSortConfig config = {parallel_cutoff(n, width), width, n,
+                                 parallel_partition};
+#if FJ_INSTRUMENTED
+    (void)pool;
+    quicksort_fork(arr, left, right, config, depth_limit(n));
+#else
+    pool.run(
+        [&]() { quicksort_fork(arr, left, right, config, depth_limit(n)); });
+#endif
+}
+
+template <typename T>
+void quicksort_parallel(std::vector<T>& arr, int left, int right) {
+#if FJ_INSTRUMENTED
+    // The tools run the serial elision; no worker threads are needed
+    ForkJoinPool pool(1);
+#else
+    ForkJoinPool& pool = ForkJoinPool::default_pool();
+#endif
+    quicksort_parallel(arr, left, right, pool);
 }
 
 // Function to check if a vector is sorted
@@ -101,87 +484,353 @@ bool is_sorted(const std::vector<T>& arr) {
     return std::is_sorted(arr.begin(), arr.end());
 }
 
+// Uniform distribution over [min, max] for integer or floating-point keys
+template <typename T>
+using UniformDistribution =
+    typename std::conditional<std::is_floating_point<T>::value,
+                              std::uniform_real_distribution<T>,
+                              std::uniform_int_distribution<T>>::type;
+
+// Fill a vector with uniform values from a fixed seed, so a benchmark can
+// regenerate the same input instead of keeping a copy
+template <typename T>
+void fill_random(std::vector<T>& vec, T min_val, T max_val, unsigned seed) {
+    std::mt19937_64 gen(seed);
+    UniformDistribution<T> dist(min_val, max_val);
+
+    for (size_t i = 0; i < vec.size(); ++i) {
+        vec[i] = dist(gen);
+    }
+}
+
 // Function to generate a random vector
 template <typename T>
 std::vector<T> generate_random_vector(size_t size, T min_val, T max_val) {
     std::vector<T> vec(size);
     std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<T> dist(min_val, max_val);
+    fill_random(vec, min_val, max_val, rd());
+    return vec;
+}
 
-    for (size_t i = 0; i < size; ++i) {
-        vec[i] = dist(gen);
-    }
+// Order of the keys handed to a benchmark; how many distinct keys there
+// are is set by the value range
+enum class InputOrder { RANDOM, SORTED, REVERSED, NEARLY_SORTED };
 
-    return vec;
+// Put random keys into `order`. Nearly sorted swaps 1% of the keys of a
+// sorted vector with random partners.
+template <typename T>
+void arrange(std::vector<T>& vec, InputOrder order) {
+    if (order == InputOrder::RANDOM) {
+        return;
+    }
+    std::sort(vec.begin(), vec.end());
+    if (order == InputOrder::REVERSED) {
+        std::reverse(vec.begin(), vec.end());
+    } else if (order == InputOrder::NEARLY_SORTED && !vec.empty()) {
+        std::mt19937_64 gen(vec.size());
+        std::uniform_int_distribution<size_t> pick(0, vec.size() - 1);
+        for (size_t k = 0; k < vec.size() / 100; k++) {
+            std::swap(vec[pick(gen)], vec[pick(gen)]);
+        }
+    }
 }
 
+// A sort under benchmark; the first one of a benchmark is the reference
+template <typename T>
+struct SortEngine {
+    const char* label;  // padded name for the report
+    std::function<void(std::vector<T>&)> sort;
+    double total = 0.0;
+};
+
 // Benchmark function
 template <typename T>
-void benchmark(size_t size, T min_val, T max_val, int num_runs = 5) {
-    std::cout << "Running benchmark with vector size: " << size << std::endl;
+void benchmark(ForkJoinPool& pool, size_t size, T min_val, T max_val,
+               int num_runs = 5, InputOrder order = InputOrder::RANDOM) {
+    std::cout << "Running benchmark with vector size: " << size
+              << " (simd sort: " << simd_level_name(simd_sort_level<T>())
+              << ")" << std::endl;
 
-    double total_std_sort = 0.0;
-    double total_parallel_sort = 0.0;
+    std::vector<SortEngine<T>> engines = {
+        {"std::sort:        ",
+         [](std::vector<T>& v) { std::sort(v.begin(), v.end()); }},
+        {"sequential quicksort: ",
+         [](std::vector<T>& v) {
+             quicksort_seq(v, 0, static_cast<int>(v.size()) - 1);
+         }},
+        {"sequential pdqsort: ",
+         [](std::vector<T>& v) { pdq_sort(v.begin(), v.end()); }},
+        {"sequential simd sort: ",
+         [](std::vector<T>& v) { simd_sort(v.data(), v.data() + v.size()); }},
+        {"parallel quicksort: ",
+         [&pool](std::vector<T>& v) {
+             quicksort_parallel(v, 0, static_cast<int>(v.size()) - 1, pool);
+         }},
+        {"parallel sample sort: ",
+         [&pool](std::vector<T>& v) { sample_sort(v, pool); }},
+        {"parallel radix sort: ",
+         [&pool](std::vector<T>& v) { radix_sort(v, pool); }},
+    };
 
     for (int run = 0; run < num_runs; ++run) {
         // Generate random vectors
-        std::vector<T> vec_std =
+        std::vector<T> input =
             generate_random_vector<T>(size, min_val, max_val);
-        std::vector<T> vec_parallel = vec_std;  // Make a copy
-
-        // Benchmark std::sort
-        auto start_std = std::chrono::high_resolution_clock::now();
-        std::sort(vec_std.begin(), vec_std.end());
-        auto end_std = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> elapsed_std = end_std - start_std;
-        total_std_sort += elapsed_std.count();
-
-        // Benchmark parallel quicksort
-        auto start_parallel = std::chrono::high_resolution_clock::now();
-        quicksort_parallel(vec_parallel, 0, vec_parallel.size() - 1);
-        auto end_parallel = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> elapsed_parallel =
-            end_parallel - start_parallel;
-        total_parallel_sort += elapsed_parallel.count();
-
-        // Verify sorting
-        bool std_sorted = is_sorted(vec_std);
-        bool parallel_sorted = is_sorted(vec_parallel);
+        arrange(input, order);
+        std::vector<T> reference;
 
         std::cout << "Run " << run + 1 << ":" << std::endl;
-        std::cout << "  std::sort:        " << elapsed_std.count()
-                  << "s (correctly sorted: " << (std_sorted ? "yes" : "no")
-                  << ")" << std::endl;
-        std::cout << "  parallel quicksort: " << elapsed_parallel.count()
-                  << "s (correctly sorted: " << (parallel_sorted ? "yes" : "no")
-                  << ")" << std::endl;
+        for (SortEngine<T>& engine : engines) {
+            std::vector<T> vec = input;  // Make a copy
+            auto start = std::chrono::high_resolution_clock::now();
+            engine.sort(vec);
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> elapsed = end - start;
+            engine.total += elapsed.count();
+
+            // Verify sorting: sorted, and the same keys as the reference
+            bool sorted = is_sorted(vec);
+            if (reference.empty()) {
+                reference = std::move(vec);
+            } else {
+                sorted = sorted && vec == reference;
+            }
+            std::cout << "  " << engine.label << elapsed.count()
+                      << "s (correctly sorted: " << (sorted ? "yes" : "no")
+                      << ")" << std::endl;
+        }
 
         // Add a small delay between runs
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
 
-    // Calculate and display average times
-    double avg_std_sort = total_std_sort / num_runs;
-    double avg_parallel_sort = total_parallel_sort / num_runs;
-    double speedup = avg_std_sort / avg_parallel_sort;
-
+    // Calculate and display average times, throughput and speedup over
+    // the reference
+    double avg_reference = engines[0].total / num_runs;
     std::cout << "\nAverage times over " << num_runs << " runs:" << std::endl;
-    std::cout << "  std::sort:        " << avg_std_sort << "s" << std::endl;
-    std::cout << "  parallel quicksort: " << avg_parallel_sort << "s"
+    for (const SortEngine<T>& engine : engines) {
+        double avg = engine.total / num_runs;
+        std::cout << "  " << engine.label << avg << "s ("
+                  << size / avg / 1e6 << " Mkeys/s)" << std::endl;
+        if (&engine != &engines[0]) {
+            std::cout << "  Speed up: " << avg_reference / avg << "x"
+                      << std::endl;
+        }
+    }
+}
+
+#if FJ_INSTRUMENTED
+// Instrumented build (race detector or work/span profiler): sort one input
+// as the serial elision and print the tool's report.
+// Usage: ./parallel_quicksort_{race,workspan} [size]
+int main(int argc, char* argv[]) {
+    // Large enough that the top-level partition runs in parallel
+    size_t size = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    std::vector<int> vec = generate_random_vector<int>(size, 1, 1000000);
+    {
+        FJ_REGION("quicksort_parallel");
+        quicksort_parallel(vec, 0, vec.size() - 1);
+    }
+    // Few distinct keys take the three-way parallel partition
+    std::vector<int> few = generate_random_vector<int>(size, 1, 4);
+    {
+        FJ_REGION("quicksort_parallel, 4 distinct keys");
+        quicksort_parallel(few, 0, few.size() - 1);
+    }
+    int status = FJ_REPORT();
+    bool sorted = is_sorted(vec) && is_sorted(few);
+    std::cout << "Correctly sorted: " << (sorted ? "yes" : "no") << std::endl;
+    return status == 0 && sorted ? 0 : 1;
+}
+#else
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+}
+
+// Speedup curve of quicksort_parallel with the serial and the parallel
+// top-level partition, of sample_sort and of radix_sort, written as CSV to
+// stdout. Each size is sorted with 1, 2, 4, ... max_threads workers (and
+// max_threads itself); speedup is against std::sort on the same input,
+// which the sequential pdq_sort and simd_sort are also measured against.
+// Inputs are int keys in [1, 1e6] regenerated from one seed per trial, so a
+// size needs 4 bytes per element (4 GB at 1e9), plus 5 more per element for
+// the scratch of sample_sort and 4 for radix_sort.
+int run_speedup(int argc, char* argv[]) {
+    int max_threads = static_cast<int>(std::thread::hardware_concurrency());
+    int trials = 3;
+    std::vector<size_t> sizes = {1000000, 10000000, 100000000, 1000000000};
+    if (argc > 0) {
+        max_threads = std::atoi(argv[0]);
+    }
+    if (argc > 1) {
+        trials = std::atoi(argv[1]);
+    }
+    if (argc > 2) {
+        sizes.clear();
+        for (int a = 2; a < argc; a++) {
+            sizes.push_back(std::strtoul(argv[a], nullptr, 10));
+        }
+    }
+    if (max_threads < 1 || trials < 1) {
+        std::cerr << "Usage: parallel_quicksort --speedup [max_threads] "
+                     "[trials] [size ...]"
+                  << std::endl;
+        return 1;
+    }
+    std::vector<int> thread_counts;
+    for (int p = 1; p < max_threads; p *= 2) {
+        thread_counts.push_back(p);
+    }
+    thread_counts.push_back(max_threads);
+
+    std::cout << "driver,size,threads,trials,median_s,speedup,mkeys_per_s"
               << std::endl;
-    std::cout << "  Speed up: " << speedup << "x" << std::endl;
+    for (size_t size : sizes) {
+        std::vector<int> vec(size);
+        auto median_of = [&](const std::function<void()>& sort) {
+            std::vector<double> times;
+            for (int t = 0; t < trials; t++) {
+                fill_random(vec, 1, 1000000, 12345u + t);
+                auto start = std::chrono::steady_clock::now();
+                sort();
+                times.push_back(seconds_since(start));
+                if (!is_sorted(vec)) {
+                    std::cerr << "Not sorted at size " << size << std::endl;
+                    std::exit(1);
+                }
+            }
+            std::sort(times.begin(), times.end());
+            return times[times.size() / 2];
+        };
+
+        double std_time =
+            median_of([&]() { std::sort(vec.begin(), vec.end()); });
+        std::cout << "std::sort," << size << ",1," << trials << ","
+                  << std_time << ",1," << size / std_time / 1e6 << std::endl;
+        double pdq_time =
+            median_of([&]() { pdq_sort(vec.begin(), vec.end()); });
+        std::cout << "pdqsort," << size << ",1," << trials << "," << pdq_time
+                  << "," << std_time / pdq_time << ","
+                  << size / pdq_time / 1e6 << std::endl;
+        double simd_time = median_of(
+            [&]() { simd_sort(vec.data(), vec.data() + vec.size()); });
+        std::cout << "simdsort," << size << ",1," << trials << ","
+                  << simd_time << "," << std_time / simd_time << ","
+                  << size / simd_time / 1e6 << std::endl;
+        for (int parallel_partition = 0; parallel_partition <= 1;
+             parallel_partition++) {
+            for (int p : thread_counts) {
+                ForkJoinPool pool(p);
+                double t = median_of([&]() {
+                    quicksort_parallel(vec, 0, static_cast<int>(size) - 1,
+                                       pool, parallel_partition != 0);
+                });
+                std::cout << (parallel_partition ? "quicksort-parpart"
+                                                 : "quicksort-serpart")
+                          << "," << size << "," << p << "," << trials << ","
+                          << t << "," << std_time / t << ","
+                          << size / t / 1e6 << std::endl;
+            }
+        }
+        for (int p : thread_counts) {
+            ForkJoinPool pool(p);
+            double t = median_of([&]() { sample_sort(vec, pool); });
+            std::cout << "samplesort," << size << "," << p << "," << trials
+                      << "," << t << "," << std_time / t << ","
+                      << size / t / 1e6 << std::endl;
+        }
+        for (int p : thread_counts) {
+            ForkJoinPool pool(p);
+            double t = median_of([&]() { radix_sort(vec, pool); });
+            std::cout << "radixsort," << size << "," << p << "," << trials
+                      << "," << t << "," << std_time / t << ","
+                      << size / t / 1e6 << std::endl;
+        }
+    }
+    return 0;
 }
 
-int main() {
+// Every engine on int32, int64, float and double keys of one size, with
+// negative keys and, for int64, keys that use the upper bytes
+void run_key_types(ForkJoinPool& pool, size_t size, int num_runs) {
+    std::cout << "\n=== int32_t ===" << std::endl;
+    benchmark<int32_t>(pool, size, -1000000, 1000000, num_runs);
+    std::cout << "\n=== int64_t ===" << std::endl;
+    benchmark<int64_t>(pool, size, -1000000000000LL, 1000000000000LL,
+                       num_runs);
+    std::cout << "\n=== float ===" << std::endl;
+    benchmark<float>(pool, size, -1e6f, 1e6f, num_runs);
+    std::cout << "\n=== double ===" << std::endl;
+    benchmark<double>(pool, size, -1e6, 1e6, num_runs);
+}
+
+// Every engine on inputs that defeat naive quicksorts: few distinct keys,
+// a single key, and sorted, reversed and nearly sorted keys
+void run_inputs(ForkJoinPool& pool, size_t size, int num_runs) {
+    struct Case {
+        const char* name;
+        int max_val;
+        InputOrder order;
+    };
+    const Case cases[] = {
+        {"random, 1e6 distinct keys", 1000000, InputOrder::RANDOM},
+        {"random, 1000 distinct keys", 1000, InputOrder::RANDOM},
+        {"random, 4 distinct keys", 4, InputOrder::RANDOM},
+        {"one key", 1, InputOrder::RANDOM},
+        {"sorted", 1000000, InputOrder::SORTED},
+        {"reversed", 1000000, InputOrder::REVERSED},
+        {"nearly sorted", 1000000, InputOrder::NEARLY_SORTED},
+    };
+    for (const Case& c : cases) {
+        std::cout << "\n=== " << c.name << " ===" << std::endl;
+        benchmark<int>(pool, size, 1, c.max_val, num_runs, c.order);
+    }
+}
+
+// Usage: ./parallel_quicksort [threads]   (default: all hardware threads)
+//        ./parallel_quicksort --speedup [max_threads] [trials] [size ...]
+//        ./parallel_quicksort --key-types [size] [runs] [threads]
+//        ./parallel_quicksort --inputs [size] [runs] [threads]
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--speedup") {
+        return run_speedup(argc - 2, argv + 2);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--key-types") {
+        size_t size = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10000000;
+        int runs = argc > 3 ? std::atoi(argv[3]) : 3;
+        ForkJoinPool pool(argc > 4 ? std::atoi(argv[4])
+                                   : static_cast<int>(
+                                         std::thread::hardware_concurrency()));
+        run_key_types(pool, size, std::max(runs, 1));
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--inputs") {
+        size_t size = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10000000;
+        int runs = argc > 3 ? std::atoi(argv[3]) : 3;
+        ForkJoinPool pool(argc > 4 ? std::atoi(argv[4])
+                                   : static_cast<int>(
+                                         std::thread::hardware_concurrency()));
+        run_inputs(pool, size, std::max(runs, 1));
+        return 0;
+    }
+
     // Number of hardware threads
     unsigned int num_threads = std::thread::hardware_concurrency();
     std::cout << "Number of hardware threads: " << num_threads << std::endl;
+    if (argc > 1) {
+        num_threads = std::strtoul(argv[1], nullptr, 10);
+    }
+    ForkJoinPool pool(static_cast<int>(num_threads));
+    std::cout << "Fork-join pool workers: " << pool.num_threads()
+              << std::endl;
 
     // Run benchmarks for different sizes
-    benchmark<int>(100000, 1, 1000000);
-    benchmark<int>(1000000, 1, 1000000);
-    benchmark<int>(10000000, 1, 1000000);
+    benchmark<int>(pool, 100000, 1, 1000000);
+    benchmark<int>(pool, 1000000, 1, 1000000);
+    benchmark<int>(pool, 10000000, 1, 1000000);
 
     return 0;
-}
\ No newline at end of file
+}
+#endif
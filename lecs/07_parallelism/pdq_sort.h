@@ -0,0 +1,480 @@
+#ifndef PDQ_SORT_H
+#define PDQ_SORT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+// Sequential pattern-defeating quicksort (after pdqsort, Orson Peters 2021,
+// with the block partition of BlockQuicksort, Edelkamp and Weiss 2016).
+//
+// Compared with a textbook quicksort it adds:
+//
+//   - Branchless block partitioning. The left and the right end are scanned
+//     in blocks of 64; each scan only records the offsets of misplaced
+//     elements, with the comparison result added to a counter instead of
+//     branched on, and the recorded pairs are then swapped. A random input
+//     mispredicts about half of the per-element branches of a Lomuto or
+//     Hoare loop; this loop has none.
+//   - Insertion sort below 24 elements.
+//   - Pattern detection. A partition that moved nothing suggests the input
+//     is already (nearly) sorted, so both sides get a bounded insertion
+//     sort that gives up after a few moves. A pivot equal to the element
+//     just left of the range means the range holds only keys >= pivot, so
+//     the keys equal to it are split off in one pass and never revisited.
+//   - A bound on bad (worse than 1:7) partitions. Each one shuffles a few
+//     elements to break the pattern that caused it; after log2(n) of them
+//     the range is heapsorted, so the worst case is O(n log n).
+//
+// The branchless partition is used for arithmetic keys with the default
+// comparison, where comparisons are cheap and have no side effects.
+
+namespace pdq_detail {
+
+const std::ptrdiff_t INSERTION_SORT_THRESHOLD = 24;
+// Above this size the pivot is a median of three medians of three
+const std::ptrdiff_t NINTHER_THRESHOLD = 128;
+// Element moves a partial insertion sort may make before giving up
+const std::ptrdiff_t PARTIAL_INSERTION_SORT_LIMIT = 8;
+const int BLOCK_SIZE = 64;
+const int CACHE_LINE = 64;
+
+template <typename It, typename Compare>
+void insertion_sort(It begin, It end, Compare comp) {
+    using T = typename std::iterator_traits<It>::value_type;
+    if (begin == end) {
+        return;
+    }
+    for (It cur = begin + 1; cur != end; ++cur) {
+        It sift = cur;
+        It sift_1 = cur - 1;
+        if (comp(*sift, *sift_1)) {
+            T tmp = std::move(*sift);
+            do {
+                *sift-- = std::move(*sift_1);
+            } while (sift != begin && comp(tmp, *--sift_1));
+            *sift = std::move(tmp);
+        }
+    }
+}
+
+// Insertion sort that relies on *(begin - 1) being <= every element, which
+// saves the bounds check in the inner loop
+template <typename It, typename Compare>
+void unguarded_insertion_sort(It begin, It end, Compare comp) {
+    using T = typename std::iterator_traits<It>::value_type;
+    if (begin == end) {
+        return;
+    }
+    for (It cur = begin + 1; cur != end; ++cur) {
+        It sift = cur;
+        It sift_1 = cur - 1;
+        if (comp(*sift, *sift_1)) {
+            T tmp = std::move(*sift);
+            do {
+                *sift-- = std::move(*sift_1);
+            } while (comp(tmp, *--sift_1));
+            *sift = std::move(tmp);
+        }
+    }
+}
+
+// Insertion sort that gives up after PARTIAL_INSERTION_SORT_LIMIT moves;
+// returns true if [begin, end) ended up sorted
+template <typename It, typename Compare>
+bool partial_insertion_sort(It begin, It end, Compare comp) {
+    using T = typename std::iterator_traits<It>::value_type;
+    if (begin == end) {
+        return true;
+    }
+    std::ptrdiff_t moves = 0;
+    for (It cur = begin + 1; cur != end; ++cur) {
+        It sift = cur;
+        It sift_1 = cur - 1;
+        if (comp(*sift, *sift_1)) {
+            T tmp = std::move(*sift);
+            do {
+                *sift-- = std::move(*sift_1);
+            } while (sift != begin && comp(tmp, *--sift_1));
+            *sift = std::move(tmp);
+            moves += cur - sift;
+        }
+        if (moves > PARTIAL_INSERTION_SORT_LIMIT) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename It, typename Compare>
+inline void sort2(It a, It b, Compare comp) {
+    if (comp(*b, *a)) {
+        std::iter_swap(a, b);
+    }
+}
+
+template <typename It, typename Compare>
+inline void sort3(It a, It b, It c, Compare comp) {
+    sort2(a, b, comp);
+    sort2(b, c, comp);
+    sort2(a, b, comp);
+}
+
+inline unsigned char* align_cache_line(unsigned char* p) {
+    std::uintptr_t ip = reinterpret_cast<std::uintptr_t>(p);
+    ip = (ip + CACHE_LINE - 1) & ~std::uintptr_t(CACHE_LINE - 1);
+    return reinterpret_cast<unsigned char*>(ip);
+}
+
+// Swap the num elements at first + offsets_l[i] with those at
+// last - offsets_r[i]. When the counts differ a cyclic permutation does it
+// with one move per element instead of three.
+template <typename It>
+inline void swap_offsets(It first, It last, const unsigned char* offsets_l,
+                         const unsigned char* offsets_r, std::size_t num,
+                         bool use_swaps) {
+    using T = typename std::iterator_traits<It>::value_type;
+    if (use_swaps) {
+        // With equal counts the cycle below would move the same element
+        // twice
+        for (std::size_t i = 0; i < num; ++i) {
+            std::iter_swap(first + offsets_l[i], last - offsets_r[i]);
+        }
+    } else if (num > 0) {
+        It l = first + offsets_l[0];
+        It r = last - offsets_r[0];
+        T tmp(std::move(*l));
+        *l = std::move(*r);
+        for (std::size_t i = 1; i < num; ++i) {
+            l = first + offsets_l[i];
+            *r = std::move(*l);
+            r = last - offsets_r[i];
+            *l = std::move(*r);
+        }
+        *r = std::move(tmp);
+    }
+}
+
+// Partition [begin, end) around the pivot at *begin into keys < pivot and
+// keys >= pivot. Returns the pivot's final position and whether the range
+// was already partitioned. Relies on the median-of-three having left a key
+// >= pivot at the end, which stops the first scan.
+template <typename It, typename Compare>
+std::pair<It, bool> partition_right_branchless(It begin, It end,
+                                               Compare comp) {
+    using T = typename std::iterator_traits<It>::value_type;
+    T pivot(std::move(*begin));
+    It first = begin;
+    It last = end;
+
+    // Skip the prefix and suffix that are already on the right side
+    while (comp(*++first, pivot)) {
+    }
+    if (first - 1 == begin) {
+        while (first < last && !comp(*--last, pivot)) {
+        }
+    } else {
+        while (!comp(*--last, pivot)) {
+        }
+    }
+    bool already_partitioned = first >= last;
+
+    if (!already_partitioned) {
+        std::iter_swap(first, last);
+        ++first;
+
+        unsigned char offsets_l_storage[BLOCK_SIZE + CACHE_LINE];
+        unsigned char offsets_r_storage[BLOCK_SIZE + CACHE_LINE];
+        unsigned char* offsets_l = align_cache_line(offsets_l_storage);
+        unsigned char* offsets_r = align_cache_line(offsets_r_storage);
+        It offsets_l_base = first;
+        It offsets_r_base = last;
+        std::size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+
+        while (first < last) {
+            // Fill whichever offset buffers are empty, splitting what is
+            // left between them once fewer than two blocks remain
+            std::size_t num_unknown = last - first;
+            std::size_t left_split =
+                num_l == 0 ? (num_r == 0 ? num_unknown / 2 : num_unknown) : 0;
+            std::size_t right_split = num_r == 0 ? num_unknown - left_split
+                                                 : 0;
+
+            // The offset is stored unconditionally and kept only if the
+            // element is misplaced: no branch on the comparison
+            if (left_split >= static_cast<std::size_t>(BLOCK_SIZE)) {
+                for (int i = 0; i < BLOCK_SIZE;) {
+                    for (int u = 0; u < 8; u++) {
+                        offsets_l[num_l] = static_cast<unsigned char>(i++);
+                        num_l += !comp(*first, pivot);
+                        ++first;
+                    }
+                }
+            } else {
+                for (std::size_t i = 0; i < left_split;) {
+                    offsets_l[num_l] = static_cast<unsigned char>(i++);
+                    num_l += !comp(*first, pivot);
+                    ++first;
+                }
+            }
+
+            if (right_split >= static_cast<std::size_t>(BLOCK_SIZE)) {
+                for (int i = 0; i < BLOCK_SIZE;) {
+                    for (int u = 0; u < 8; u++) {
+                        offsets_r[num_r] = static_cast<unsigned char>(++i);
+                        num_r += comp(*--last, pivot);
+                    }
+                }
+            } else {
+                for (std::size_t i = 0; i < right_split;) {
+                    offsets_r[num_r] = static_cast<unsigned char>(++i);
+                    num_r += comp(*--last, pivot);
+                }
+            }
+
+            std::size_t num = std::min(num_l, num_r);
+            swap_offsets(offsets_l_base, offsets_r_base, offsets_l + start_l,
+                         offsets_r + start_r, num, num_l == num_r);
+            num_l -= num;
+            num_r -= num;
+            start_l += num;
+            start_r += num;
+            if (num_l == 0) {
+                start_l = 0;
+                offsets_l_base = first;
+            }
+            if (num_r == 0) {
+                start_r = 0;
+                offsets_r_base = last;
+            }
+        }
+
+        // At most one buffer still has misplaced elements; move them to
+        // the boundary
+        if (num_l) {
+            offsets_l += start_l;
+            while (num_l--) {
+                std::iter_swap(offsets_l_base + offsets_l[num_l], --last);
+            }
+            first = last;
+        }
+        if (num_r) {
+            offsets_r += start_r;
+            while (num_r--) {
+                std::iter_swap(offsets_r_base - offsets_r[num_r], first);
+                ++first;
+            }
+            last = first;
+        }
+    }
+
+    It pivot_pos = first - 1;
+    *begin = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return std::make_pair(pivot_pos, already_partitioned);
+}
+
+// Same contract as partition_right_branchless, with a Hoare loop
+template <typename It, typename Compare>
+std::pair<It, bool> partition_right(It begin, It end, Compare comp) {
+    using T = typename std::iterator_traits<It>::value_type;
+    T pivot(std::move(*begin));
+    It first = begin;
+    It last = end;
+
+    while (comp(*++first, pivot)) {
+    }
+    if (first - 1 == begin) {
+        while (first < last && !comp(*--last, pivot)) {
+        }
+    } else {
+        while (!comp(*--last, pivot)) {
+        }
+    }
+    bool already_partitioned = first >= last;
+
+    while (first < last) {
+        std::iter_swap(first, last);
+        while (comp(*++first, pivot)) {
+        }
+        while (!comp(*--last, pivot)) {
+        }
+    }
+
+    It pivot_pos = first - 1;
+    *begin = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return std::make_pair(pivot_pos, already_partitioned);
+}
+
+// Partition [begin, end) around *begin into keys <= pivot and keys >
+// pivot; returns the pivot's final position. Used when no key in the range
+// is below the pivot, so the left side is exactly the keys equal to it.
+template <typename It, typename Compare>
+It partition_left(It begin, It end, Compare comp) {
+    using T = typename std::iterator_traits<It>::value_type;
+    T pivot(std::move(*begin));
+    It first = begin;
+    It last = end;
+
+    while (comp(pivot, *--last)) {
+    }
+    if (last + 1 == end) {
+        while (first < last && !comp(pivot, *++first)) {
+        }
+    } else {
+        while (!comp(pivot, *++first)) {
+        }
+    }
+
+    while (first < last) {
+        std::iter_swap(first, last);
+        while (comp(pivot, *--last)) {
+        }
+        while (!comp(pivot, *++first)) {
+        }
+    }
+
+    It pivot_pos = last;
+    *begin = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return pivot_pos;
+}
+
+// Sort [begin, end). bad_allowed is how many bad partitions remain before
+// heapsort; leftmost is false if *(begin - 1) is a key <= everything here.
+template <bool Branchless, typename It, typename Compare>
+void pdq_loop(It begin, It end, Compare comp, int bad_allowed,
+              bool leftmost) {
+    for (;;) {
+        std::ptrdiff_t size = end - begin;
+        if (size < INSERTION_SORT_THRESHOLD) {
+            if (leftmost) {
+                insertion_sort(begin, end, comp);
+            } else {
+                unguarded_insertion_sort(begin, end, comp);
+            }
+            return;
+        }
+
+        // Pivot to *begin: median of three, or the ninther on large ranges
+        std::ptrdiff_t s2 = size / 2;
+        if (size > NINTHER_THRESHOLD) {
+            sort3(begin, begin + s2, end - 1, comp);
+            sort3(begin + 1, begin + (s2 - 1), end - 2, comp);
+            sort3(begin + 2, begin + (s2 + 1), end - 3, comp);
+            sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1), comp);
+            std::iter_swap(begin, begin + s2);
+        } else {
+            sort3(begin + s2, begin, end - 1, comp);
+        }
+
+        // The key left of the range is a previous pivot and <= every key
+        // here. If it equals this pivot, so do all keys <= the pivot: put
+        // them on the left and continue with the keys above.
+        if (!leftmost && !comp(*(begin - 1), *begin)) {
+            begin = partition_left(begin, end, comp) + 1;
+            continue;
+        }
+
+        std::pair<It, bool> part =
+            Branchless ? partition_right_branchless(begin, end, comp)
+                       : partition_right(begin, end, comp);
+        It pivot_pos = part.first;
+        bool already_partitioned = part.second;
+        std::ptrdiff_t l_size = pivot_pos - begin;
+        std::ptrdiff_t r_size = end - (pivot_pos + 1);
+
+        if (l_size < size / 8 || r_size < size / 8) {
+            // Bad partition: fall back to heapsort if there were too many,
+            // otherwise swap a few keys to break up whatever pattern made
+            // the pivot choice fail
+            if (--bad_allowed == 0) {
+                std::make_heap(begin, end, comp);
+                std::sort_heap(begin, end, comp);
+                return;
+            }
+            if (l_size >= INSERTION_SORT_THRESHOLD) {
+                std::iter_swap(begin, begin + l_size / 4);
+                std::iter_swap(pivot_pos - 1, pivot_pos - l_size / 4);
+                if (l_size > NINTHER_THRESHOLD) {
+                    std::iter_swap(begin + 1, begin + (l_size / 4 + 1));
+                    std::iter_swap(begin + 2, begin + (l_size / 4 + 2));
+                    std::iter_swap(pivot_pos - 2, pivot_pos - (l_size / 4 + 1));
+                    std::iter_swap(pivot_pos - 3, pivot_pos - (l_size / 4 + 2));
+                }
+            }
+            if (r_size >= INSERTION_SORT_THRESHOLD) {
+                std::iter_swap(pivot_pos + 1, pivot_pos + (1 + r_size / 4));
+                std::iter_swap(end - 1, end - r_size / 4);
+                if (r_size > NINTHER_THRESHOLD) {
+                    std::iter_swap(pivot_pos + 2, pivot_pos + (2 + r_size / 4));
+                    std::iter_swap(pivot_pos + 3, pivot_pos + (3 + r_size / 4));
+                    std::iter_swap(end - 2, end - (1 + r_size / 4));
+                    std::iter_swap(end - 3, end - (2 + r_size / 4));
+                }
+            }
+        } else if (already_partitioned &&
+                   partial_insertion_sort(begin, pivot_pos, comp) &&
+                   partial_insertion_sort(pivot_pos + 1, end, comp)) {
+            // A balanced partition that moved nothing: the input is likely
+            // sorted already, and both sides turned out to be
+            return;
+        }
+
+        // Recurse on the left, loop on the right
+        pdq_loop<Branchless>(begin, pivot_pos, comp, bad_allowed, leftmost);
+        begin = pivot_pos + 1;
+        leftmost = false;
+    }
+}
+
+inline int log2_floor(std::ptrdiff_t n) {
+    int log = 0;
+    while (n > 1) {
+        n >>= 1;
+        log++;
+    }
+    return log;
+}
+
+}  // namespace pdq_detail
+
+// Sort [begin, end) with comp, using the branchy Hoare partition
+template <typename It, typename Compare>
+void pdq_sort(It begin, It end, Compare comp) {
+    if (end - begin < 2) {
+        return;
+    }
+    pdq_detail::pdq_loop<false>(begin, end, comp,
+                                pdq_detail::log2_floor(end - begin), true);
+}
+
+// Sort [begin, end) with comp, using the branchless block partition. comp
+// must be cheap and free of side effects.
+template <typename It, typename Compare>
+void pdq_sort_branchless(It begin, It end, Compare comp) {
+    if (end - begin < 2) {
+        return;
+    }
+    pdq_detail::pdq_loop<true>(begin, end, comp,
+                               pdq_detail::log2_floor(end - begin), true);
+}
+
+// Sort [begin, end) ascending; branchless for arithmetic keys
+template <typename It>
+void pdq_sort(It begin, It end) {
+    using T = typename std::iterator_traits<It>::value_type;
+    if (std::is_arithmetic<T>::value) {
+        pdq_sort_branchless(begin, end, std::less<T>());
+    } else {
+        pdq_sort(begin, end, std::less<T>());
+    }
+}
+
+#endif  // PDQ_SORT_H
@@ -0,0 +1,295 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "fork_join_pool.h"
+
+// Parallel radix sort for integer and floating-point keys.
+//
+// Keys are mapped to unsigned integers whose order matches the key order
+// (RadixKey below) and sorted one byte at a time:
+//
+//   - One parallel counting pass builds the histogram of every byte at
+//     once. A byte with only one value over the whole input (the top bytes
+//     of small ints, for example) needs no pass and is skipped.
+//   - Large inputs take one MSD pass on the most significant useful byte,
+//     which leaves 256 independent buckets that fit the cache far better
+//     than the whole array. The buckets are then sorted as separate tasks,
+//     each with a sequential LSD sort on the bytes below. This only pays
+//     when that byte spreads the keys over enough buckets to keep every
+//     worker busy: ints in [1, 1e6] have just 16 values in their top useful
+//     byte, which would cap the speedup at 16.
+//   - Smaller inputs, and those whose top byte is too skewed, use parallel
+//     LSD passes over the useful bytes.
+//
+// Parallel passes give each task a contiguous chunk and its own 256-entry
+// histogram; digit-major prefix sums over the histograms give every (chunk,
+// digit) pair its own output range, so the scatter needs no atomics. The
+// scatter goes through software write-combining buffers: a cache line of
+// staged keys per digit, copied out whole when full, so 256 output streams
+// cost one line write each instead of a partial-line write per key.
+//
+// Needs n elements of scratch space.
+
+// Order-preserving map from a key to an unsigned integer of the same size
+template <typename T, typename Enable = void>
+struct RadixKey;
+
+template <typename T>
+struct RadixKey<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+    using Bits = typename std::make_unsigned<T>::type;
+    static Bits bits(T x) {
+        // Flip the sign bit so negative values order below positive ones
+        const Bits sign =
+            std::is_signed<T>::value ? Bits(1) << (8 * sizeof(T) - 1) : 0;
+        return static_cast<Bits>(x) ^ sign;
+    }
+};
+
+template <typename T>
+struct RadixKey<
+    T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static_assert(sizeof(T) == 4 || sizeof(T) == 8, "float or double");
+    using Bits =
+        typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type;
+    static Bits bits(T x) {
+        Bits b;
+        std::memcpy(&b, &x, sizeof(b));
+        // Negative: flip everything, so larger magnitudes order lower.
+        // Positive: set the sign bit, so they order above all negatives.
+        const Bits sign = Bits(1) << (8 * sizeof(T) - 1);
+        return (b & sign) ? ~b : b | sign;
+    }
+};
+
+namespace radix_sort_detail {
+
+const int RADIX_BITS = 8;
+const int RADIX = 1 << RADIX_BITS;
+// Inputs below this size go to std::sort
+const size_t RADIX_SORT_MIN = 1 << 12;
+// Inputs at least this large take an MSD pass first, if the top byte has at
+// least MSD_BUCKETS_PER_THREAD non-empty buckets per worker and none larger
+// than MSD_MAX_SHARE times an even share
+const size_t MSD_MIN = 1 << 20;
+const int MSD_BUCKETS_PER_THREAD = 4;
+const int MSD_MAX_SHARE = 2;
+// Smallest chunk a parallel pass hands to one task
+const size_t CHUNK_MIN = 1 << 16;
+
+template <typename T>
+inline unsigned digit(const T& x, int byte) {
+    return static_cast<unsigned>(RadixKey<T>::bits(x) >> (8 * byte)) &
+           (RADIX - 1);
+}
+
+using Histogram = std::array<size_t, RADIX>;
+
+// Scatter src[begin, end) by `byte` to dst, the first key of digit d going
+// to dst[next[d]]; next is advanced past what was written
+template <typename T>
+void scatter_combined(const T* src, size_t begin, size_t end, T* dst,
+                      int byte, Histogram& next) {
+    // One cache line of keys per digit
+    constexpr int LINE = 64 / sizeof(T) > 0 ? 64 / sizeof(T) : 1;
+    struct alignas(64) Line {
+        T keys[LINE];
+    };
+    std::unique_ptr<Line[]> lines(new Line[RADIX]);
+    std::array<int, RADIX> fill{};
+
+    for (size_t i = begin; i < end; i++) {
+        unsigned d = digit(src[i], byte);
+        lines[d].keys[fill[d]++] = src[i];
+        if (fill[d] == LINE) {
+            std::copy(lines[d].keys, lines[d].keys + LINE, dst + next[d]);
+            next[d] += LINE;
+            fill[d] = 0;
+        }
+    }
+    for (int d = 0; d < RADIX; d++) {
+        std::copy(lines[d].keys, lines[d].keys + fill[d], dst + next[d]);
+        next[d] += fill[d];
+    }
+}
+
+// Per-byte histograms of src[0, n), counted in parallel
+template <typename T>
+std::vector<Histogram> count_all_bytes(const T* src, size_t n, int chunks) {
+    std::vector<std::vector<Histogram>> partial(
+        chunks, std::vector<Histogram>(sizeof(T), Histogram{}));
+    fork_join_each(chunks, [&](int c) {
+        size_t begin = n * c / chunks, end = n * (c + 1) / chunks;
+        std::vector<Histogram>& h = partial[c];
+        for (size_t i = begin; i < end; i++) {
+            auto bits = RadixKey<T>::bits(src[i]);
+            for (size_t b = 0; b < sizeof(T); b++) {
+                h[b][(bits >> (8 * b)) & (RADIX - 1)]++;
+            }
+        }
+    });
+    std::vector<Histogram> total(sizeof(T), Histogram{});
+    for (int c = 0; c < chunks; c++) {
+        for (size_t b = 0; b < sizeof(T); b++) {
+            for (int d = 0; d < RADIX; d++) {
+                total[b][d] += partial[c][b][d];
+            }
+        }
+    }
+    return total;
+}
+
+// A byte all of whose keys share one digit orders nothing
+inline bool byte_is_trivial(const Histogram& h, size_t n) {
+    return *std::max_element(h.begin(), h.end()) == n;
+}
+
+// Whether the buckets of an MSD pass with histogram h give `threads`
+// workers enough independent, similar-sized tasks
+inline bool msd_balanced(const Histogram& h, size_t n, int threads) {
+    long nonempty = std::count_if(h.begin(), h.end(),
+                                  [](size_t c) { return c > 0; });
+    size_t largest = *std::max_element(h.begin(), h.end());
+    return nonempty >= static_cast<long>(MSD_BUCKETS_PER_THREAD) * threads &&
+           largest <= MSD_MAX_SHARE * n / threads;
+}
+
+// One parallel counting-sort pass of src to dst by `byte`. Returns the
+// start of each digit's bucket in dst (RADIX + 1 entries).
+template <typename T>
+std::vector<size_t> parallel_pass(const T* src, T* dst, size_t n, int byte,
+                                  int chunks) {
+    std::vector<Histogram> counts(chunks, Histogram{});
+    fork_join_each(chunks, [&](int c) {
+        size_t begin = n * c / chunks, end = n * (c + 1) / chunks;
+        for (size_t i = begin; i < end; i++) {
+            counts[c][digit(src[i], byte)]++;
+        }
+    });
+
+    // Digit-major prefix sums: counts[c][d] becomes where chunk c writes
+    // its first key with digit d
+    std::vector<size_t> bucket_begin(RADIX + 1);
+    size_t offset = 0;
+    for (int d = 0; d < RADIX; d++) {
+        bucket_begin[d] = offset;
+        for (int c = 0; c < chunks; c++) {
+            size_t count = counts[c][d];
+            counts[c][d] = offset;
+            offset += count;
+        }
+    }
+    bucket_begin[RADIX] = n;
+
+    fork_join_each(chunks, [&](int c) {
+        scatter_combined(src, n * c / chunks, n * (c + 1) / chunks, dst, byte,
+                         counts[c]);
+    });
+    return bucket_begin;
+}
+
+// Sequential LSD sort of data[0, n) on bytes [0, top) with scratch of the
+// same size; the result ends up in data
+template <typename T>
+void lsd_sort_seq(T* data, T* scratch, size_t n, int top) {
+    if (n < 64) {
+        std::sort(data, data + n, [](const T& a, const T& b) {
+            return RadixKey<T>::bits(a) < RadixKey<T>::bits(b);
+        });
+        return;
+    }
+    T* src = data;
+    T* dst = scratch;
+    for (int byte = 0; byte < top; byte++) {
+        Histogram next{};
+        for (size_t i = 0; i < n; i++) {
+            next[digit(src[i], byte)]++;
+        }
+        if (byte_is_trivial(next, n)) {
+            continue;
+        }
+        size_t offset = 0;
+        for (int d = 0; d < RADIX; d++) {
+            size_t count = next[d];
+            next[d] = offset;
+            offset += count;
+        }
+        for (size_t i = 0; i < n; i++) {
+            dst[next[digit(src[i], byte)]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+    if (src != data) {
+        std::copy(src, src + n, data);
+    }
+}
+
+}  // namespace radix_sort_detail
+
+// Sort arr in ascending order of RadixKey<T> on `pool`. Integers sort as
+// usual; floats sort -0.0 before +0.0 and put NaNs at the ends.
+template <typename T>
+void radix_sort(std::vector<T>& arr, ForkJoinPool& pool) {
+    using namespace radix_sort_detail;
+    const size_t n = arr.size();
+    if (n < RADIX_SORT_MIN) {
+        std::sort(arr.begin(), arr.end());
+        return;
+    }
+    const int chunks = static_cast<int>(std::max<size_t>(
+        1, std::min<size_t>(4 * pool.num_threads(), n / CHUNK_MIN)));
+    std::unique_ptr<T[]> buffer(new T[n]);
+
+    pool.run([&]() {
+        std::vector<Histogram> hist = count_all_bytes(arr.data(), n, chunks);
+        std::vector<int> useful;
+        for (size_t b = 0; b < sizeof(T); b++) {
+            if (!byte_is_trivial(hist[b], n)) {
+                useful.push_back(static_cast<int>(b));
+            }
+        }
+        if (useful.empty()) {
+            return;  // all keys equal
+        }
+
+        if (n >= MSD_MIN && useful.size() > 1 &&
+            msd_balanced(hist[useful.back()], n, pool.num_threads())) {
+            // MSD pass on the top useful byte, then each bucket on its own
+            int top = useful.back();
+            std::vector<size_t> bucket = parallel_pass(
+                arr.data(), buffer.get(), n, top, chunks);
+            fork_join_each(RADIX, [&](int d) {
+                size_t begin = bucket[d], size = bucket[d + 1] - bucket[d];
+                lsd_sort_seq(buffer.get() + begin, arr.data() + begin, size,
+                             top);
+                std::copy(buffer.get() + begin, buffer.get() + begin + size,
+                          arr.data() + begin);
+            });
+            return;
+        }
+
+        // LSD passes over the useful bytes, ping-ponging with the buffer
+        T* src = arr.data();
+        T* dst = buffer.get();
+        for (int byte : useful) {
+            parallel_pass(src, dst, n, byte, chunks);
+            std::swap(src, dst);
+        }
+        if (src != arr.data()) {
+            fork_join_each(chunks, [&](int c) {
+                std::copy(src + n * c / chunks, src + n * (c + 1) / chunks,
+                          arr.data() + n * c / chunks);
+            });
+        }
+    });
+}
+
+#endif  // RADIX_SORT_H
@@ -0,0 +1,224 @@
+#ifndef SAMPLE_SORT_H
+#define SAMPLE_SORT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "fork_join_pool.h"
+#include "simd_sort.h"
+
+// Parallel sample sort (after Super Scalar Sample Sort, Sanders and
+// Winkel, ESA 2004).
+//
+// One distribution pass replaces the log(n) partitioning levels of
+// quicksort:
+//
+//   1. Draw an oversampled random sample, sort it and keep every
+//      oversample-th key as one of k - 1 splitters.
+//   2. Classify every element into one of k buckets by descending an
+//      implicit binary tree of splitters. Each level is a compare and an
+//      index update with no data-dependent branch, so the loop pipelines
+//      and never mispredicts. Each task counts its chunk into a histogram
+//      and remembers each element's bucket.
+//   3. Prefix sums over the histograms give every (chunk, bucket) pair its
+//      own output range, so tasks scatter into a buffer without atomics.
+//   4. Sort the buckets in parallel and copy them back.
+//
+// If the sample has repeated keys, the splitters are deduplicated and every
+// bucket gets an equality bucket in front of it for the keys equal to its
+// lower splitter. Those need no sort, so a heavy key costs one
+// classification and one move instead of landing in a single bucket that
+// one worker sorts on its own.
+//
+// Needs n elements of scratch space and one byte per element for the bucket
+// indices.
+
+namespace sample_sort_detail {
+
+// Inputs below this size go straight to the sequential sort
+const size_t SAMPLE_SORT_MIN = 1 << 16;
+// At most this many buckets, so a bucket index fits in one byte
+const int MAX_BUCKETS = 256;
+// Elements per classification and scatter task
+const size_t CHUNK = 1 << 16;
+
+// k - 1 splitters in Eytzinger order: tree[1] is the median, the children
+// of tree[j] are tree[2j] and tree[2j + 1]
+template <typename T>
+class SplitterTree {
+   public:
+    SplitterTree(const std::vector<T>& sorted_splitters, int log_buckets)
+        : log_buckets_(log_buckets), tree_(size_t(1) << log_buckets) {
+        size_t next = 0;
+        build(sorted_splitters, 1, next);
+    }
+
+    // Bucket b holds the keys x with splitter[b - 1] <= x < splitter[b]
+    int bucket(const T& x) const {
+        size_t j = 1;
+        for (int level = 0; level < log_buckets_; level++) {
+            j = 2 * j + static_cast<size_t>(!(x < tree_[j]));
+        }
+        return static_cast<int>(j - tree_.size());
+    }
+
+   private:
+    // In-order walk of the implicit tree assigns splitters in sorted order
+    void build(const std::vector<T>& splitters, size_t j, size_t& next) {
+        if (j >= tree_.size()) {
+            return;
+        }
+        build(splitters, 2 * j, next);
+        tree_[j] = splitters[next++];
+        build(splitters, 2 * j + 1, next);
+    }
+
+    int log_buckets_;
+    std::vector<T> tree_;
+};
+
+// Sorted splitters with duplicates removed, padded back to `count` by
+// repeating the largest; the buckets between equal splitters stay empty.
+// Returns whether there were duplicates.
+template <typename T>
+bool dedupe_splitters(std::vector<T>& splitters, size_t count) {
+    splitters.erase(std::unique(splitters.begin(), splitters.end()),
+                    splitters.end());
+    bool repeated = splitters.size() < count;
+    splitters.resize(count, splitters.back());
+    return repeated;
+}
+
+}  // namespace sample_sort_detail
+
+// Sort arr in ascending order on `pool`. leaf sorts one bucket [first, last)
+// sequentially; it is never called on an equality bucket.
+template <typename T, typename LeafSort>
+void sample_sort(std::vector<T>& arr, ForkJoinPool& pool, LeafSort leaf) {
+    using namespace sample_sort_detail;
+    const size_t n = arr.size();
+    const int p = pool.num_threads();
+    if (n < SAMPLE_SORT_MIN || p == 1) {
+        leaf(arr.data(), arr.data() + n);
+        return;
+    }
+
+    // Eight buckets per worker let thieves balance uneven buckets, while
+    // buckets of at least a few thousand keys keep the scatter streaming
+    int log_buckets = 1;
+    while ((1 << log_buckets) < 8 * p && (1 << log_buckets) < MAX_BUCKETS &&
+           n >> (log_buckets + 1) >= 4096) {
+        log_buckets++;
+    }
+    int k = 1 << log_buckets;
+
+    // 1. Splitters from a sample of about k * log2(n) / 4 keys
+    int log_n = 0;
+    while ((size_t(1) << log_n) < n) {
+        log_n++;
+    }
+    const size_t oversample = std::max(1, log_n / 4);
+    std::vector<T> sample(oversample * k);
+    std::mt19937_64 gen(n);
+    std::uniform_int_distribution<size_t> pick(0, n - 1);
+    for (T& s : sample) {
+        s = arr[pick(gen)];
+    }
+    std::sort(sample.begin(), sample.end());
+    auto pick_splitters = [&]() {
+        std::vector<T> splitters(k - 1);
+        const size_t step = sample.size() / k;
+        for (int i = 0; i < k - 1; i++) {
+            splitters[i] = sample[(i + 1) * step];
+        }
+        return splitters;
+    };
+    std::vector<T> splitters = pick_splitters();
+    bool equal_buckets = dedupe_splitters(splitters, k - 1);
+    if (equal_buckets && 2 * k > MAX_BUCKETS) {
+        // Halve k so the doubled bucket indices still fit in a byte
+        log_buckets--;
+        k /= 2;
+        splitters = pick_splitters();
+        equal_buckets = dedupe_splitters(splitters, k - 1);
+    }
+    const SplitterTree<T> tree(splitters, log_buckets);
+    // With equality buckets, bucket b of the tree becomes 2b (keys equal to
+    // splitters[b - 1]) and 2b + 1 (the rest); bucket 0 is always empty
+    const int buckets = equal_buckets ? 2 * k : k;
+
+    const int chunks = static_cast<int>((n + CHUNK - 1) / CHUNK);
+    std::unique_ptr<uint8_t[]> oracle(new uint8_t[n]);
+    std::vector<size_t> counts(static_cast<size_t>(chunks) * buckets, 0);
+    std::unique_ptr<T[]> buffer(new T[n]);
+    std::vector<size_t> bucket_begin(buckets + 1);
+
+    pool.run([&]() {
+        // 2. Classify and count
+        fork_join_each(chunks, [&](int c) {
+            size_t begin = c * CHUNK, end = std::min(n, begin + CHUNK);
+            size_t* count = &counts[static_cast<size_t>(c) * buckets];
+            if (!equal_buckets) {
+                for (size_t i = begin; i < end; i++) {
+                    int b = tree.bucket(arr[i]);
+                    oracle[i] = static_cast<uint8_t>(b);
+                    count[b]++;
+                }
+                return;
+            }
+            for (size_t i = begin; i < end; i++) {
+                const T& x = arr[i];
+                int b = tree.bucket(x);
+                // b > 0 implies splitters[b - 1] <= x
+                int equal = (b > 0) & !(splitters[b > 0 ? b - 1 : 0] < x);
+                b = 2 * b + 1 - equal;
+                oracle[i] = static_cast<uint8_t>(b);
+                count[b]++;
+            }
+        });
+
+        // 3. Bucket-major prefix sums: counts[c][b] becomes where chunk c
+        // writes its first element of bucket b
+        size_t offset = 0;
+        for (int b = 0; b < buckets; b++) {
+            bucket_begin[b] = offset;
+            for (int c = 0; c < chunks; c++) {
+                size_t& count = counts[static_cast<size_t>(c) * buckets + b];
+                size_t bucket_count = count;
+                count = offset;
+                offset += bucket_count;
+            }
+        }
+        bucket_begin[buckets] = n;
+
+        fork_join_each(chunks, [&](int c) {
+            size_t begin = c * CHUNK, end = std::min(n, begin + CHUNK);
+            size_t* next = &counts[static_cast<size_t>(c) * buckets];
+            for (size_t i = begin; i < end; i++) {
+                buffer[next[oracle[i]]++] = arr[i];
+            }
+        });
+
+        // 4. Sort each bucket and copy it back
+        fork_join_each(buckets, [&](int b) {
+            T* first = buffer.get() + bucket_begin[b];
+            T* last = buffer.get() + bucket_begin[b + 1];
+            if (!equal_buckets || b % 2 == 1) {
+                leaf(first, last);
+            }
+            std::copy(first, last, arr.data() + bucket_begin[b]);
+        });
+    });
+}
+
+// The same leaf as quicksort_parallel, so the two compare like for like
+template <typename T>
+void sample_sort(std::vector<T>& arr, ForkJoinPool& pool) {
+    sample_sort(arr, pool, [](T* first, T* last) { simd_sort(first, last); });
+}
+
+#endif  // SAMPLE_SORT_H
@@ -0,0 +1,407 @@
+#ifndef SIMD_SORT_H
+#define SIMD_SORT_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "pdq_sort.h"
+
+// Vectorised quicksort for int32, int64, float and double keys (after
+// vqsort, Blacher, Wassenberg et al. 2022, and Bramas 2017).
+//
+// The partition compares a whole vector of keys with the pivot at once and
+// writes the two sides with AVX-512 compress-stores, or on AVX2 with one
+// permutation from a lookup table that packs the keys going left in front
+// of the rest. The AVX2 kernel takes 32-bit keys only; 64-bit keys need
+// AVX-512. Ranges of up to two vectors are sorted with bitonic networks in
+// registers instead of insertion sort.
+//
+// The kernels in simd_sort_impl.h are compiled once per instruction set
+// with `#pragma GCC target`, so the rest of the program keeps the baseline
+// flags, and the one to run is picked from the CPU features at run time.
+// Without AVX2, on other compilers or CPUs, or for other key types,
+// simd_sort is pdq_sort and simd_partition is std::partition. NaN keys are
+// not supported.
+
+enum class SimdLevel { SCALAR, AVX2, AVX512 };
+
+inline const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX512: return "AVX-512";
+        case SimdLevel::AVX2: return "AVX2";
+        default: return "scalar";
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define SIMD_SORT_X86 1
+// GCC 12's AVX-512 intrinsics read a self-initialised "undefined" vector,
+// which -Wuninitialized reports wherever they are inlined (GCC bug 105593)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#else
+#define SIMD_SORT_X86 0
+#endif
+
+namespace simd_sort_detail {
+
+template <typename T>
+struct Supported
+    : std::integral_constant<bool, std::is_same<T, int32_t>::value ||
+                                       std::is_same<T, int64_t>::value ||
+                                       std::is_same<T, float>::value ||
+                                       std::is_same<T, double>::value> {};
+
+// AVX2 split permutations: entry m lists the lanes whose bit is set in m,
+// then the others, as eight 4-bit lane indices
+constexpr std::array<uint32_t, 256> make_split_table() {
+    std::array<uint32_t, 256> table{};
+    for (int m = 0; m < 256; m++) {
+        uint32_t entry = 0;
+        int slot = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            for (int lane = 0; lane < 8; lane++) {
+                if (((m >> lane) & 1) == (pass == 0 ? 1 : 0)) {
+                    entry |= uint32_t(lane) << (4 * slot++);
+                }
+            }
+        }
+        table[m] = entry;
+    }
+    return table;
+}
+
+inline constexpr std::array<uint32_t, 256> SPLIT_TABLE = make_split_table();
+
+}  // namespace simd_sort_detail
+
+#if SIMD_SORT_X86
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+namespace simd_sort_avx2 {
+
+// Permutation of 32-bit lanes from a packed split table entry
+inline __m256i split_indices(uint32_t entry) {
+    return _mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(entry)),
+                             _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28));
+}
+
+// Permutation that swaps lanes J apart
+inline __m256i xor_indices(int j) {
+    const __m256i iota = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    return _mm256_xor_si256(iota, _mm256_set1_epi32(j));
+}
+
+// All-ones 32-bit lanes where `bits` has a bit set
+inline __m256i mask32(unsigned bits) {
+    const __m256i lane = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    return _mm256_cmpeq_epi32(
+        _mm256_and_si256(_mm256_set1_epi32(static_cast<int>(bits)), lane),
+        lane);
+}
+
+template <typename T>
+struct Traits;
+
+template <>
+struct Traits<int32_t> {
+    using T = int32_t;
+    using Vec = __m256i;
+    static constexpr int L = 8;
+    static Vec load(const T* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    static void store(T* p, Vec v) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+    }
+    static Vec set1(T x) { return _mm256_set1_epi32(x); }
+    static unsigned lt(Vec a, Vec b) {
+        return _mm256_movemask_ps(
+            _mm256_castsi256_ps(_mm256_cmpgt_epi32(b, a)));
+    }
+    static Vec min(Vec a, Vec b) { return _mm256_min_epi32(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm256_max_epi32(a, b); }
+    template <int J>
+    static Vec swap_lanes(Vec v) {
+        return _mm256_permutevar8x32_epi32(v, xor_indices(J));
+    }
+    static Vec blend(Vec a, Vec b, unsigned bits) {
+        return _mm256_blendv_epi8(a, b, mask32(bits));
+    }
+    static void store_split(T* left, T* right_end, Vec v, unsigned bits,
+                            int) {
+        Vec p = _mm256_permutevar8x32_epi32(
+            v, split_indices(simd_sort_detail::SPLIT_TABLE[bits]));
+        store(left, p);
+        store(right_end - L, p);
+    }
+};
+
+template <>
+struct Traits<float> {
+    using T = float;
+    using Vec = __m256;
+    static constexpr int L = 8;
+    static Vec load(const T* p) { return _mm256_loadu_ps(p); }
+    static void store(T* p, Vec v) { _mm256_storeu_ps(p, v); }
+    static Vec set1(T x) { return _mm256_set1_ps(x); }
+    static unsigned lt(Vec a, Vec b) {
+        return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ));
+    }
+    static Vec min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+    template <int J>
+    static Vec swap_lanes(Vec v) {
+        return _mm256_permutevar8x32_ps(v, xor_indices(J));
+    }
+    static Vec blend(Vec a, Vec b, unsigned bits) {
+        return _mm256_blendv_ps(a, b, _mm256_castsi256_ps(mask32(bits)));
+    }
+    static void store_split(T* left, T* right_end, Vec v, unsigned bits,
+                            int) {
+        Vec p = _mm256_permutevar8x32_ps(
+            v, split_indices(simd_sort_detail::SPLIT_TABLE[bits]));
+        store(left, p);
+        store(right_end - L, p);
+    }
+};
+
+#include "simd_sort_impl.h"
+
+}  // namespace simd_sort_avx2
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+namespace simd_sort_avx512 {
+
+template <typename T>
+struct Traits;
+
+template <>
+struct Traits<int32_t> {
+    using T = int32_t;
+    using Vec = __m512i;
+    static constexpr int L = 16;
+    static Vec load(const T* p) { return _mm512_loadu_si512(p); }
+    static void store(T* p, Vec v) { _mm512_storeu_si512(p, v); }
+    static Vec set1(T x) { return _mm512_set1_epi32(x); }
+    static unsigned lt(Vec a, Vec b) { return _mm512_cmplt_epi32_mask(a, b); }
+    static Vec min(Vec a, Vec b) { return _mm512_min_epi32(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm512_max_epi32(a, b); }
+    template <int J>
+    static Vec swap_lanes(Vec v) {
+        const Vec iota = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+                                           11, 12, 13, 14, 15);
+        return _mm512_permutexvar_epi32(
+            _mm512_xor_si512(iota, _mm512_set1_epi32(J)), v);
+    }
+    static Vec blend(Vec a, Vec b, unsigned bits) {
+        return _mm512_mask_blend_epi32(static_cast<__mmask16>(bits), a, b);
+    }
+    static void store_split(T* left, T* right_end, Vec v, unsigned bits,
+                            int num_left) {
+        _mm512_mask_compressstoreu_epi32(left, static_cast<__mmask16>(bits),
+                                         v);
+        _mm512_mask_compressstoreu_epi32(right_end - (L - num_left),
+                                         static_cast<__mmask16>(~bits), v);
+    }
+};
+
+template <>
+struct Traits<float> {
+    using T = float;
+    using Vec = __m512;
+    static constexpr int L = 16;
+    static Vec load(const T* p) { return _mm512_loadu_ps(p); }
+    static void store(T* p, Vec v) { _mm512_storeu_ps(p, v); }
+    static Vec set1(T x) { return _mm512_set1_ps(x); }
+    static unsigned lt(Vec a, Vec b) {
+        return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);
+    }
+    static Vec min(Vec a, Vec b) { return _mm512_min_ps(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm512_max_ps(a, b); }
+    template <int J>
+    static Vec swap_lanes(Vec v) {
+        const __m512i iota = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+                                               10, 11, 12, 13, 14, 15);
+        return _mm512_permutexvar_ps(
+            _mm512_xor_si512(iota, _mm512_set1_epi32(J)), v);
+    }
+    static Vec blend(Vec a, Vec b, unsigned bits) {
+        return _mm512_mask_blend_ps(static_cast<__mmask16>(bits), a, b);
+    }
+    static void store_split(T* left, T* right_end, Vec v, unsigned bits,
+                            int num_left) {
+        _mm512_mask_compressstoreu_ps(left, static_cast<__mmask16>(bits), v);
+        _mm512_mask_compressstoreu_ps(right_end - (L - num_left),
+                                      static_cast<__mmask16>(~bits), v);
+    }
+};
+
+template <>
+struct Traits<int64_t> {
+    using T = int64_t;
+    using Vec = __m512i;
+    static constexpr int L = 8;
+    static Vec load(const T* p) { return _mm512_loadu_si512(p); }
+    static void store(T* p, Vec v) { _mm512_storeu_si512(p, v); }
+    static Vec set1(T x) { return _mm512_set1_epi64(x); }
+    static unsigned lt(Vec a, Vec b) { return _mm512_cmplt_epi64_mask(a, b); }
+    static Vec min(Vec a, Vec b) { return _mm512_min_epi64(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm512_max_epi64(a, b); }
+    template <int J>
+    static Vec swap_lanes(Vec v) {
+        const Vec iota = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+        return _mm512_permutexvar_epi64(
+            _mm512_xor_si512(iota, _mm512_set1_epi64(J)), v);
+    }
+    static Vec blend(Vec a, Vec b, unsigned bits) {
+        return _mm512_mask_blend_epi64(static_cast<__mmask8>(bits), a, b);
+    }
+    static void store_split(T* left, T* right_end, Vec v, unsigned bits,
+                            int num_left) {
+        _mm512_mask_compressstoreu_epi64(left, static_cast<__mmask8>(bits),
+                                         v);
+        _mm512_mask_compressstoreu_epi64(right_end - (L - num_left),
+                                         static_cast<__mmask8>(~bits), v);
+    }
+};
+
+template <>
+struct Traits<double> {
+    using T = double;
+    using Vec = __m512d;
+    static constexpr int L = 8;
+    static Vec load(const T* p) { return _mm512_loadu_pd(p); }
+    static void store(T* p, Vec v) { _mm512_storeu_pd(p, v); }
+    static Vec set1(T x) { return _mm512_set1_pd(x); }
+    static unsigned lt(Vec a, Vec b) {
+        return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ);
+    }
+    static Vec min(Vec a, Vec b) { return _mm512_min_pd(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm512_max_pd(a, b); }
+    template <int J>
+    static Vec swap_lanes(Vec v) {
+        const __m512i iota = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+        return _mm512_permutexvar_pd(
+            _mm512_xor_si512(iota, _mm512_set1_epi64(J)), v);
+    }
+    static Vec blend(Vec a, Vec b, unsigned bits) {
+        return _mm512_mask_blend_pd(static_cast<__mmask8>(bits), a, b);
+    }
+    static void store_split(T* left, T* right_end, Vec v, unsigned bits,
+                            int num_left) {
+        _mm512_mask_compressstoreu_pd(left, static_cast<__mmask8>(bits), v);
+        _mm512_mask_compressstoreu_pd(right_end - (L - num_left),
+                                      static_cast<__mmask8>(~bits), v);
+    }
+};
+
+#include "simd_sort_impl.h"
+
+}  // namespace simd_sort_avx512
+#pragma GCC pop_options
+
+#endif  // SIMD_SORT_X86
+
+// Widest instruction set of this CPU that the kernels use
+inline SimdLevel simd_cpu_level() {
+#if SIMD_SORT_X86
+    static const SimdLevel level = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return SimdLevel::AVX512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return SimdLevel::AVX2;
+        }
+        return SimdLevel::SCALAR;
+    }();
+    return level;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+// Instruction set simd_sort uses for T with at most `max_level`
+template <typename T>
+SimdLevel simd_sort_level(SimdLevel max_level = SimdLevel::AVX512) {
+    if (!simd_sort_detail::Supported<T>::value) {
+        return SimdLevel::SCALAR;
+    }
+    SimdLevel level = std::min(max_level, simd_cpu_level());
+    if (level == SimdLevel::AVX2 && sizeof(T) == 8) {
+        // Four lanes, without 64-bit min and max, lose to pdq_sort: 0.72 s
+        // against 0.56 s for 1e7 random int64 keys
+        return SimdLevel::SCALAR;
+    }
+    return level;
+}
+
+// Sort [first, last) ascending, with vector instructions up to max_level
+template <typename T>
+void simd_sort(T* first, T* last, SimdLevel max_level = SimdLevel::AVX512) {
+#if SIMD_SORT_X86
+    if constexpr (simd_sort_detail::Supported<T>::value) {
+        switch (simd_sort_level<T>(max_level)) {
+            case SimdLevel::AVX512:
+                simd_sort_avx512::sort<simd_sort_avx512::Traits<T>>(first,
+                                                                    last);
+                return;
+            case SimdLevel::AVX2:
+                if constexpr (sizeof(T) == 4) {
+                    simd_sort_avx2::sort<simd_sort_avx2::Traits<T>>(first,
+                                                                    last);
+                    return;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+#else
+    (void)max_level;
+#endif
+    pdq_sort(first, last);
+}
+
+// Move the keys < pivot (<= pivot if or_equal) to the front of [first,
+// last) and return the end of them
+template <typename T>
+T* simd_partition(T* first, T* last, T pivot, bool or_equal,
+                  SimdLevel max_level = SimdLevel::AVX512) {
+#if SIMD_SORT_X86
+    if constexpr (simd_sort_detail::Supported<T>::value) {
+        switch (simd_sort_level<T>(max_level)) {
+            case SimdLevel::AVX512:
+                return simd_sort_avx512::partition<
+                    simd_sort_avx512::Traits<T>>(first, last, pivot, or_equal);
+            case SimdLevel::AVX2:
+                if constexpr (sizeof(T) == 4) {
+                    return simd_sort_avx2::partition<
+                        simd_sort_avx2::Traits<T>>(first, last, pivot,
+                                                   or_equal);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+#else
+    (void)max_level;
+#endif
+    return std::partition(first, last, [pivot, or_equal](const T& x) {
+        return or_equal ? !(pivot < x) : x < pivot;
+    });
+}
+
+#endif  // SIMD_SORT_H
@@ -0,0 +1,188 @@
+// Vectorised quicksort kernels, written once against a lane-traits type V
+// and compiled once per instruction set: simd_sort.h includes this file
+// inside each target namespace, after `#pragma GCC target` and the traits.
+// No include guard on purpose.
+//
+// V provides, for keys V::T in vectors V::Vec of V::L lanes, with lane
+// masks as the low L bits of an unsigned:
+//   load, store, set1, lt (bit i: a[i] < b[i]), min, max,
+//   swap_lanes<J> (lane i gets lane i ^ J), blend (bit i set: lane from b),
+//   store_split (the lanes in a mask to one place, the rest to another)
+
+// Lanes that take the max in the step of a bitonic network that compares
+// lanes J apart, in a merge of sequences of K lanes: the upper lane of an
+// ascending pair and the lower lane of a descending one
+constexpr unsigned take_max_mask(int lanes, int j, int k) {
+    unsigned mask = 0;
+    for (int i = 0; i < lanes; i++) {
+        if (((i & j) != 0) != ((i & k) != 0)) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+
+// Steps J, J / 2, ..., 1 of a bitonic merge of K-lane sequences
+template <typename V, int K, int J>
+inline typename V::Vec bitonic_steps(typename V::Vec v) {
+    if constexpr (J > 0) {
+        constexpr unsigned mask = take_max_mask(V::L, J, K);
+        typename V::Vec p = V::template swap_lanes<J>(v);
+        v = V::blend(V::min(v, p), V::max(v, p), mask);
+        return bitonic_steps<V, K, J / 2>(v);
+    } else {
+        return v;
+    }
+}
+
+// Bitonic sorting network on the lanes of one vector
+template <typename V, int K = 2>
+inline typename V::Vec sort_vector(typename V::Vec v) {
+    if constexpr (K <= V::L) {
+        return sort_vector<V, 2 * K>(bitonic_steps<V, K, K / 2>(v));
+    } else {
+        return v;
+    }
+}
+
+// Sort the n <= 2L keys at first with sorting networks: each vector on its
+// own, then one bitonic merge of the two. Missing lanes hold the largest
+// key, so they sort to the end.
+template <typename V>
+void sort_small(typename V::T* first, std::ptrdiff_t n) {
+    using T = typename V::T;
+    using Vec = typename V::Vec;
+    alignas(64) T buf[2 * V::L];
+    const T sentinel = std::numeric_limits<T>::has_infinity
+                           ? std::numeric_limits<T>::infinity()
+                           : std::numeric_limits<T>::max();
+    std::copy(first, first + n, buf);
+    std::fill(buf + n, buf + 2 * V::L, sentinel);
+
+    Vec a = sort_vector<V>(V::load(buf));
+    if (n > V::L) {
+        // Ascending a against descending b: the lane-wise min and max are
+        // the low and high halves, each bitonic
+        Vec b = V::template swap_lanes<V::L - 1>(sort_vector<V>(
+            V::load(buf + V::L)));
+        Vec lo = V::min(a, b);
+        Vec hi = V::max(a, b);
+        a = bitonic_steps<V, 2 * V::L, V::L / 2>(lo);
+        V::store(buf + V::L, bitonic_steps<V, 2 * V::L, V::L / 2>(hi));
+    }
+    V::store(buf, a);
+    std::copy(buf, buf + n, first);
+}
+
+// Move the keys < pivot (<= pivot if or_equal) to the front of [first,
+// last) and return the end of them.
+//
+// One vector from each end is held back, so every store lands in space
+// whose keys were already loaded. Each step loads the next vector from the
+// end with less free space, which leaves at least L free slots on both
+// sides; store_split then writes the keys that go left at the left write
+// position and the others just below the right one, and may scribble over
+// the rest of those L slots. The last partial vector and the two held back
+// finally fill the gap between the write positions exactly.
+template <typename V>
+typename V::T* partition(typename V::T* first, typename V::T* last,
+                         typename V::T pivot, bool or_equal) {
+    using T = typename V::T;
+    using Vec = typename V::Vec;
+    const int L = V::L;
+    auto goes_left = [pivot, or_equal](const T& x) {
+        return or_equal ? !(pivot < x) : x < pivot;
+    };
+    if (last - first < 2 * L) {
+        return std::partition(first, last, goes_left);
+    }
+
+    const Vec pv = V::set1(pivot);
+    const unsigned all = (1u << L) - 1;
+    const Vec head = V::load(first);
+    const Vec tail = V::load(last - L);
+    T* read_l = first + L;
+    T* read_r = last - L;
+    T* write_l = first;
+    T* write_r = last;
+    while (read_r - read_l >= L) {
+        Vec v;
+        if (read_l - write_l <= write_r - read_r) {
+            v = V::load(read_l);
+            read_l += L;
+        } else {
+            read_r -= L;
+            v = V::load(read_r);
+        }
+        unsigned left = or_equal ? ~V::lt(pv, v) & all : V::lt(v, pv);
+        int num_left = __builtin_popcount(left);
+        V::store_split(write_l, write_r, v, left, num_left);
+        write_l += num_left;
+        write_r -= L - num_left;
+    }
+
+    alignas(64) T rest[3 * L];
+    std::ptrdiff_t m = read_r - read_l;
+    std::copy(read_l, read_r, rest);
+    V::store(rest + m, head);
+    V::store(rest + m + L, tail);
+    for (std::ptrdiff_t i = 0; i < m + 2 * L; i++) {
+        // Both slots are free; write both and keep one
+        T x = rest[i];
+        bool left = goes_left(x);
+        *write_l = x;
+        write_r[-1] = x;
+        write_l += left;
+        write_r -= !left;
+    }
+    return write_l;
+}
+
+template <typename T>
+inline T median3(T a, T b, T c) {
+    return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+// Introsort on [first, last) with the vector partition, recursing into the
+// smaller part. Runs of keys equal to the pivot are split off once the
+// pivot is the smallest key of a range. After `depth` partitions along one
+// path the range goes to pdq_sort, whose heapsort bounds the worst case.
+template <typename V>
+void sort_loop(typename V::T* first, typename V::T* last, int depth) {
+    using T = typename V::T;
+    while (last - first > 2 * V::L) {
+        if (depth-- == 0) {
+            pdq_sort(first, last);
+            return;
+        }
+        std::ptrdiff_t n = last - first, s = n / 8;
+        T* mid = first + n / 2;
+        T pivot = median3(median3(first[0], first[s], first[2 * s]),
+                          median3(mid[-s], mid[0], mid[s]),
+                          median3(last[-1 - 2 * s], last[-1 - s], last[-1]));
+
+        T* split = partition<V>(first, last, pivot, false);
+        if (split == first) {
+            // Nothing below the pivot: the keys equal to it are done
+            first = partition<V>(first, last, pivot, true);
+            continue;
+        }
+        if (split - first < last - split) {
+            sort_loop<V>(first, split, depth);
+            first = split;
+        } else {
+            sort_loop<V>(split, last, depth);
+            last = split;
+        }
+    }
+    sort_small<V>(first, last - first);
+}
+
+template <typename V>
+void sort(typename V::T* first, typename V::T* last) {
+    int depth = 0;
+    for (std::ptrdiff_t n = last - first; n > 1; n >>= 1) {
+        depth += 2;
+    }
+    sort_loop<V>(first, last, depth);
+}
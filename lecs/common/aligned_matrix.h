@@ -0,0 +1,121 @@
+#ifndef ALIGNED_MATRIX_H
+#define ALIGNED_MATRIX_H
+
+// Runtime-sized row-major matrices on aligned heap memory. Plain C so that
+// both the pthreads and the TBB drivers can use it.
+//
+// A matrix is rows x cols with a row stride of ld >= cols doubles. ld is a
+// multiple of 8, so every row starts on a 64-byte cache line. Extra padding
+// (matrix_padded_ld) breaks up the power-of-two strides that make the rows
+// of a large matrix map to the same cache sets.
+//
+// With huge pages requested the buffer is mmap'ed, first with MAP_HUGETLB
+// (pre-reserved 2 MiB pages) and otherwise as transparent huge pages via
+// madvise. This cuts TLB misses for kernels that stride down columns.
+//
+// Allocation does not touch the memory. Callers initialise rows from the
+// threads that will later compute on them (matrix_fill_rows,
+// matrix_zero_rows), so first-touch places each page near its user.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define MATRIX_ALIGNMENT 64
+#define MATRIX_HUGE_PAGE ((size_t)2 << 20)
+
+typedef struct {
+    double* data;
+    int rows;
+    int cols;
+    int ld;        // row stride in doubles
+    size_t bytes;  // size of the allocation
+    int mapped;    // 1 if data came from mmap rather than posix_memalign
+} AlignedMatrix;
+
+// Row stride for cols columns plus pad extra doubles, rounded up to a
+// whole number of cache lines
+static inline int matrix_padded_ld(int cols, int pad) {
+    int ld = cols + pad;
+    return (ld + 7) & ~7;
+}
+
+// Allocate a rows x cols matrix with row stride ld. Returns 0 on success.
+static inline int matrix_alloc(AlignedMatrix* m, int rows, int cols, int ld,
+                               int huge_pages) {
+    size_t bytes = (size_t)rows * (size_t)ld * sizeof(double);
+    void* p = NULL;
+
+    m->rows = rows;
+    m->cols = cols;
+    m->ld = ld;
+    m->mapped = huge_pages != 0;
+
+    if (huge_pages) {
+        bytes = (bytes + MATRIX_HUGE_PAGE - 1) & ~(MATRIX_HUGE_PAGE - 1);
+        p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p == MAP_FAILED) {
+            p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) {
+                return -1;
+            }
+            madvise(p, bytes, MADV_HUGEPAGE);
+        }
+    } else if (posix_memalign(&p, MATRIX_ALIGNMENT, bytes) != 0) {
+        return -1;
+    }
+
+    m->data = (double*)p;
+    m->bytes = bytes;
+    return 0;
+}
+
+static inline void matrix_free(AlignedMatrix* m) {
+    if (m->data == NULL) {
+        return;
+    }
+    if (m->mapped) {
+        munmap(m->data, m->bytes);
+    } else {
+        free(m->data);
+    }
+    m->data = NULL;
+}
+
+static inline double* matrix_row(const AlignedMatrix* m, int i) {
+    return m->data + (size_t)i * (size_t)m->ld;
+}
+
+// Fill rows [row_begin, row_end) with uniform values in [0, 1). Each row
+// has its own generator (splitmix64 seeded from seed and the row index), so
+// the contents do not depend on how rows are split across threads.
+static inline void matrix_fill_rows(AlignedMatrix* m, int row_begin,
+                                    int row_end, uint64_t seed) {
+    for (int i = row_begin; i < row_end; i++) {
+        double* row = matrix_row(m, i);
+        uint64_t state = seed ^ ((uint64_t)i * 0x9E3779B97F4A7C15ull);
+        for (int j = 0; j < m->cols; j++) {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z ^= z >> 31;
+            row[j] = (double)(z >> 11) * (1.0 / 9007199254740992.0);
+        }
+        memset(row + m->cols, 0, (size_t)(m->ld - m->cols) * sizeof(double));
+    }
+}
+
+static inline void matrix_zero_rows(AlignedMatrix* m, int row_begin,
+                                    int row_end) {
+    if (row_end > row_begin) {
+        memset(matrix_row(m, row_begin), 0,
+               (size_t)(row_end - row_begin) * (size_t)m->ld *
+                   sizeof(double));
+    }
+}
+
+#endif  // ALIGNED_MATRIX_H
@@ -0,0 +1,80 @@
+#ifndef FJ_INSTRUMENT_H
+#define FJ_INSTRUMENT_H
+
+// Fork-join instrumentation hooks.
+//
+// Parallel kernels describe their series-parallel structure with these
+// macros. In normal builds they expand to nothing. Building with one of the
+// tool flags below links them to an analysis runtime instead; the kernel is
+// then compiled without -fopenmp and runs as its serial elision (each
+// spawned task executes to completion at its spawn point), which is the
+// execution order the tools reason about.
+//
+//   FJ_RACE_DETECT  SP-bags determinacy-race detector (sp_race_detector.h)
+//   FJ_WORK_SPAN    work/span profiler (work_span_profiler.h)
+//
+//   FJ_SPAWN_SCOPE  first statement of a spawned task's body
+//   FJ_SYNC()       after a join point (taskwait, future.wait())
+//   FJ_READ(p)      before reading *p
+//   FJ_WRITE(p)     before writing *p
+//   FJ_REGION(name) the rest of this scope is one call site in reports
+//   FJ_REPORT()     print the active tool's report; nonzero on failure
+
+#if defined(FJ_RACE_DETECT) && defined(FJ_WORK_SPAN)
+#error "FJ_RACE_DETECT and FJ_WORK_SPAN are separate builds"
+#endif
+
+#if defined(FJ_RACE_DETECT) || defined(FJ_WORK_SPAN)
+
+#define FJ_INSTRUMENTED 1
+#if defined(FJ_RACE_DETECT)
+#include "sp_race_detector.h"
+#else
+#include "work_span_profiler.h"
+#endif
+
+#define FJ_CONCAT_INNER(a, b) a##b
+#define FJ_CONCAT(a, b) FJ_CONCAT_INNER(a, b)
+
+#define FJ_SPAWN_SCOPE ::fj::SpawnScope FJ_CONCAT(fj_spawn_, __LINE__)
+#define FJ_SYNC() ::fj::sync()
+#define FJ_REGION(name) \
+    ::fj::Region FJ_CONCAT(fj_region_, __LINE__)(name, __FILE__, __LINE__)
+#define FJ_REPORT() ::fj::report()
+
+#if defined(FJ_RACE_DETECT)
+#define FJ_READ(p) ::fj::on_read((p), __FILE__, __LINE__)
+#define FJ_WRITE(p) ::fj::on_write((p), __FILE__, __LINE__)
+#else
+#define FJ_READ(p) \
+    do {           \
+    } while (0)
+#define FJ_WRITE(p) \
+    do {            \
+    } while (0)
+#endif
+
+#else
+
+#define FJ_INSTRUMENTED 0
+
+#define FJ_SPAWN_SCOPE \
+    do {               \
+    } while (0)
+#define FJ_SYNC() \
+    do {          \
+    } while (0)
+#define FJ_READ(p) \
+    do {           \
+    } while (0)
+#define FJ_WRITE(p) \
+    do {            \
+    } while (0)
+#define FJ_REGION(name) \
+    do {                \
+    } while (0)
+#define FJ_REPORT() 0
+
+#endif
+
+#endif  // FJ_INSTRUMENT_H
@@ -0,0 +1,173 @@
+#ifndef MATRIX_COMPARE_H
+#define MATRIX_COMPARE_H
+
+// Element-wise comparison of a computed matrix against a reference. Plain C
+// so the pthreads driver, the TBB driver and the gtest suite share it.
+//
+// Instead of stopping at the first mismatch, a comparison reports the whole
+// picture: the largest absolute and relative error, how many elements are
+// out of tolerance, and where the worst element is. An element passes when
+//
+//   |actual - expected| <= abs_tol + rel_tol * |expected|
+//
+// and NaN never passes.
+//
+// matrix_compare_rows is the per-thread kernel: its inner loop is branch
+// free so the compiler vectorises it, and a row is scanned a second time
+// only when it holds a new worst element. Each driver runs it over row
+// blocks with its own threading and folds the partial results together
+// with matrix_compare_merge. matrix_compare does this with OpenMP, and
+// runs serially when built without it.
+
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct {
+    double max_abs_err;
+    double max_rel_err;
+    long out_of_tolerance;
+    long compared;
+    int worst_row;  // -1 while nothing has been compared
+    int worst_col;
+    double worst_expected;
+    double worst_actual;
+} MatrixCompareResult;
+
+static inline void matrix_compare_init(MatrixCompareResult* r) {
+    r->max_abs_err = 0.0;
+    r->max_rel_err = 0.0;
+    r->out_of_tolerance = 0;
+    r->compared = 0;
+    r->worst_row = -1;
+    r->worst_col = -1;
+    r->worst_expected = 0.0;
+    r->worst_actual = 0.0;
+}
+
+// Order candidates for the worst element: larger error wins, ties go to
+// the earlier position so the result does not depend on the thread split
+static inline int matrix_compare_worse(double err, int row, int col,
+                                       const MatrixCompareResult* r) {
+    if (r->worst_row < 0 || err > r->max_abs_err) {
+        return 1;
+    }
+    return err == r->max_abs_err &&
+           (row < r->worst_row || (row == r->worst_row && col < r->worst_col));
+}
+
+// Compare rows [row_begin, row_end) of two row-major matrices with row
+// strides ld_expected and ld_actual, accumulating into *r
+static inline void matrix_compare_rows(const double* expected,
+                                       int ld_expected, const double* actual,
+                                       int ld_actual, int row_begin,
+                                       int row_end, int cols, double abs_tol,
+                                       double rel_tol,
+                                       MatrixCompareResult* r) {
+    for (int i = row_begin; i < row_end; i++) {
+        const double* e = expected + (size_t)i * (size_t)ld_expected;
+        const double* a = actual + (size_t)i * (size_t)ld_actual;
+        double row_abs = 0.0;
+        double row_rel = 0.0;
+        long row_bad = 0;
+
+        for (int j = 0; j < cols; j++) {
+            double diff = fabs(a[j] - e[j]);
+            double mag = fabs(e[j]);
+            row_bad += !(diff <= abs_tol + rel_tol * mag);
+            row_abs = diff > row_abs ? diff : row_abs;
+            double rel = diff / (mag > DBL_MIN ? mag : DBL_MIN);
+            row_rel = rel > row_rel ? rel : row_rel;
+        }
+
+        r->out_of_tolerance += row_bad;
+        r->compared += cols;
+        if (row_rel > r->max_rel_err) {
+            r->max_rel_err = row_rel;
+        }
+        // NaNs slip past the max above but are always counted as bad
+        if (row_bad == 0 && row_abs <= r->max_abs_err && r->worst_row >= 0) {
+            continue;
+        }
+        for (int j = 0; j < cols; j++) {
+            double diff = fabs(a[j] - e[j]);
+            if (diff != diff) {
+                diff = INFINITY;
+                r->max_rel_err = INFINITY;
+            }
+            if (matrix_compare_worse(diff, i, j, r)) {
+                r->max_abs_err = diff;
+                r->worst_row = i;
+                r->worst_col = j;
+                r->worst_expected = e[j];
+                r->worst_actual = a[j];
+            }
+        }
+    }
+}
+
+// Fold a partial result into *into
+static inline void matrix_compare_merge(MatrixCompareResult* into,
+                                        const MatrixCompareResult* part) {
+    into->out_of_tolerance += part->out_of_tolerance;
+    into->compared += part->compared;
+    if (part->max_rel_err > into->max_rel_err) {
+        into->max_rel_err = part->max_rel_err;
+    }
+    if (part->worst_row >= 0 &&
+        matrix_compare_worse(part->max_abs_err, part->worst_row,
+                             part->worst_col, into)) {
+        into->max_abs_err = part->max_abs_err;
+        into->worst_row = part->worst_row;
+        into->worst_col = part->worst_col;
+        into->worst_expected = part->worst_expected;
+        into->worst_actual = part->worst_actual;
+    }
+}
+
+// Whole-matrix comparison, parallel over rows when built with OpenMP
+static inline MatrixCompareResult matrix_compare(
+    const double* expected, int ld_expected, const double* actual,
+    int ld_actual, int rows, int cols, double abs_tol, double rel_tol) {
+    MatrixCompareResult total;
+    matrix_compare_init(&total);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        MatrixCompareResult part;
+        matrix_compare_init(&part);
+#ifdef _OPENMP
+#pragma omp for schedule(static) nowait
+#endif
+        for (int i = 0; i < rows; i++) {
+            matrix_compare_rows(expected, ld_expected, actual, ld_actual, i,
+                                i + 1, cols, abs_tol, rel_tol, &part);
+        }
+#ifdef _OPENMP
+#pragma omp critical(matrix_compare_merge)
+#endif
+        matrix_compare_merge(&total, &part);
+    }
+    return total;
+}
+
+static inline int matrix_compare_ok(const MatrixCompareResult* r) {
+    return r->out_of_tolerance == 0;
+}
+
+static inline void matrix_compare_print(FILE* out,
+                                        const MatrixCompareResult* r) {
+    fprintf(out,
+            "Compared %ld elements: %ld out of tolerance, max abs error "
+            "%.3e, max rel error %.3e\n",
+            r->compared, r->out_of_tolerance, r->max_abs_err, r->max_rel_err);
+    if (r->worst_row >= 0 && r->max_abs_err > 0.0) {
+        fprintf(out, "Worst element [%d][%d]: expected %.17g, got %.17g\n",
+                r->worst_row, r->worst_col, r->worst_expected,
+                r->worst_actual);
+    }
+}
+
+#endif  // MATRIX_COMPARE_H
@@ -0,0 +1,238 @@
+#ifndef SP_RACE_DETECTOR_H
+#define SP_RACE_DETECTOR_H
+
+// Determinacy-race detector for fork-join programs (SP-bags, as in Cilksan).
+//
+// The program runs as its serial elision. Every procedure instance (the
+// root and each spawned task) owns two bags of finished procedure ids:
+//
+//   S-bag  descendants that logically precede the currently running strand
+//   P-bag  descendants that may run in parallel with it
+//
+// Bags are disjoint sets in a union-find structure whose root records the
+// bag kind, so "is the last writer parallel with me?" is one find().
+//
+//   spawn F:            S_F = {F}, P_F = {}
+//   F returns to G:     P_G = P_G u S_F   (F has already synced)
+//   sync in G:          S_G = S_G u P_G,  P_G = {}
+//   write l by F:       race if reader(l) or writer(l) is in a P-bag;
+//                       writer(l) = F
+//   read l by F:        race if writer(l) is in a P-bag;
+//                       reader(l) = F if reader(l) is in an S-bag
+//
+// Shadow memory is keyed by element address, so accesses are expected to be
+// whole, aligned elements of at most 8 bytes (doubles, ints, ...).
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fj {
+
+class SpRaceDetector {
+   public:
+    struct Race {
+        const void* address;
+        bool write_write;  // otherwise a read and a write
+        const char* file;
+        int line;
+        std::string region;
+    };
+
+    SpRaceDetector() { reset(); }
+
+    // Forget all history and start a new root procedure
+    void reset() {
+        parent_.clear();
+        rank_.clear();
+        kind_.clear();
+        frames_.clear();
+        shadow_.clear();
+        races_.clear();
+        race_count_ = 0;
+        region_ = "(top level)";
+        frames_.push_back(new_frame());
+    }
+
+    void spawn() { frames_.push_back(new_frame()); }
+
+    void spawn_return() {
+        sync();  // a task joins its own children before returning
+        Frame child = frames_.back();
+        frames_.pop_back();
+        Frame& parent = frames_.back();
+        parent.p_bag = parent.p_bag < 0 ? child.s_bag
+                                        : unite(parent.p_bag, child.s_bag);
+        kind_[find(parent.p_bag)] = kParallel;
+    }
+
+    void sync() {
+        Frame& frame = frames_.back();
+        if (frame.p_bag >= 0) {
+            frame.s_bag = unite(frame.s_bag, frame.p_bag);
+            kind_[find(frame.s_bag)] = kSeries;
+            frame.p_bag = -1;
+        }
+    }
+
+    void read(const void* addr, const char* file, int line) {
+        const int self = frames_.back().id;
+        Shadow& cell = shadow_[reinterpret_cast<uintptr_t>(addr)];
+        if (cell.writer >= 0 && in_parallel_bag(cell.writer)) {
+            report(addr, false, file, line);
+        }
+        if (cell.reader < 0 || !in_parallel_bag(cell.reader)) {
+            cell.reader = self;
+        }
+    }
+
+    void write(const void* addr, const char* file, int line) {
+        const int self = frames_.back().id;
+        Shadow& cell = shadow_[reinterpret_cast<uintptr_t>(addr)];
+        if (cell.writer >= 0 && in_parallel_bag(cell.writer)) {
+            report(addr, true, file, line);
+        } else if (cell.reader >= 0 && in_parallel_bag(cell.reader)) {
+            report(addr, false, file, line);
+        }
+        cell.writer = self;
+    }
+
+    void set_region(const std::string& name) { region_ = name; }
+    const std::string& region() const { return region_; }
+
+    size_t race_count() const { return race_count_; }
+    const std::vector<Race>& races() const { return races_; }
+
+    // Print a summary and the first few races; returns the race count
+    size_t print_report(FILE* out = stdout) const {
+        std::fprintf(out, "Race detector: %zu race(s), %zu locations checked\n",
+                     race_count_, shadow_.size());
+        for (const Race& r : races_) {
+            std::fprintf(out, "  %s race on %p at %s:%d in %s\n",
+                         r.write_write ? "write-write" : "read-write",
+                         r.address, r.file, r.line, r.region.c_str());
+        }
+        if (race_count_ > races_.size()) {
+            std::fprintf(out, "  ... %zu more\n", race_count_ - races_.size());
+        }
+        return race_count_;
+    }
+
+   private:
+    enum BagKind : uint8_t { kSeries, kParallel };
+
+    struct Frame {
+        int id;
+        int s_bag;  // any member of the S-bag set
+        int p_bag;  // any member of the P-bag set, -1 when empty
+    };
+
+    struct Shadow {
+        int reader = -1;
+        int writer = -1;
+    };
+
+    static constexpr size_t kMaxReported = 16;
+
+    Frame new_frame() {
+        int id = static_cast<int>(parent_.size());
+        parent_.push_back(id);
+        rank_.push_back(0);
+        kind_.push_back(kSeries);
+        return {id, id, -1};
+    }
+
+    int find(int x) {
+        while (parent_[x] != x) {
+            parent_[x] = parent_[parent_[x]];  // path halving
+            x = parent_[x];
+        }
+        return x;
+    }
+
+    int unite(int a, int b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) {
+            return a;
+        }
+        if (rank_[a] < rank_[b]) {
+            std::swap(a, b);
+        }
+        parent_[b] = a;
+        if (rank_[a] == rank_[b]) {
+            rank_[a]++;
+        }
+        return a;
+    }
+
+    bool in_parallel_bag(int id) { return kind_[find(id)] == kParallel; }
+
+    void report(const void* addr, bool write_write, const char* file,
+                int line) {
+        race_count_++;
+        if (races_.size() < kMaxReported) {
+            races_.push_back({addr, write_write, file, line, region_});
+        }
+    }
+
+    std::vector<int> parent_;
+    std::vector<uint8_t> rank_;
+    std::vector<BagKind> kind_;
+    std::vector<Frame> frames_;
+    std::unordered_map<uintptr_t, Shadow> shadow_;
+    std::vector<Race> races_;
+    size_t race_count_ = 0;
+    std::string region_;
+};
+
+inline SpRaceDetector& race_detector() {
+    static SpRaceDetector detector;
+    return detector;
+}
+
+// Hook entry points used by fj_instrument.h
+
+struct SpawnScope {
+    SpawnScope() { race_detector().spawn(); }
+    ~SpawnScope() { race_detector().spawn_return(); }
+    SpawnScope(const SpawnScope&) = delete;
+    SpawnScope& operator=(const SpawnScope&) = delete;
+};
+
+struct Region {
+    Region(const char* name, const char* file, int line)
+        : saved_(race_detector().region()) {
+        race_detector().set_region(std::string(name) + " (" + file + ":" +
+                                   std::to_string(line) + ")");
+    }
+    ~Region() { race_detector().set_region(saved_); }
+    Region(const Region&) = delete;
+    Region& operator=(const Region&) = delete;
+
+   private:
+    std::string saved_;
+};
+
+inline void sync() { race_detector().sync(); }
+
+inline int report() {
+    return race_detector().print_report() == 0 ? 0 : 1;
+}
+
+template <typename T>
+inline void on_read(const T* p, const char* file, int line) {
+    race_detector().read(p, file, line);
+}
+
+template <typename T>
+inline void on_write(const T* p, const char* file, int line) {
+    race_detector().write(p, file, line);
+}
+
+}  // namespace fj
+
+#endif  // SP_RACE_DETECTOR_H
@@ -0,0 +1,227 @@
+#ifndef WORK_SPAN_PROFILER_H
+#define WORK_SPAN_PROFILER_H
+
+// Work/span profiler for fork-join programs (in the style of Cilkscale).
+//
+// The program runs as its serial elision and the time between consecutive
+// hooks is charged to the running strand. Each frame (the root, each spawned
+// task and each FJ_REGION) keeps
+//
+//   work          total time of all strands in the frame's subtree
+//   contin_span   longest path through the frame's synced prefix and the
+//                 current continuation
+//   child_span    longest path ending in a spawned child that has not been
+//                 joined yet (measured from the frame's start)
+//
+// and the same two spans again with a fixed burden added on every spawn
+// edge, which models the scheduling cost a real runtime pays per steal:
+//
+//   spawn F from G:  F starts empty
+//   F returns:       G.work += F.work
+//                    G.child_span = max(G.child_span, G.contin_span + F.span)
+//   sync in G:       G.contin_span = max(G.contin_span, G.child_span)
+//
+// When a region ends its work and span are recorded for its call site and
+// then folded into the enclosing frame as one serial strand. The burden
+// defaults to 10 us per spawn and can be changed with FJ_BURDEN_NS.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fj {
+
+class WorkSpanProfiler {
+   public:
+    struct SiteStats {
+        long calls = 0;
+        double work = 0.0;  // seconds, summed over calls
+        double span = 0.0;
+        double burdened_span = 0.0;
+    };
+
+    WorkSpanProfiler() {
+        const char* env = std::getenv("FJ_BURDEN_NS");
+        burden_ = (env != nullptr ? std::atof(env) : 10000.0) * 1e-9;
+        reset();
+    }
+
+    void reset() {
+        frames_.assign(1, Frame());
+        sites_.clear();
+        last_ = Clock::now();
+    }
+
+    void spawn() {
+        charge();
+        frames_.emplace_back();
+        last_ = Clock::now();
+    }
+
+    void spawn_return() {
+        charge();
+        Frame child = finish_top();
+        Frame& parent = frames_.back();
+        parent.work += child.work;
+        parent.child_span =
+            std::max(parent.child_span, parent.contin_span + child.contin_span);
+        parent.b_child_span =
+            std::max(parent.b_child_span,
+                     parent.b_contin_span + child.b_contin_span + burden_);
+        last_ = Clock::now();
+    }
+
+    void sync() {
+        charge();
+        sync_frame(frames_.back());
+        last_ = Clock::now();
+    }
+
+    void region_begin() {
+        charge();
+        frames_.emplace_back();
+        last_ = Clock::now();
+    }
+
+    void region_end(const std::string& site) {
+        charge();
+        Frame region = finish_top();
+        SiteStats& stats = sites_[site];
+        stats.calls++;
+        stats.work += region.work;
+        stats.span += region.contin_span;
+        stats.burdened_span += region.b_contin_span;
+
+        Frame& parent = frames_.back();
+        parent.work += region.work;
+        parent.contin_span += region.contin_span;
+        parent.b_contin_span += region.b_contin_span;
+        last_ = Clock::now();
+    }
+
+    const std::map<std::string, SiteStats>& sites() const { return sites_; }
+
+    // Per call site: work, span, parallelism and speedup bounds
+    void print_report(FILE* out = stdout) const {
+        // Powers of two up to 64 workers, plus this machine's thread count
+        int hw = static_cast<int>(std::thread::hardware_concurrency());
+        std::vector<int> procs;
+        for (int p = 2; p <= 64; p *= 2) {
+            procs.push_back(p);
+        }
+        if (hw > 1 &&
+            std::find(procs.begin(), procs.end(), hw) == procs.end()) {
+            procs.push_back(hw);
+            std::sort(procs.begin(), procs.end());
+        }
+
+        std::fprintf(out, "Work/span profile (burden %.1f us per spawn)\n",
+                     burden_ * 1e6);
+        for (const auto& entry : sites_) {
+            const SiteStats& s = entry.second;
+            double parallelism = s.work / std::max(s.span, 1e-12);
+            double burdened = s.work / std::max(s.burdened_span, 1e-12);
+            std::fprintf(out, "\n%s  (%ld call%s)\n", entry.first.c_str(),
+                         s.calls, s.calls == 1 ? "" : "s");
+            std::fprintf(out, "  work            %12.3f ms\n", s.work * 1e3);
+            std::fprintf(out, "  span            %12.3f ms\n", s.span * 1e3);
+            std::fprintf(out, "  burdened span   %12.3f ms\n",
+                         s.burdened_span * 1e3);
+            std::fprintf(out, "  parallelism     %12.2f\n", parallelism);
+            std::fprintf(out, "  burdened par.   %12.2f\n", burdened);
+            std::fprintf(out, "  speedup on P workers: upper min(P, T1/Tinf), "
+                              "lower T1 / (T1/P + burdened span)\n");
+            for (int p : procs) {
+                double upper = std::min<double>(p, parallelism);
+                double lower = s.work / (s.work / p + s.burdened_span);
+                std::fprintf(out, "    P = %-4d %8.2f .. %-8.2f\n", p, lower,
+                             upper);
+            }
+        }
+    }
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Frame {
+        double work = 0.0;
+        double contin_span = 0.0;
+        double child_span = 0.0;
+        double b_contin_span = 0.0;
+        double b_child_span = 0.0;
+    };
+
+    // Charge the time since the previous hook to the running strand
+    void charge() {
+        double elapsed =
+            std::chrono::duration<double>(Clock::now() - last_).count();
+        Frame& frame = frames_.back();
+        frame.work += elapsed;
+        frame.contin_span += elapsed;
+        frame.b_contin_span += elapsed;
+    }
+
+    static void sync_frame(Frame& frame) {
+        frame.contin_span = std::max(frame.contin_span, frame.child_span);
+        frame.child_span = 0.0;
+        frame.b_contin_span = std::max(frame.b_contin_span, frame.b_child_span);
+        frame.b_child_span = 0.0;
+    }
+
+    // Pop the running frame after its implicit sync
+    Frame finish_top() {
+        Frame frame = frames_.back();
+        frames_.pop_back();
+        sync_frame(frame);
+        return frame;
+    }
+
+    std::vector<Frame> frames_;
+    std::map<std::string, SiteStats> sites_;
+    Clock::time_point last_;
+    double burden_;
+};
+
+inline WorkSpanProfiler& work_span_profiler() {
+    static WorkSpanProfiler profiler;
+    return profiler;
+}
+
+// Hook entry points used by fj_instrument.h
+
+struct SpawnScope {
+    SpawnScope() { work_span_profiler().spawn(); }
+    ~SpawnScope() { work_span_profiler().spawn_return(); }
+    SpawnScope(const SpawnScope&) = delete;
+    SpawnScope& operator=(const SpawnScope&) = delete;
+};
+
+struct Region {
+    Region(const char* name, const char* file, int line)
+        : site_(std::string(name) + " (" + file + ":" + std::to_string(line) +
+                ")") {
+        work_span_profiler().region_begin();
+    }
+    ~Region() { work_span_profiler().region_end(site_); }
+    Region(const Region&) = delete;
+    Region& operator=(const Region&) = delete;
+
+   private:
+    std::string site_;
+};
+
+inline void sync() { work_span_profiler().sync(); }
+
+inline int report() {
+    work_span_profiler().print_report();
+    return 0;
+}
+
+}  // namespace fj
+
+#endif  // WORK_SPAN_PROFILER_H